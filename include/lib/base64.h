@@ -0,0 +1,36 @@
+/*
+ * Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Standard base64 (RFC 4648, with '=' padding), the text form of binary
+ * values in the exported formats and on the command line.
+ */
+
+#ifndef __LIB_BASE64_H__
+#define __LIB_BASE64_H__
+
+#include <inttypes.h>
+#include <stddef.h>
+#include "lib_vpd.h"
+
+/* Returns the number of characters base64Encode() generates for len bytes. */
+size_t base64EncodedSize(size_t len);
+
+/* Encodes len bytes of in into base64EncodedSize(len) characters at out,
+ * without a trailing '\0'. */
+void base64Encode(const uint8_t *in, size_t len, char *out);
+
+/*
+ * Decodes len characters of in into out, which must have room for len * 3 / 4
+ * bytes. '\n' and '\r' are skipped. *out_len returns the number of bytes
+ * decoded.
+ *
+ * Returns VPD_ERR_SYNTAX if in is not base64.
+ */
+vpd_err_t base64Decode(const char *in,
+                       size_t len,
+                       uint8_t *out,
+                       size_t *out_len);
+
+#endif  /* __LIB_BASE64_H__ */
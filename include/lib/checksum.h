@@ -41,6 +41,18 @@ extern "C" {
  */
 extern uint8_t zero8_csum(uint8_t* buf, size_t len);
 
+/*
+ * sum8 - Adds up bytes, modulo 256
+ *
+ * @buf:  input buffer
+ * @len:  length of buffer
+ *
+ * A range protected by a zero8_csum() byte sums to 0.
+ *
+ * returns the sum
+ */
+extern uint8_t sum8(const uint8_t* buf, size_t len);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
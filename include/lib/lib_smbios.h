@@ -22,17 +22,90 @@
 #define __LIB_LIB_SMBIOS__
 
 #include <inttypes.h>
+#include <stddef.h>
 #include "lib/vpd_tables.h"
 
 struct vpd_entry *vpd_create_eps(unsigned short structure_table_len,
                                  unsigned short num_structures,
                                  uint32_t eps_base);
-int vpd_append_type241(uint16_t handle, uint8_t **buf,
-                       size_t len, const char *uuid, uint32_t offset,
-                       uint32_t size, const char *vendor,
-                       const char *desc, const char *variant);
-int vpd_type241_size(struct vpd_header *header);
-int vpd_append_type127(uint16_t handle,
-                       uint8_t **buf, size_t len);
+long vpd_find_eps(const uint8_t *partition, uint32_t size);
+
+/* What an entry point of either kind says about the structure table. */
+struct vpd_eps_info {
+  uint8_t major_ver;      /* 2 for "_SM_", 3 for "_SM3_" */
+  uint8_t entry_length;
+  uint32_t table_offset;  /* in the partition, right after the EPS */
+  /* Address of the EPS in ROM, derived from table_address. Truncated to 32
+   * bits, like the blob offsets in type 241 that it is subtracted from. */
+  uint32_t eps_address;
+};
+int vpd_read_eps(const uint8_t *partition, uint32_t size, uint32_t eps_offset,
+                 struct vpd_eps_info *info);
+int vpd_find_blob(const uint8_t *partition, uint32_t size,
+                  const char *uuid, uint32_t *offset);
+
+/* An index of a structure table, built by vpd_index_table() in one bounded
+ * pass. Offsets are relative to the table. */
+#define VPD_MAX_STRUCTURES 64
+
+enum {  /* type 241 blobs that the index records */
+  VPD_BLOB_SPD,
+  VPD_BLOB_VPD_2_0,
+  VPD_BLOB_VPD_1_2,
+  VPD_NUM_KNOWN_BLOBS,
+};
+
+struct vpd_structure {
+  uint8_t type;
+  uint8_t length;       /* header and formatted area */
+  uint16_t handle;
+  uint8_t num_strings;
+  uint32_t offset;      /* of the header */
+  uint32_t size;        /* with the strings and the terminator */
+};
+
+struct vpd_table_index {
+  const uint8_t *table;
+  uint32_t len;         /* up to and including type 127 */
+  int count;
+  struct vpd_structure structures[VPD_MAX_STRUCTURES];
+  int blobs[VPD_NUM_KNOWN_BLOBS];  /* structure number, or -1 */
+};
+
+int vpd_index_table(const uint8_t *table, uint32_t len,
+                    struct vpd_table_index *index);
+const char *vpd_structure_string(const struct vpd_table_index *index,
+                                 const struct vpd_structure *structure,
+                                 uint8_t number);
+const struct vpd_table_binary_blob_pointer *vpd_structure_blob(
+    const struct vpd_table_index *index,
+    const struct vpd_structure *structure);
+
+/* Builds a structure table in one buffer. Reserve the total size up front to
+ * build it with a single allocation; appending grows the buffer otherwise.
+ * Handles are numbered from 0 in the order of appending. */
+struct vpd_table_builder {
+  uint8_t *buf;
+  size_t len;       /* bytes of structures in buf */
+  size_t capacity;  /* bytes allocated for buf */
+  uint16_t count;   /* number of structures */
+};
+
+size_t vpd_structure_size(size_t formatted_len, const char *const strings[],
+                          int num_strings);
+int vpd_table_builder_init(struct vpd_table_builder *builder,
+                           size_t capacity);
+int vpd_table_builder_reserve(struct vpd_table_builder *builder,
+                              size_t capacity);
+void vpd_table_builder_free(struct vpd_table_builder *builder);
+void *vpd_table_builder_append(struct vpd_table_builder *builder,
+                               uint8_t type, size_t formatted_len,
+                               const char *const strings[], int num_strings,
+                               uint8_t string_ids[]);
+int vpd_table_builder_add_type127(struct vpd_table_builder *builder);
+int vpd_table_builder_add_type241(struct vpd_table_builder *builder,
+                                  const char *uuid, uint32_t offset,
+                                  uint32_t size, const char *vendor,
+                                  const char *desc, const char *variant);
 
 #endif  /* __LIB_LIB_SMBIOS__ */
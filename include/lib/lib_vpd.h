@@ -9,8 +9,13 @@
 #define __LIB_VPD__
 
 #include <inttypes.h>
+#include <stddef.h>
 #include "vpd_decode.h"
 
+/* Also declared by libvpd/libvpd.h, which must not depend on this header;
+ * keep both the same. */
+#ifndef __VPD_ERR_T__
+#define __VPD_ERR_T__
 enum vpd_err {
    /* These error codes are returned to the shell as exit codes. If they are
     * changed then callers such as Enterprise.VpdCheck from histograms.xml must
@@ -29,14 +34,26 @@ enum vpd_err {
   VPD_ERR_OVERFLOW    = 10,  /* boundary exceeded */
   VPD_ERR_INVALID     = 11,  /* error in VPD - possible corruption or bug */
   VPD_ERR_DECODE      = 12,  /* error when decoding VPD blob */
+  VPD_UNCHANGED       = 13,  /* nothing written, VPD already up to date */
+  VPD_ERR_CONDITION   = 14,  /* a --if/--if-absent condition did not hold */
+  VPD_ERR_BUSY        = 15,  /* timed out waiting for another VPD user */
 };
 
 typedef enum vpd_err vpd_err_t;
+#endif  /* __VPD_ERR_T__ */
 
 enum {
   VPD_AS_LONG_AS = -1,
 };
 
+/* Binary values at least this long are compressed by default, see
+ * packContainer(). */
+#define VPD_COMPRESS_MIN_LEN 128
+
+/* Keys sharing fewer bytes with an earlier key are stored in full, see
+ * encodeContainer(). */
+#define VPD_PREFIX_MIN_LEN 4
+
 enum {  /* export_type */
   VPD_EXPORT_KEY_VALUE = 1,
   VPD_EXPORT_VALUE,
@@ -47,12 +64,25 @@ enum {  /* export_type */
 /* Callback for decodeVpdString to invoke. */
 typedef vpd_decode_callback VpdDecodeCallback;
 
+/* Callback for decodeVpdRecord to invoke. */
+typedef vpd_decode_record_callback VpdDecodeRecordCallback;
+
 /* Container data types */
 struct StringPair {
   uint8_t *key;
-  uint8_t *value;
+  uint8_t *value;  /* NULL until getPairValue() if only packed is known. */
   int pad_len;
   int filter_out;  /* TRUE means not exported. */
+  int type;        /* VPD_TYPE_STRING or VPD_TYPE_BINARY. */
+  int value_len;   /* Bytes in value, which is followed by a '\0' anyway. */
+  /* The value of a VPD_TYPE_COMPRESSED record for a binary value, written
+   * instead of value, or NULL. */
+  uint8_t *packed;
+  int packed_len;
+  /* TRUE to write the key of a string as a VPD_TYPE_PREFIX_STRING record
+   * where that saves space, see encodeContainer(). Set by decoding such a
+   * record and kept when the value is replaced. */
+  int prefix_key;
   struct StringPair *next;
 };
 
@@ -60,6 +90,22 @@ struct PairContainer {
   struct StringPair *first;
 };
 
+/* A set of key patterns, compiled once and matched per entry.
+ *
+ * Exact keys live in an open-addressing hash set so that matching does not
+ * depend on the number of keys. Patterns ending with a single '*' are kept as
+ * plain prefixes; anything else with fnmatch(3) syntax is matched as a glob.
+ */
+struct VpdKeyFilter {
+  char **exact;        /* hash set of exact keys, exact_cap slots */
+  size_t exact_cap;    /* always 0 or a power of 2 */
+  size_t num_exact;
+  char **prefixes;
+  int num_prefixes;
+  char **globs;
+  int num_globs;
+};
+
 
 /***********************************************************************
  * Encode and decode VPD entries
@@ -82,6 +128,21 @@ vpd_err_t encodeLen(
     const int32_t max_len,
     int32_t *encoded_len);
 
+/* Returns the number of bytes encodeLen() generates for len. */
+int encodeLenSize(const uint32_t len);
+
+/* Returns the number of bytes encodeVpdString() generates for a key and a
+ * (padded) value of the given lengths. */
+int encodeVpdStringSize(const int key_len, const int value_len);
+
+/* Returns the number of bytes encodeVpdPrefixString() generates for the
+ * given arguments, a key of key_len bytes and a (padded) value of value_len
+ * bytes. */
+int encodeVpdPrefixStringSize(const uint32_t back,
+                              const int shared_len,
+                              const int key_len,
+                              const int value_len);
+
 /* Given an encoded string, this functions decodes the length field which varies
  * from 1 byte to many bytes.
  *
@@ -97,6 +158,19 @@ vpd_err_t decodeLen(
     uint32_t *length,
     uint32_t *decoded_len);
 
+/* The byte-at-a-time implementations that encodeLen() and decodeLen() use
+ * beyond two bytes, for testing the fast paths against. */
+vpd_err_t encodeLenReference(
+    const int32_t len,
+    uint8_t *encode_buf,
+    const int32_t max_len,
+    int32_t *encoded_len);
+vpd_err_t decodeLenReference(
+    const uint32_t max_len,
+    const uint8_t *in,
+    uint32_t *length,
+    uint32_t *decoded_len);
+
 
 /* Encodes the terminator.
  * When calling, the output_buf should point to the start of buffer while
@@ -137,6 +211,54 @@ vpd_err_t encodeVpdString(
     uint8_t *output_buf,
     int *generated_len);
 
+/* Same as encodeVpdString(), but the record is VPD_TYPE_PREFIX_STRING: its
+ * key leaves out the first shared_len bytes of key, which are the same in the
+ * key of the record back bytes before this one (see vpd_decode.h).
+ */
+vpd_err_t encodeVpdPrefixString(
+    const uint32_t back,
+    const uint8_t *key,
+    const int shared_len,
+    const uint8_t *value,
+    const int pad_value_len,
+    const int max_buffer_len,
+    uint8_t *output_buf,
+    int *generated_len);
+
+/* Encodes a VPD_TYPE_BINARY record of key and value_len bytes of value into
+ * buffer, the same way as encodeVpdString() without padding.
+ */
+vpd_err_t encodeVpdBinary(
+    const uint8_t *key,
+    const uint8_t *value,
+    const int value_len,
+    const int max_buffer_len,
+    uint8_t *output_buf,
+    int *generated_len);
+
+/* Same as encodeVpdBinary(), but the record is VPD_TYPE_COMPRESSED and its
+ * value is packed_len bytes of packed: the length of the binary value encoded
+ * by encodeLen(), followed by the value compressed as an LZ4 block (see
+ * lz4_block.h).
+ */
+vpd_err_t encodeVpdCompressed(
+    const uint8_t *key,
+    const uint8_t *packed,
+    const int packed_len,
+    const int max_buffer_len,
+    uint8_t *output_buf,
+    int *generated_len);
+
+/* Decompresses the value of a VPD_TYPE_COMPRESSED record into a malloc()ed
+ * buffer of *value_len bytes plus a '\0'.
+ * Returns VPD_ERR_DECODE if the value is corrupt.
+ */
+vpd_err_t unpackValue(
+    const uint8_t *packed,
+    const uint32_t packed_len,
+    uint8_t **value,
+    uint32_t *value_len);
+
 
 /* Given the encoded string, this function invokes callback with extracted
  * (key, value). The *consumed will be plused the number of bytes consumed in
@@ -157,6 +279,16 @@ vpd_err_t decodeVpdString(
     VpdDecodeCallback callback,
     void *callback_arg);
 
+/* Same as decodeVpdString(), but the callback also gets the type of the
+ * record.
+ */
+vpd_err_t decodeVpdRecord(
+    const uint32_t max_len,
+    const uint8_t *input_buf,
+    uint32_t *consumed,
+    VpdDecodeRecordCallback callback,
+    void *callback_arg);
+
 /***********************************************************************
  * Container helpers
  ***********************************************************************/
@@ -174,6 +306,25 @@ void setString(struct PairContainer *container,
                const uint8_t *value,
                const int pad_len);
 
+/* Same as setString(), but the value is value_len bytes of binary data that
+ * is encoded as a VPD_TYPE_BINARY record.
+ */
+void setBinary(struct PairContainer *container,
+               const uint8_t *key,
+               const uint8_t *value,
+               const int value_len);
+
+/* Returns the value of pair, decompressing (and keeping) it first if only
+ * the packed value is known. Returns NULL if that is corrupt.
+ */
+const uint8_t *getPairValue(const struct StringPair *pair);
+
+/* Compresses the binary values of at least min_len bytes in container that
+ * get smaller, unless they are compressed already. A min_len of 0 compresses
+ * nothing.
+ */
+void packContainer(struct PairContainer *container, const int min_len);
+
 /* merge all entries in src into dst. If key is duplicate, overwrite it.
  */
 void mergeContainer(struct PairContainer *dst,
@@ -184,7 +335,30 @@ void mergeContainer(struct PairContainer *dst,
 int subtractContainer(struct PairContainer *dst,
                       const struct PairContainer *src);
 
+/* Checks conditions against container: every pair in present must be in
+ * container with the same value, and no key in absent may be in container.
+ * Returns VPD_OK if all hold. Otherwise returns VPD_ERR_CONDITION and, if
+ * failed_key is not NULL, points it to the first key that failed.
+ */
+vpd_err_t checkContainer(struct PairContainer *container,
+                         const struct PairContainer *present,
+                         const struct PairContainer *absent,
+                         const uint8_t **failed_key);
+
+/* Returns the number of bytes encodeContainer() generates for container.
+ */
+int encodeContainerSize(const struct PairContainer *container);
+
 /* Given a container, encode its all entries into the buffer.
+ *
+ * Binary values are encoded after all strings, so that readers which stop at
+ * the first record type they do not know still find every string.
+ *
+ * A string with prefix_key set whose key shares at least VPD_PREFIX_MIN_LEN
+ * bytes with the full key of an earlier string is encoded as a
+ * VPD_TYPE_PREFIX_STRING record pointing back at the string sharing the most.
+ * Those come after the strings with full keys, which older readers still
+ * find.
  */
 vpd_err_t encodeContainer(const struct PairContainer *container,
                           const int max_buf_len,
@@ -198,12 +372,30 @@ vpd_err_t decodeToContainer(struct PairContainer *container,
                             const uint8_t *input_buf,
                             uint32_t *consumed);
 
+/* Given a VPD blob, decode its entries and push into container, skipping
+ * entries whose key does not match the filter. The skipped entries are never
+ * copied. If filter is NULL, behaves like decodeToContainer().
+ */
+vpd_err_t decodeToContainerFiltered(struct PairContainer *container,
+                                    const struct VpdKeyFilter *filter,
+                                    const uint32_t max_len,
+                                    const uint8_t *input_buf,
+                                    uint32_t *consumed);
+
 /* Set filter for exporting functions.
+ * The filter string is a single key that is matched exactly; use
+ * setContainerKeyFilter() for patterns.
  * If filter is NULL, resets the filter so that everything can be exported.
  */
 vpd_err_t setContainerFilter(struct PairContainer *container,
                              const uint8_t *filter);
 
+/* Same as setContainerFilter(), but with a compiled key filter.
+ * If filter is NULL or empty, everything can be exported.
+ */
+vpd_err_t setContainerKeyFilter(struct PairContainer *container,
+                                const struct VpdKeyFilter *filter);
+
 /*
  * Remove a key.
  * Returns VPD_OK if deleted successfully. Otherwise, VPD_FAIL.
@@ -218,7 +410,8 @@ int lenOfContainer(const struct PairContainer *container);
 
 
 /*
- * Export the value in raw format.
+ * Export the value in raw format. Binary values are exported as they are;
+ * the text formats below export them in base64.
  *
  * The buf points to the first byte of buffer and *generated contains the number
  * of bytes already existed in buffer.
@@ -231,6 +424,28 @@ vpd_err_t exportStringValue(const struct StringPair *str,
                             uint8_t *buf,
                             int *generated);
 
+/*
+ * Export the result of looking up a key, as one record of:
+ *
+ *   +<key>=<value>   if str is not NULL (the key was found), or
+ *   -<key>           if str is NULL (the key is missing).
+ *
+ * Each record ends with '\n', or '\0' if export_type is
+ * VPD_EXPORT_NULL_TERMINATE.
+ *
+ * The buf points to the first byte of buffer and *generated contains the number
+ * of bytes already existed in buffer.
+ *
+ * Afterward, the *generated will be plused on exact bytes this function has
+ * generated.
+ */
+vpd_err_t exportLookupResult(const int export_type,
+                             const uint8_t *key,
+                             const struct StringPair *str,
+                             const int max_buf_len,
+                             uint8_t *buf,
+                             int *generated);
+
 /*
  * Export the container content with human-readable text.
  *
@@ -248,4 +463,36 @@ vpd_err_t exportContainer(const int export_type,
 
 void destroyContainer(struct PairContainer *container);
 
+/***********************************************************************
+ * Key filter helpers
+ ***********************************************************************/
+void initKeyFilter(struct VpdKeyFilter *filter);
+
+/* Adds one pattern of len bytes to the filter. A pattern is either an exact
+ * key, a prefix followed by '*', or a fnmatch(3) glob.
+ */
+vpd_err_t addKeyFilterPattern(struct VpdKeyFilter *filter,
+                              const char *pattern,
+                              size_t len);
+
+/* Adds a key of len bytes that only matches itself, even if it contains
+ * wildcard characters.
+ */
+vpd_err_t addKeyFilterKey(struct VpdKeyFilter *filter,
+                          const char *key,
+                          size_t len);
+
+/* Adds a list of patterns separated by commas or whitespace. */
+vpd_err_t addKeyFilterList(struct VpdKeyFilter *filter, const char *list);
+
+/* Returns non-zero if no pattern has been added. */
+int isKeyFilterEmpty(const struct VpdKeyFilter *filter);
+
+/* Returns non-zero if the key (not NULL-terminated) matches any pattern. */
+int matchKeyFilter(const struct VpdKeyFilter *filter,
+                   const uint8_t *key,
+                   uint32_t key_len);
+
+void destroyKeyFilter(struct VpdKeyFilter *filter);
+
 #endif  /* __LIB_VPD__ */
@@ -0,0 +1,41 @@
+/*
+ * Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * The LZ4 block format, without the frame around it: a sequence of literal
+ * runs and matches of at least 4 bytes up to 64KiB back. Small enough to
+ * keep vpd free of library dependencies, and decompressing needs no memory
+ * but the output.
+ */
+
+#ifndef __LIB_LZ4_BLOCK_H__
+#define __LIB_LZ4_BLOCK_H__
+
+#include <inttypes.h>
+#include <stddef.h>
+#include "lib_vpd.h"
+
+/*
+ * Compresses len bytes of in into at most max_out_len bytes at out.
+ *
+ * Returns the compressed length, or 0 if it does not fit; out may have been
+ * written either way.
+ */
+size_t lz4CompressBlock(const uint8_t *in,
+                        size_t len,
+                        uint8_t *out,
+                        size_t max_out_len);
+
+/*
+ * Decompresses the block of len bytes at in into exactly out_len bytes at
+ * out.
+ *
+ * Returns VPD_ERR_DECODE if the block is corrupt or its size is not out_len.
+ */
+vpd_err_t lz4DecompressBlock(const uint8_t *in,
+                             size_t len,
+                             uint8_t *out,
+                             size_t out_len);
+
+#endif  /* __LIB_LZ4_BLOCK_H__ */
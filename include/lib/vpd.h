@@ -51,5 +51,7 @@ enum vpd_types {
 
 #define CONFIG_EPS_VPD_MAJOR_VERSION 2
 #define CONFIG_EPS_VPD_MINOR_VERSION 6
+#define CONFIG_EPS3_VPD_MAJOR_VERSION 3
+#define CONFIG_EPS3_VPD_MINOR_VERSION 0
 
 #endif /* __LIB_VPD_H__ */
@@ -0,0 +1,124 @@
+/*
+ * Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Binary VPD cache.
+ *
+ * A snapshot of both VPD partitions that readers can mmap() and search
+ * without parsing. All integers are little-endian; all offsets are from the
+ * start of the file.
+ *
+ *   struct vpd_cache_header
+ *   struct vpd_cache_entry[]  RO_VPD index, sorted by key (memcmp order)
+ *   struct vpd_cache_entry[]  RW_VPD index, sorted by key
+ *   data                      "key\0value\0" for every entry, RO then RW,
+ *                             in index order
+ *
+ * The checksum is the CRC-32 (as in zlib) of everything after the header.
+ * Values may contain any bytes; the '\0' after each key and value is only
+ * there so that they can be used as C strings.
+ */
+
+#ifndef __LIB_VPD_CACHE_H__
+#define __LIB_VPD_CACHE_H__
+
+#include <inttypes.h>
+#include <stddef.h>
+#include "lib_vpd.h"
+
+#define VPD_CACHE_MAGIC "VPDCACHE"
+#define VPD_CACHE_VERSION 2
+
+enum {
+  VPD_CACHE_RO = 0,
+  VPD_CACHE_RW = 1,
+  VPD_CACHE_NUM_SECTIONS,
+};
+
+struct vpd_cache_section {
+  uint32_t num_entries;
+  uint32_t index_offset;  /* of the first struct vpd_cache_entry */
+} __attribute__((packed));
+
+struct vpd_cache_header {
+  uint8_t magic[8];       /* VPD_CACHE_MAGIC, not NUL terminated */
+  uint32_t version;       /* VPD_CACHE_VERSION */
+  uint32_t size;          /* of the whole file */
+  uint64_t generation;    /* increased on every update of the VPD */
+  uint32_t checksum;
+  uint32_t reserved;
+  struct vpd_cache_section sections[VPD_CACHE_NUM_SECTIONS];
+} __attribute__((packed));
+
+struct vpd_cache_entry {
+  uint32_t key_offset;
+  uint32_t key_len;       /* without the trailing '\0' */
+  uint32_t value_offset;
+  uint32_t value_len;     /* without the trailing '\0' */
+  uint32_t type;          /* VPD_TYPE_STRING or VPD_TYPE_BINARY */
+} __attribute__((packed));
+
+/* A mapped cache file. */
+struct VpdCache {
+  const uint8_t *data;
+  size_t size;
+};
+
+/*
+ * Maps the cache at path and checks its header, bounds and checksum.
+ *
+ * Returns VPD_OK, VPD_ERR_NOT_FOUND if the file does not exist, VPD_ERR_INVALID
+ * if it is not a valid cache, or VPD_ERR_SYSTEM.
+ */
+vpd_err_t openVpdCache(struct VpdCache *cache, const char *path);
+
+/* Unmaps the cache. Safe to call on a cache that failed to open. */
+void closeVpdCache(struct VpdCache *cache);
+
+/* Returns the generation of an opened cache. */
+uint64_t getVpdCacheGeneration(const struct VpdCache *cache);
+
+/*
+ * Reads only the generation from the header of the cache at path, without
+ * mapping or checking the rest, so that readers holding data from the cache
+ * can cheaply tell whether it changed. Returns the same errors as
+ * openVpdCache(), except that the checksum is not verified.
+ */
+vpd_err_t readVpdCacheGeneration(const char *path, uint64_t *generation);
+
+/* Returns the number of entries in section (VPD_CACHE_RO or VPD_CACHE_RW). */
+uint32_t getVpdCacheCount(const struct VpdCache *cache, int section);
+
+/*
+ * Returns the index-th entry of section, in key order. key and value point
+ * into the mapping and stay valid until closeVpdCache().
+ */
+void getVpdCacheEntry(const struct VpdCache *cache,
+                      int section,
+                      uint32_t index,
+                      const char **key,
+                      const uint8_t **value,
+                      uint32_t *value_len,
+                      int *type);
+
+/*
+ * Looks up key in section with a binary search.
+ * Returns VPD_OK and sets value and value_len, or VPD_FAIL if not found.
+ */
+vpd_err_t lookupVpdCache(const struct VpdCache *cache,
+                         int section,
+                         const char *key,
+                         const uint8_t **value,
+                         uint32_t *value_len);
+
+/*
+ * Writes ro and rw as a cache with the given generation to path, replacing it
+ * atomically. Either container may be NULL for an empty section.
+ */
+vpd_err_t writeVpdCache(const char *path,
+                        uint64_t generation,
+                        const struct PairContainer *ro,
+                        const struct PairContainer *rw);
+
+#endif  /* __LIB_VPD_CACHE_H__ */
@@ -27,6 +27,9 @@ enum {
 enum {
 	VPD_TYPE_TERMINATOR = 0,
 	VPD_TYPE_STRING,
+	VPD_TYPE_BINARY,
+	VPD_TYPE_COMPRESSED,
+	VPD_TYPE_PREFIX_STRING,
 	VPD_TYPE_INFO = 0xfe,
 	VPD_TYPE_IMPLICIT_TERMINATOR = 0xff,
 };
@@ -55,4 +58,34 @@ int vpd_decode_string(
 		const u32 max_len, const u8 *input_buf, u32 *consumed,
 		vpd_decode_callback callback, void *callback_arg);
 
+/*
+ * Callback for vpd_decode_record to invoke, with the type of the record. The
+ * key is key_prefix_len bytes of key_prefix followed by key_len bytes of key.
+ */
+typedef int vpd_decode_record_callback(
+		u8 type, const u8 *key_prefix, u32 key_prefix_len,
+		const u8 *key, u32 key_len, const u8 *value, u32 value_len,
+		void *arg);
+
+/*
+ * vpd_decode_record
+ *
+ * Same as vpd_decode_string, but also tells the callback whether the value is
+ * a string (VPD_TYPE_STRING), raw bytes (VPD_TYPE_BINARY), raw bytes
+ * compressed as described in lib_vpd.h (VPD_TYPE_COMPRESSED) or a string
+ * whose key starts like the key of an earlier record (VPD_TYPE_PREFIX_STRING).
+ *
+ * The key of a VPD_TYPE_PREFIX_STRING record holds the distance in bytes from
+ * the start of the record back to the start of a record with a full key, the
+ * number of bytes its key shares with that key, both encoded like lengths,
+ * and the rest of its key. The callback gets the shared bytes as key_prefix;
+ * key_prefix_len is 0 for the other types.
+ *
+ * vpd_decode_string passes the first two types as they are and skips the
+ * others.
+ */
+int vpd_decode_record(
+		const u32 max_len, const u8 *input_buf, u32 *consumed,
+		vpd_decode_record_callback callback, void *callback_arg);
+
 #endif  /* __VPD_DECODE_H */
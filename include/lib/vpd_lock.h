@@ -0,0 +1,54 @@
+/*
+ * Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Cross-process locking around flash access.
+ *
+ * Everything that reads or writes the VPD partitions through flashrom takes
+ * VPD_LOCK_FILE with flock(2): shared to read, exclusive to read-modify-write.
+ * To keep a stream of readers from starving writers, every locker first
+ * passes VPD_LOCK_GATE_FILE (exclusive), and only releases it once it holds
+ * VPD_LOCK_FILE. A waiting writer therefore holds the gate and stops new
+ * readers until the current ones are done.
+ *
+ * Shell scripts follow the same protocol with flock(1). A process that holds
+ * the lock sets VPD_LOCK_HELD_ENV in the environment of its children, so that
+ * the vpd it runs does not wait for its own lock.
+ */
+
+#ifndef __LIB_VPD_LOCK_H__
+#define __LIB_VPD_LOCK_H__
+
+#include "lib_vpd.h"
+
+#define VPD_LOCK_DIR "/run/lock"
+#define VPD_LOCK_FILE "vpd.lock"
+#define VPD_LOCK_GATE_FILE "vpd.gate"
+
+/* Environment variable to override VPD_LOCK_DIR. */
+#define VPD_LOCK_DIR_ENV "VPD_LOCK_DIR"
+/* Set (to anything) if the parent process already holds the lock. */
+#define VPD_LOCK_HELD_ENV "VPD_LOCK_HELD"
+/* Environment variable to override VPD_LOCK_TIMEOUT_SEC. */
+#define VPD_LOCK_TIMEOUT_ENV "VPD_LOCK_TIMEOUT"
+/* A flash write can take several seconds; give up after a few of them. */
+#define VPD_LOCK_TIMEOUT_SEC 60
+
+struct VpdLock {
+  int fd;  /* -1 if not locked */
+};
+
+/*
+ * Takes the lock, shared or exclusive, waiting up to timeout_sec (or the value
+ * from VPD_LOCK_TIMEOUT_ENV if timeout_sec < 0).
+ *
+ * Returns VPD_OK on success or if VPD_LOCK_HELD_ENV is set, VPD_ERR_BUSY if
+ * the lock could not be taken in time, or VPD_ERR_SYSTEM.
+ */
+vpd_err_t vpdLock(struct VpdLock *lock, int exclusive, int timeout_sec);
+
+/* Releases the lock. Safe to call on an unlocked VpdLock. */
+void vpdUnlock(struct VpdLock *lock);
+
+#endif  /* __LIB_VPD_LOCK_H__ */
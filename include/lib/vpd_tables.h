@@ -12,6 +12,7 @@
 #include <inttypes.h>
 
 #define VPD_ENTRY_MAGIC    "_SM_"
+#define VPD_ENTRY3_MAGIC   "_SM3_"
 #define VPD_INFO_MAGIC     \
   "\xfe"      /* type: VPD header */       \
   "\x09"      /* key length, 9 = 1 + 8 */  \
@@ -52,6 +53,20 @@ struct vpd_entry {
   uint8_t bcd_revision;
 } __attribute__ ((packed));
 
+/* SMBIOS 3.0 64-bit entry point */
+struct vpd_entry3 {
+  uint8_t anchor_string[5];
+  uint8_t entry_cksum;
+  uint8_t entry_length;
+  uint8_t major_ver;
+  uint8_t minor_ver;
+  uint8_t docrev;
+  uint8_t entry_rev;
+  uint8_t reserved;
+  uint32_t table_max_size;
+  uint64_t table_address;
+} __attribute__ ((packed));
+
 /* Header */
 struct vpd_header {
   uint8_t type;
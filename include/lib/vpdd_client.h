@@ -0,0 +1,64 @@
+/*
+ * Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Client side of the vpdd protocol.
+ *
+ * vpdd keeps RO_VPD and RW_VPD decoded in memory and serves them over a Unix
+ * stream socket. Each request is one line:
+ *
+ *   GET <region> <key>
+ *   LIST <region>
+ *   SET <region> <key>=<value>
+ *   DELETE <region> <key>
+ *   SYNC
+ *   RELOAD
+ *
+ * and each response is a header line "<vpd_err_t> <length>" followed by
+ * <length> bytes of payload: the raw value for GET, and "key=value\0" records
+ * for LIST, with binary values in base64 as in vpd -l. SET and DELETE are
+ * answered once the change has been written to flash, RELOAD once the
+ * partitions have been loaded again. Several requests can be sent on the same
+ * connection; consecutive SET/DELETE requests sent without waiting for the
+ * replies go into the same commit.
+ */
+
+#ifndef __LIB_VPDD_CLIENT_H__
+#define __LIB_VPDD_CLIENT_H__
+
+#include <inttypes.h>
+#include "lib_vpd.h"
+
+#define VPDD_SOCKET_PATH "/run/vpdd/vpdd.sock"
+/* Environment variable to override VPDD_SOCKET_PATH. */
+#define VPDD_SOCKET_ENV "VPDD_SOCKET"
+
+/* Returns the socket path, either from VPDD_SOCKET_ENV or the default. */
+const char *vpddSocketPath(void);
+
+/* Connects to vpdd. Returns the socket fd, or -1 if vpdd is not running. */
+int vpddConnect(const char *socket_path);
+
+/*
+ * Sends one request line (without the trailing newline) on fd and waits for
+ * the response. On return, *response points to a malloc()ed buffer of
+ * *response_len bytes plus a terminating '\0', which the caller must free.
+ *
+ * Returns the status sent by vpdd, or VPD_ERR_SYSTEM if the connection failed.
+ */
+vpd_err_t vpddRequest(int fd,
+                      const char *request,
+                      uint8_t **response,
+                      uint32_t *response_len);
+
+/* Sends one request line (without the trailing newline) on fd. */
+vpd_err_t vpddSendRequest(int fd, const char *request);
+
+/*
+ * Reads the response to the oldest request sent on fd that has not been
+ * answered yet. *response is the same as in vpddRequest().
+ */
+vpd_err_t vpddReadResponse(int fd, uint8_t **response, uint32_t *response_len);
+
+#endif  /* __LIB_VPDD_CLIENT_H__ */
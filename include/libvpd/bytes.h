@@ -0,0 +1,75 @@
+/*
+ * Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Fixed-size byte arrays for the structures that are built at compile time,
+ * see smbios_tables.h and vpd_encoding.h.
+ */
+
+#ifndef __LIBVPD_BYTES_H__
+#define __LIBVPD_BYTES_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace libvpd {
+
+/* A byte array that can be filled in constant expressions. */
+template <size_t N>
+struct Bytes {
+  uint8_t data[N] = {};
+
+  static constexpr size_t size() { return N; }
+
+  constexpr void put8(size_t offset, uint8_t value) { data[offset] = value; }
+  constexpr void put16(size_t offset, uint16_t value) {
+    put8(offset, value & 0xff);
+    put8(offset + 1, value >> 8);
+  }
+  constexpr void put32(size_t offset, uint32_t value) {
+    put16(offset, value & 0xffff);
+    put16(offset + 2, value >> 16);
+  }
+  template <size_t M>
+  constexpr void putBytes(size_t offset, const Bytes<M>& bytes) {
+    for (size_t i = 0; i < M; i++)
+      data[offset + i] = bytes.data[i];
+  }
+  /* Copies a string literal with its terminating NUL. */
+  template <size_t M>
+  constexpr void putString(size_t offset, const char (&str)[M]) {
+    for (size_t i = 0; i < M; i++)
+      data[offset + i] = str[i];
+  }
+  /* Copies a string literal without its terminating NUL. */
+  template <size_t M>
+  constexpr void putChars(size_t offset, const char (&str)[M]) {
+    for (size_t i = 0; i + 1 < M; i++)
+      data[offset + i] = str[i];
+  }
+
+  /* Compares with a string literal (without its NUL), for static_assert. */
+  template <size_t M>
+  constexpr bool equals(const char (&str)[M]) const {
+    if (M - 1 != N)
+      return false;
+    for (size_t i = 0; i < N; i++) {
+      if (data[i] != static_cast<uint8_t>(str[i]))
+        return false;
+    }
+    return true;
+  }
+};
+
+template <size_t A, size_t B>
+constexpr Bytes<A + B> concat(const Bytes<A>& a, const Bytes<B>& b) {
+  Bytes<A + B> out;
+  out.putBytes(0, a);
+  out.putBytes(A, b);
+  return out;
+}
+
+}  // namespace libvpd
+
+#endif  /* __LIBVPD_BYTES_H__ */
@@ -0,0 +1,115 @@
+/*
+ * Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * libvpd - reads and writes VPD in-process, without running the vpd utility.
+ *
+ *   auto vpd = libvpd::Vpd::OpenFlash();
+ *   std::optional<std::string> serial =
+ *       vpd->Get(libvpd::Partition::kRo, "serial_number");
+ *
+ * Partitions are read and decoded on first use. Changes are kept in memory
+ * until Commit(), which writes each modified partition once, skips writes
+ * that would not change it, and updates the VPD caches like vpd does.
+ *
+ * Errors are the vpd_err_t codes of the vpd utility, which are also its exit
+ * codes. A Vpd object is not thread-safe.
+ */
+
+#ifndef __LIBVPD_LIBVPD_H__
+#define __LIBVPD_LIBVPD_H__
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/* The same as in lib/lib_vpd.h, which is not installed. */
+#ifndef __VPD_ERR_T__
+#define __VPD_ERR_T__
+enum vpd_err {
+  VPD_OK              = 0,
+  VPD_FAIL            = 3,   /* generic vpd utility error */
+  VPD_ERR_SYSTEM      = 4,   /* system error (file error, out of memory, etc) */
+  VPD_ERR_ROM_READ    = 5,   /* error reading ROM (e.g. thru flashrom) */
+  VPD_ERR_ROM_WRITE   = 6,   /* error writing ROM (e.g. thru flashrom) */
+  VPD_ERR_SYNTAX      = 7,   /* command syntax error */
+  VPD_ERR_PARAM       = 8,   /* invalid parameter specified by user */
+  VPD_ERR_NOT_FOUND   = 9,   /* VPD not found */
+  VPD_ERR_OVERFLOW    = 10,  /* boundary exceeded */
+  VPD_ERR_INVALID     = 11,  /* error in VPD - possible corruption or bug */
+  VPD_ERR_DECODE      = 12,  /* error when decoding VPD blob */
+  VPD_UNCHANGED       = 13,  /* nothing written, VPD already up to date */
+  VPD_ERR_CONDITION   = 14,  /* a --if/--if-absent condition did not hold */
+  VPD_ERR_BUSY        = 15,  /* timed out waiting for another VPD user */
+};
+
+typedef enum vpd_err vpd_err_t;
+#endif  /* __VPD_ERR_T__ */
+
+namespace libvpd {
+
+struct VpdRegion;
+
+enum class Partition {
+  kRo, /* RO_VPD */
+  kRw, /* RW_VPD */
+};
+
+class Vpd {
+ public:
+  /* Opens the flash. If writable, the VPD lock (see lib/vpd_lock.h) is held
+   * exclusively until the object is destroyed, so that nobody else can
+   * change the VPD between reading and Commit(). Otherwise it is only held,
+   * shared, while a partition is read. Returns NULL if the lock cannot be
+   * taken. */
+  static std::unique_ptr<Vpd> OpenFlash(bool writable = false);
+
+  /* Opens an image file, as vpd -f does. */
+  static std::unique_ptr<Vpd> OpenImage(std::string path);
+
+  Vpd(const Vpd&) = delete;
+  Vpd& operator=(const Vpd&) = delete;
+  ~Vpd();
+
+  /* Reads and decodes partition unless that was done already. The other
+   * methods call this implicitly; it is only needed to get the error. */
+  vpd_err_t Load(Partition partition);
+
+  /* Returns the value of key, or std::nullopt if it does not exist or the
+   * partition cannot be loaded. Binary values are returned as raw bytes. */
+  std::optional<std::string> Get(Partition partition, std::string_view key);
+
+  /* Returns all keys and values of partition in VPD order. */
+  vpd_err_t List(Partition partition,
+                 std::vector<std::pair<std::string, std::string>>* pairs);
+
+  /* Sets key to value. The partition keeps its own copies of both. Returns
+   * VPD_ERR_PARAM if key is empty or either contains a '\0'. */
+  vpd_err_t Set(Partition partition, std::string key, std::string value);
+
+  /* Deletes key. Returns VPD_FAIL if it does not exist. */
+  vpd_err_t Delete(Partition partition, std::string_view key);
+
+  /* Writes back the modified partitions. Returns VPD_OK if there was
+   * nothing to write. */
+  vpd_err_t Commit();
+
+ private:
+  Vpd(std::string path, bool writable);
+
+  VpdRegion* Region(Partition partition);
+
+  /* The image file, or empty for the flash. */
+  const std::string path_;
+  const bool writable_;
+  int lock_fd_ = -1;
+  std::unique_ptr<VpdRegion> regions_[2];
+};
+
+}  // namespace libvpd
+
+#endif  /* __LIBVPD_LIBVPD_H__ */
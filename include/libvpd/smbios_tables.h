@@ -0,0 +1,151 @@
+/*
+ * Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * The SMBIOS EPS and structure tables in front of a VPD partition, built at
+ * compile time. Everything but the base address, the blob sizes and the
+ * checksums is fixed by the GOOGLE_* constants, so the layout is a constant
+ * and writing it is a memcpy() plus a few patched fields. There is one layout
+ * for each entry point: SMBIOS 2.x "_SM_" and 3.0 "_SM3_".
+ *
+ * The bytes are those of vpd_create_eps() and the vpd_table_builder in
+ * lib/lib_smbios.c; libvpd_test compares the structure table with the
+ * builder's.
+ */
+
+#ifndef __LIBVPD_SMBIOS_TABLES_H__
+#define __LIBVPD_SMBIOS_TABLES_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+extern "C" {
+#include "lib/vpd.h"
+#include "lib/vpd_tables.h"
+};
+
+#include "libvpd/bytes.h"
+
+namespace libvpd {
+namespace smbios {
+
+constexpr uint8_t hexDigit(char c) {
+  return c >= '0' && c <= '9' ? c - '0'
+         : c >= 'a' && c <= 'f' ? c - 'a' + 10
+         : c - 'A' + 10;
+}
+
+/* Parses a UUID string into the bytes uuid_parse() produces. */
+constexpr Bytes<16> parseUuid(const char (&str)[37]) {
+  Bytes<16> uuid;
+  for (size_t in = 0, out = 0; out < 16; out++) {
+    if (str[in] == '-')
+      in++;
+    uuid.put8(out, hexDigit(str[in]) << 4 | hexDigit(str[in + 1]));
+    in += 2;
+  }
+  return uuid;
+}
+
+/* Type 241, binary blob pointer, with offset and size left 0. */
+constexpr size_t kType241Length =
+    sizeof(struct vpd_header) + sizeof(struct vpd_table_binary_blob_pointer);
+
+template <size_t V, size_t D, size_t R>
+constexpr Bytes<kType241Length + V + D + R + 1> type241(
+    uint16_t handle,
+    const char (&uuid)[37],
+    const char (&vendor)[V],
+    const char (&desc)[D],
+    const char (&variant)[R]) {
+  constexpr size_t kData = sizeof(struct vpd_header);
+  using Blob = struct vpd_table_binary_blob_pointer;
+  Bytes<kType241Length + V + D + R + 1> t;
+
+  t.put8(offsetof(struct vpd_header, type), VPD_TYPE_BINARY_BLOB_POINTER);
+  t.put8(offsetof(struct vpd_header, length), kType241Length);
+  t.put16(offsetof(struct vpd_header, handle), handle);
+  t.put8(kData + offsetof(Blob, struct_major_version), 1);
+  t.put8(kData + offsetof(Blob, struct_minor_version), 0);
+  t.put8(kData + offsetof(Blob, vendor), 1);
+  t.put8(kData + offsetof(Blob, description), 2);
+  t.put8(kData + offsetof(Blob, major_version), 2);
+  t.put8(kData + offsetof(Blob, minor_version), 0);
+  t.put8(kData + offsetof(Blob, variant), 3);
+  t.putBytes(kData + offsetof(Blob, uuid), parseUuid(uuid));
+  t.putString(kType241Length, vendor);
+  t.putString(kType241Length + V, desc);
+  t.putString(kType241Length + V + D, variant);
+  /* The last byte stays 0, the structure terminator. */
+  return t;
+}
+
+/* Type 127, end of table. */
+constexpr Bytes<sizeof(struct vpd_table_eot) + 2> type127(uint16_t handle) {
+  Bytes<sizeof(struct vpd_table_eot) + 2> t;
+  t.put8(offsetof(struct vpd_header, type), VPD_TYPE_END);
+  t.put8(offsetof(struct vpd_header, length), sizeof(struct vpd_table_eot));
+  t.put16(offsetof(struct vpd_header, handle), handle);
+  return t;
+}
+
+/* The entry point, with table_address and the checksums left 0. */
+constexpr Bytes<sizeof(struct vpd_entry)> eps(uint16_t table_length,
+                                              uint16_t num_structures) {
+  Bytes<sizeof(struct vpd_entry)> t;
+  t.putBytes(offsetof(struct vpd_entry, anchor_string),
+             Bytes<4>{{'_', 'S', 'M', '_'}});
+  t.put8(offsetof(struct vpd_entry, entry_length), sizeof(struct vpd_entry));
+  t.put8(offsetof(struct vpd_entry, major_ver), CONFIG_EPS_VPD_MAJOR_VERSION);
+  t.put8(offsetof(struct vpd_entry, minor_ver), CONFIG_EPS_VPD_MINOR_VERSION);
+  t.putBytes(offsetof(struct vpd_entry, inter_anchor_string),
+             Bytes<5>{{'_', 'D', 'M', 'I', '_'}});
+  t.put16(offsetof(struct vpd_entry, table_length), table_length);
+  t.put16(offsetof(struct vpd_entry, table_entry_count), num_structures);
+  t.put8(offsetof(struct vpd_entry, bcd_revision),
+         CONFIG_EPS_VPD_MAJOR_VERSION << 4 | CONFIG_EPS_VPD_MINOR_VERSION);
+  return t;
+}
+
+/* The 3.0 entry point, with table_address and the checksum left 0. */
+constexpr Bytes<sizeof(struct vpd_entry3)> eps3(uint32_t table_max_size) {
+  Bytes<sizeof(struct vpd_entry3)> t;
+  t.putBytes(offsetof(struct vpd_entry3, anchor_string),
+             Bytes<5>{{'_', 'S', 'M', '3', '_'}});
+  t.put8(offsetof(struct vpd_entry3, entry_length), sizeof(struct vpd_entry3));
+  t.put8(offsetof(struct vpd_entry3, major_ver), CONFIG_EPS3_VPD_MAJOR_VERSION);
+  t.put8(offsetof(struct vpd_entry3, minor_ver), CONFIG_EPS3_VPD_MINOR_VERSION);
+  t.put8(offsetof(struct vpd_entry3, entry_rev), 1);
+  t.put32(offsetof(struct vpd_entry3, table_max_size), table_max_size);
+  return t;
+}
+
+/* What the vpd utility writes: SPD and VPD 2.0 pointers, then the end. */
+constexpr auto kSpdTable =
+    type241(0, GOOGLE_SPD_UUID, GOOGLE_SPD_VENDOR, GOOGLE_SPD_DESCRIPTION,
+            GOOGLE_SPD_VARIANT);
+constexpr auto kVpd20Table =
+    type241(1, GOOGLE_VPD_2_0_UUID, GOOGLE_VPD_2_0_VENDOR,
+            GOOGLE_VPD_2_0_DESCRIPTION, GOOGLE_VPD_2_0_VARIANT);
+constexpr auto kStructureTable = concat(concat(kSpdTable, kVpd20Table),
+                                        type127(2));
+static_assert(kStructureTable.size() <= UINT16_MAX,
+              "EPS table_length is 16 bits");
+
+constexpr auto kEpsAndTables =
+    concat(eps(kStructureTable.size(), 3), kStructureTable);
+constexpr auto kEps3AndTables =
+    concat(eps3(kStructureTable.size()), kStructureTable);
+
+/* Where buildEpsAndTables() finds the tables to patch, after the EPS. */
+constexpr size_t kSpdTableStart = 0;
+constexpr size_t kVpd20TableStart = kSpdTableStart + kSpdTable.size();
+static_assert(kEpsAndTables.size() <= GOOGLE_SPD_OFFSET &&
+                  kEps3AndTables.size() <= GOOGLE_SPD_OFFSET,
+              "The tables must end before the SPD");
+
+}  // namespace smbios
+}  // namespace libvpd
+
+#endif  /* __LIBVPD_SMBIOS_TABLES_H__ */
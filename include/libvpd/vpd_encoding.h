@@ -0,0 +1,106 @@
+/*
+ * Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Compile-time versions of encodeLen() and encodeVpdString() in
+ * lib/vpd_encode.c, producing the same bytes. Records that never change are
+ * encoded once by the compiler, so writing them is a memcpy().
+ *
+ *   constexpr auto kRecord = encoding::encodeString("region", "us");
+ *   memcpy(out, kRecord.data, kRecord.size());
+ */
+
+#ifndef __LIBVPD_VPD_ENCODING_H__
+#define __LIBVPD_VPD_ENCODING_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+extern "C" {
+#include "lib/lib_vpd.h"
+#include "lib/vpd_tables.h"
+};
+
+#include "libvpd/bytes.h"
+
+namespace libvpd {
+namespace encoding {
+
+/* Number of bytes encodeLen() generates for len. */
+constexpr size_t lenSize(uint32_t len) {
+  size_t size = 1;
+  while (len >>= 7)
+    size++;
+  return size;
+}
+
+/* encodeLen(): 7 bits per byte, most significant first, with the MORE bit
+ * set in all but the last byte. */
+template <uint32_t Len>
+constexpr Bytes<lenSize(Len)> encodeLen() {
+  Bytes<lenSize(Len)> out;
+  uint32_t len = Len;
+  for (size_t i = out.size(); i > 0; i--) {
+    out.put8(i - 1, (len & 0x7f) | (i == out.size() ? 0 : 0x80));
+    len >>= 7;
+  }
+  return out;
+}
+
+/* The type, key length and key that start a record. */
+template <size_t K>
+constexpr Bytes<1 + lenSize(K - 1) + K - 1> encodeKey(uint8_t type,
+                                                       const char (&key)[K]) {
+  Bytes<1 + lenSize(K - 1) + K - 1> out;
+  out.put8(0, type);
+  out.putBytes(1, encodeLen<K - 1>());
+  out.putChars(1 + lenSize(K - 1), key);
+  return out;
+}
+
+/* Length of the value of encodeVpdString() with pad_value_len Pad. */
+constexpr size_t paddedLen(int pad, size_t value_len) {
+  return pad == VPD_AS_LONG_AS ? value_len : pad;
+}
+
+/* encodeVpdString(): a string record, with the value cut or zero-padded to
+ * Pad bytes unless Pad is VPD_AS_LONG_AS. */
+template <int Pad = VPD_AS_LONG_AS, size_t K, size_t V>
+constexpr auto encodeString(const char (&key)[K], const char (&value)[V]) {
+  constexpr size_t kLen = paddedLen(Pad, V - 1);
+  constexpr size_t kPrefixLen = 1 + lenSize(K - 1) + K - 1 + lenSize(kLen);
+  Bytes<kPrefixLen + kLen> out;
+  out.putBytes(0, concat(encodeKey(VPD_TYPE_STRING, key), encodeLen<kLen>()));
+  for (size_t i = 0; i < kLen && i < V - 1; i++)
+    out.put8(kPrefixLen + i, value[i]);
+  return out;
+}
+
+/* The google_vpd_info header: an info record whose key is the version and
+ * signature, and whose value is the 4-byte size that follows it. */
+constexpr auto kVpdInfoHeader =
+    concat(encodeKey(VPD_TYPE_INFO, "\x01gVpdInfo"), encodeLen<4>());
+static_assert(kVpdInfoHeader.equals(VPD_INFO_MAGIC), "VPD_INFO_MAGIC");
+static_assert(kVpdInfoHeader.size() == offsetof(struct google_vpd_info, size),
+              "google_vpd_info header");
+
+/* Self-tests, starting with the vectors of testEncodeLen() in
+ * lib/lib_vpd_test.c. */
+static_assert(encodeLen<0>().equals("\x00"), "encodeLen(0)");
+static_assert(encodeLen<0x7f>().equals("\x7f"), "encodeLen(0x7f)");
+static_assert(encodeLen<0x80>().equals("\x81\x00"), "encodeLen(0x80)");
+static_assert(encodeLen<0x3fff>().equals("\xff\x7f"), "encodeLen(0x3fff)");
+static_assert(encodeLen<0x100040>().equals("\xc0\x80\x40"),
+              "encodeLen(0x100040)");
+static_assert(encodeString("KEY", "VALUE").equals("\x01\x03KEY\x05VALUE"),
+              "encodeVpdString");
+static_assert(encodeString<5>("K", "VA").equals("\x01\x01K\x05VA\0\0\0"),
+              "encodeVpdString padded");
+static_assert(encodeString<2>("K", "VALUE").equals("\x01\x01K\x02VA"),
+              "encodeVpdString cut");
+
+}  // namespace encoding
+}  // namespace libvpd
+
+#endif  /* __LIBVPD_VPD_ENCODING_H__ */
@@ -0,0 +1,184 @@
+/*
+ * Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Loading and writing back one VPD partition of an image file or the flash.
+ * Shared by the vpd utility and libvpd; not a public interface.
+ */
+
+#ifndef __LIBVPD_VPD_REGION_H__
+#define __LIBVPD_VPD_REGION_H__
+
+#include <list>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+#include <sys/types.h>
+
+extern "C" {
+#include "lib/lib_vpd.h"
+#include "lib/vpd.h"
+};
+
+namespace libvpd {
+
+/* The buffer length. Right now the VPD partition size on flash is 128KB. */
+#define BUF_LEN (128 * 1024)
+
+/* Where read-only runs get the VPD from, selected by --source. */
+enum ReadSource {
+  SOURCE_FLASH,
+  SOURCE_AUTO,  /* sysfs or cache if up to date, otherwise flash */
+  SOURCE_SYSFS, /* decoded by the kernel at boot */
+  SOURCE_CACHE, /* text cache of dump_vpd_log */
+};
+
+/* What loadFile() does when an EPS checksum is wrong, selected by
+ * --checksum. */
+enum ChecksumMode {
+  CHECKSUM_WARN,   /* print a warning and go on */
+  CHECKSUM_STRICT, /* fail with VPD_ERR_INVALID */
+  CHECKSUM_OFF,    /* do not verify */
+};
+
+enum FileFlag {
+  HAS_SPD = (1 << 0),
+  HAS_VPD_2_0 = (1 << 1),
+  HAS_VPD_1_2 = (1 << 2),
+};
+
+/* The EPS base address used to fill the EPS table entry.
+ * If the VPD partition can be found in fmap, this points to the starting
+ * offset of VPD partition. If not found, this is used to be the base address
+ * to increase SPD and VPD 2.0 offset fields.
+ */
+#define UNKNOWN_EPS_BASE ((uint32_t)-1)
+
+/* State of one VPD partition, loaded by openRegion() and written back by
+ * commitRegion().
+ */
+struct VpdRegion {
+  /* Partition name in fmap, RO_VPD or RW_VPD. */
+  std::string name;
+
+  /* Bitmask of FileFlag. */
+  int file_flag = 0;
+
+  /* Stores decoded pairs from file. */
+  struct PairContainer file;
+
+  uint32_t eps_base = UNKNOWN_EPS_BASE;
+
+  /* The entry point written by commitRegion(): 2 for the SMBIOS 2.x "_SM_"
+   * EPS, 3 for the 3.0 "_SM3_" one. loadFile() keeps the kind it found. */
+  int eps_major_ver = CONFIG_EPS_VPD_MAJOR_VERSION;
+
+  /* If found_vpd, replace the VPD partition when saveFile().
+   * If not found, always create new file when saveFlie(). */
+  bool found_vpd = false;
+
+  /* The VPD partition offset and size in the loaded file. The whole partition
+   * includes:
+   *
+   *   SMBIOS EPS
+   *   SMBIOS tables[]
+   *   SPD
+   *   VPD 2.0 data
+   *
+   */
+  uint32_t vpd_offset = 0, vpd_size = 0; /* The whole partition */
+  /* Below offset are related to vpd_offset and assume positive.
+   * Those are used in saveFile() to write back data. */
+  uint32_t eps_offset = 0; /* EPS's starting address. Tables[] is following. */
+  uint32_t spd_offset = GOOGLE_SPD_OFFSET;      /* SPD address .*/
+  off_t vpd_2_0_offset = GOOGLE_VPD_2_0_OFFSET; /* VPD 2.0 data address. */
+
+  /* This points to the SPD data if it is availiable when loadFile().
+   * The memory is allocated in loadFile(), will be used in saveFile(),
+   * and freed in destroyRegion(). */
+  uint8_t* spd_data = NULL;
+  int32_t spd_len = 256; /* max value for DDR3 */
+
+  /* Where the partition is loaded from and saved to. When reading from flash,
+   * these are temporary files and write_back_to_flash is set. */
+  const char* load_file = NULL;
+  const char* save_file = NULL;
+  int write_back_to_flash = 0;
+
+  /* Temporary files created by makeTempFile(), removed with the region. */
+  std::list<std::string> temp_files;
+
+  /* If not NULL, entries not matching this filter are dropped while decoding.
+   * Only set when the container will never be written back. */
+  const struct VpdKeyFilter* decode_filter = NULL;
+
+  /* Verification of the EPS checksums before decoding. */
+  enum ChecksumMode checksum_mode = CHECKSUM_WARN;
+
+  /* Binary values this long or longer are compressed by encodeRegion(), see
+   * packContainer(). */
+  int compress_min = VPD_COMPRESS_MIN_LEN;
+
+  /* Number of changes pending for commitRegion(). */
+  int modified = 0;
+
+  /* The partition as loaded, so that commitRegion() can skip writing back
+   * an identical image. Empty if the partition could not be read. */
+  std::vector<uint8_t> loaded;
+
+  /* The VPD 2.0 blob (google_vpd_info and the encoded pairs) made by
+   * encodeRegion(). */
+  std::vector<uint8_t> encoded;
+
+  /* The encoded pairs of the loaded partition as coreboot passes them to
+   * the kernel, i.e. /sys/firmware/vpd/{ro,rw}_raw: the google_vpd_info
+   * size bytes after it. Empty if the partition has no google_vpd_info. */
+  std::vector<uint8_t> raw_pairs;
+
+  VpdRegion() { initContainer(&file); }
+  VpdRegion(const VpdRegion&) = delete;
+  VpdRegion& operator=(const VpdRegion&) = delete;
+  ~VpdRegion();
+};
+
+/* Read a whole file, like base::ReadFileToBytes() and ReadFileToString(),
+ * so that vpd does not need libchrome. errno is set on failure.
+ */
+std::optional<std::vector<uint8_t>> readFileToBytes(const char* path);
+bool readFileToString(const char* path, std::string* contents);
+
+/* Reads the partition region->name from flash (if filename is NULL) or from
+ * filename, and decodes it into region->file.
+ */
+vpd_err_t openRegion(struct VpdRegion* region,
+                     const char* filename,
+                     bool raw_input,
+                     bool overwrite_it);
+
+/* Loads region->file from source for a read-only run. In SOURCE_AUTO mode,
+ * the raw blob in sysfs is used unless the region was written since boot,
+ * then the binary or text cache unless it is older than the last write.
+ * Returns VPD_ERR_NOT_FOUND if none is usable.
+ */
+vpd_err_t loadFromSource(struct VpdRegion* region, enum ReadSource source);
+
+/* Replaces the copy of the raw pairs of region_name kept next to the binary
+ * cache at cache_path, which dump_vpd_log compares with sysfs at boot to tell
+ * whether the caches are still current. Removes it if raw_pairs is empty.
+ */
+vpd_err_t writeRawSnapshot(const char* cache_path,
+                           const std::string& region_name,
+                           const std::vector<uint8_t>& raw_pairs);
+
+/* Encodes region->file and writes it back to the file or flash it was
+ * opened from. Returns VPD_UNCHANGED instead of writing if the result is
+ * identical to what was loaded.
+ */
+vpd_err_t commitRegion(struct VpdRegion* region);
+
+}  // namespace libvpd
+
+#endif  /* __LIBVPD_VPD_REGION_H__ */
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ */
+#include "lib/base64.h"
+
+static const char kAlphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+size_t base64EncodedSize(size_t len) {
+  return (len + 2) / 3 * 4;
+}
+
+void base64Encode(const uint8_t *in, size_t len, char *out) {
+  size_t i;
+
+  for (i = 0; i + 3 <= len; i += 3, out += 4) {
+    uint32_t bits = in[i] << 16 | in[i + 1] << 8 | in[i + 2];
+    out[0] = kAlphabet[bits >> 18];
+    out[1] = kAlphabet[(bits >> 12) & 0x3f];
+    out[2] = kAlphabet[(bits >> 6) & 0x3f];
+    out[3] = kAlphabet[bits & 0x3f];
+  }
+  if (i < len) {
+    uint32_t bits = in[i] << 16 | (i + 1 < len ? in[i + 1] << 8 : 0);
+    out[0] = kAlphabet[bits >> 18];
+    out[1] = kAlphabet[(bits >> 12) & 0x3f];
+    out[2] = i + 1 < len ? kAlphabet[(bits >> 6) & 0x3f] : '=';
+    out[3] = '=';
+  }
+}
+
+/* Returns the 6 bits of c, or -1 if c is not in the alphabet. */
+static int _decodeChar(char c) {
+  if (c >= 'A' && c <= 'Z')
+    return c - 'A';
+  if (c >= 'a' && c <= 'z')
+    return c - 'a' + 26;
+  if (c >= '0' && c <= '9')
+    return c - '0' + 52;
+  if (c == '+')
+    return 62;
+  if (c == '/')
+    return 63;
+  return -1;
+}
+
+vpd_err_t base64Decode(const char *in,
+                       size_t len,
+                       uint8_t *out,
+                       size_t *out_len) {
+  uint32_t bits = 0;
+  int num_bits = 0, num_chars = 0, num_pads = 0;
+  size_t i;
+
+  *out_len = 0;
+  for (i = 0; i < len; i++) {
+    int value;
+
+    if (in[i] == '\n' || in[i] == '\r')
+      continue;
+    if (in[i] == '=') {
+      num_pads++;
+      num_chars++;
+      continue;
+    }
+    value = _decodeChar(in[i]);
+    /* Nothing may follow the padding. */
+    if (value < 0 || num_pads)
+      return VPD_ERR_SYNTAX;
+    bits = bits << 6 | value;
+    num_bits += 6;
+    num_chars++;
+    if (num_bits >= 8) {
+      num_bits -= 8;
+      out[(*out_len)++] = bits >> num_bits;
+    }
+  }
+  if (num_chars % 4 || num_pads > 2)
+    return VPD_ERR_SYNTAX;
+  return VPD_OK;
+}
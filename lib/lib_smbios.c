@@ -32,35 +32,6 @@
 #include "lib/vpd.h"
 #include "lib/vpd_tables.h"
 
-/*
- * This function simply looks for the pattern of two adjacent NULL bytes
- * following the table header.
- */
-int vpd_sizeof_strings(void *table)
-{
-  uint8_t *p;
-  struct vpd_header *header = table;
-  size_t size = 0, offset = 0;
-  unsigned char cmp[2] = { '\0', '\0' };
-  uint8_t found = 0;
-
-  /*
-   * Search for double NULL. End of strings will be one byte before the
-   * final terminator which indicates end of structure.
-   */
-  for (p = table + header->length - 1; p; p++, offset++) {
-    if (!memcmp(p, cmp, 2)) {
-      found = 1;
-      break;
-    }
-  }
-
-  if (found)
-    size = offset;
-
-  return size;
-}
-
 /**
  * vpd_crete_eps - create an entry point structure
  *
@@ -121,166 +92,464 @@ struct vpd_entry *vpd_create_eps(uint16_t structure_table_len,
 }
 
 /**
- * vpd_append_type127 - append type 127 (end of table) structure
+ * vpd_structure_size - size of a structure with its strings
+ *
+ * @formatted_len:  length of the formatted area, without the header
+ * @strings:  the strings, NULL ones are left out
+ * @num_strings:  number of strings
+ *
+ * Each string is followed by its NUL, the set by one more NUL. A structure
+ * without strings ends with two NULs.
+ *
+ * returns the size in bytes
+ */
+size_t vpd_structure_size(size_t formatted_len, const char *const strings[],
+                          int num_strings)
+{
+  size_t size = sizeof(struct vpd_header) + formatted_len;
+  int i, present = 0;
+
+  for (i = 0; i < num_strings; i++) {
+    if (strings[i]) {
+      size += strlen(strings[i]) + 1;
+      present++;
+    }
+  }
+  return size + (present ? 1 : 2);
+}
+
+/**
+ * vpd_table_builder_init - prepare a builder for a structure table
  *
- * @handle:  handle for this structure
- * @buf:  buffer to append to
- * @len:  length of buffer
+ * @builder:  the builder
+ * @capacity:  bytes to allocate up front, e.g. a sum of vpd_structure_size()
  *
- * returns total size of newly re-sized buffer if successful
+ * returns 0 if successful
  * returns <0 to indicate failure
  */
-int vpd_append_type127(uint16_t handle, uint8_t **buf, size_t len)
+int vpd_table_builder_init(struct vpd_table_builder *builder, size_t capacity)
+{
+  memset(builder, 0, sizeof(*builder));
+  return vpd_table_builder_reserve(builder, capacity);
+}
+
+/**
+ * vpd_table_builder_reserve - make sure capacity bytes fit without realloc
+ *
+ * returns 0 if successful
+ * returns <0 to indicate failure; the table built so far is kept
+ */
+int vpd_table_builder_reserve(struct vpd_table_builder *builder,
+                              size_t capacity)
+{
+  uint8_t *buf;
+
+  if (capacity <= builder->capacity)
+    return 0;
+  buf = realloc(builder->buf, capacity);
+  if (!buf)
+    return -1;
+  builder->buf = buf;
+  builder->capacity = capacity;
+  return 0;
+}
+
+void vpd_table_builder_free(struct vpd_table_builder *builder)
+{
+  free(builder->buf);
+  memset(builder, 0, sizeof(*builder));
+}
+
+/**
+ * vpd_table_builder_append - append a structure of any type
+ *
+ * @builder:  the builder
+ * @type:  SMBIOS structure type
+ * @formatted_len:  length of the formatted area, without the header
+ * @strings:  the strings of the structure, NULL ones are left out
+ * @num_strings:  number of strings
+ * @string_ids:  if not NULL, receives the number of each string, as the
+ *               formatted area refers to them (0 for NULL strings)
+ *
+ * The handle is the number of structures appended before. The formatted area
+ * is zeroed; the caller fills it in through the returned pointer, which stays
+ * valid until the next append.
+ *
+ * returns the formatted area if successful
+ * returns NULL to indicate failure
+ */
+void *vpd_table_builder_append(struct vpd_table_builder *builder,
+                               uint8_t type, size_t formatted_len,
+                               const char *const strings[], int num_strings,
+                               uint8_t string_ids[])
 {
-  struct vpd_table_eot *data;
-  size_t total_len, struct_len;
+  const size_t size = vpd_structure_size(formatted_len, strings,
+                                         num_strings);
+  struct vpd_header *header;
+  uint8_t *p;
+  size_t capacity;
+  int i, id = 1;
 
-  struct_len = sizeof(struct vpd_table_eot) + 2;  /* double terminator */
-  total_len = len + struct_len;
-  *buf = realloc(*buf, total_len);
+  if (sizeof(*header) + formatted_len > UINT8_MAX ||
+      builder->count == UINT16_MAX)
+    return NULL;
+  if (builder->len + size > builder->capacity) {
+    capacity = builder->capacity * 2;
+    if (capacity < builder->len + size)
+      capacity = builder->len + size;
+    if (vpd_table_builder_reserve(builder, capacity))
+      return NULL;
+  }
 
-  data = (struct vpd_table_eot *)(*buf + len);
-  data->header.type = 127;
-  data->header.length = sizeof(*data);
-  data->header.handle = handle;
+  p = builder->buf + builder->len;
+  memset(p, 0, size);
+  header = (struct vpd_header *)p;
+  header->type = type;
+  header->length = sizeof(*header) + formatted_len;
+  header->handle = builder->count;
+
+  p += header->length;
+  for (i = 0; i < num_strings; i++) {
+    if (string_ids)
+      string_ids[i] = strings[i] ? id : 0;
+    if (!strings[i])
+      continue;
+    memcpy(p, strings[i], strlen(strings[i]) + 1);
+    p += strlen(strings[i]) + 1;
+    id++;
+  }
 
-  memset(*buf + len + sizeof(*data), 0, 2);  /* double terminator */
+  builder->len += size;
+  builder->count++;
+  return header + 1;
+}
 
-  return total_len;
+/**
+ * vpd_table_builder_add_type127 - append type 127 (end of table) structure
+ *
+ * returns 0 if successful
+ * returns <0 to indicate failure
+ */
+int vpd_table_builder_add_type127(struct vpd_table_builder *builder)
+{
+  if (!vpd_table_builder_append(builder, VPD_TYPE_END, 0, NULL, 0, NULL))
+    return -1;
+  return 0;
 }
 
 /**
- * vpd_append_type241 - append type 241 (binary blob pointer) structure
+ * vpd_table_builder_add_type241 - append type 241 (binary blob pointer)
  *
- * @handle:  handle for this structure
- * @buf:  buffer to append to
- * @len:  length of buffer
+ * @builder:  the builder
+ * @uuid:  UUID string of the blob
+ * @offset:  address of the blob
+ * @size:  size of the blob
  * @vendor:  blob vendor string
  * @desc:  blob description string
  * @variant:  blob variant string
  *
- * returns total size of newly re-sized buffer if successful
+ * returns 0 if successful
  * returns <0 to indicate failure
  */
-int vpd_append_type241(uint16_t handle, uint8_t **buf,
-                       size_t len, const char *uuid, uint32_t offset,
-                       uint32_t size, const char *vendor,
-                       const char *desc, const char *variant)
+int vpd_table_builder_add_type241(struct vpd_table_builder *builder,
+                                  const char *uuid, uint32_t offset,
+                                  uint32_t size, const char *vendor,
+                                  const char *desc, const char *variant)
 {
-  struct vpd_header *header;
+  const char *const strings[] = { vendor, desc, variant };
   struct vpd_table_binary_blob_pointer *data;
-  char *string_ptr;
-  size_t struct_len, total_len;
-  int string_index = 1;
-
-  /* FIXME: Add sanity checking */
-  struct_len = sizeof(struct vpd_header) +
-               sizeof(struct vpd_table_binary_blob_pointer);
-  if (vendor)
-    struct_len += strlen(vendor) + 1;
-  if (desc)
-    struct_len += strlen(desc) + 1;
-  if (variant)
-    struct_len += strlen(variant) + 1;
-  struct_len += 1;  /* structure terminator */
-  total_len = len + struct_len;
-
-  *buf = realloc(*buf, total_len);
-  memset(*buf + len, 0, struct_len);
-
-  header = (struct vpd_header *)(*buf + len);
-  data = (struct vpd_table_binary_blob_pointer *)
-            ((uint8_t *)header + sizeof(*header));
-  string_ptr = (char *)data + sizeof(*data);
-
-  /* fill in structure header details */
-  header->type = VPD_TYPE_BINARY_BLOB_POINTER;
-  header->length = sizeof(*header) + sizeof(*data);
-  header->handle = handle;
+  uint8_t ids[3];
+  uint8_t parsed[16];
+
+  if (uuid_parse(uuid, parsed) < 0) {
+    fprintf(stderr, "invalid UUID \"%s\" specified\n", uuid);
+    return -1;
+  }
+
+  data = vpd_table_builder_append(builder, VPD_TYPE_BINARY_BLOB_POINTER,
+                                  sizeof(*data), strings, 3, ids);
+  if (!data)
+    return -1;
 
   data->struct_major_version = 1;
   data->struct_minor_version = 0;
+  data->vendor = ids[0];
+  data->description = ids[1];
+  data->major_version = 2;
+  data->minor_version = 0;
+  data->variant = ids[2];
+  memcpy(data->uuid, parsed, sizeof(data->uuid));
+  data->offset = offset;
+  data->size = size;
+  return 0;
+}
+
+/*
+ * Finds the end of the strings of a structure of type whose formatted area
+ * ends at table[strings]. Returns the offset after its terminator, or 0 if
+ * that is past len.
+ */
+static uint32_t vpd_skip_strings(const uint8_t *table, uint32_t len,
+                                 uint8_t type, uint32_t strings,
+                                 uint8_t *num_strings)
+{
+  uint32_t p = strings;
+  int i;
 
-  if (vendor) {
-    data->vendor = string_index;
-    string_index++;
-    sprintf(string_ptr, "%s%c", vendor, '\0');
-    string_ptr += strlen(vendor) + 1;
+  *num_strings = 0;
+  if (type == VPD_TYPE_BINARY_BLOB_POINTER) {
+    /*
+     * Type 241 always has three strings, and the variant may be empty, so a
+     * NUL does not end the set. Old mosys (r169 to r211) also left out the
+     * structure terminator; only take the next byte if it is 0.
+     */
+    for (i = 0; i < 3; i++) {
+      while (p < len && table[p])
+        p++;
+      if (p++ >= len)
+        return 0;
+    }
+    *num_strings = 3;
+    if (p < len && table[p] == 0)
+      p++;
+    return p;
   }
 
-  if (desc) {
-    data->description = string_index;
-    string_index++;
-    sprintf(string_ptr, "%s%c", desc, '\0');
-    string_ptr += strlen(desc) + 1;
+  /* No strings: two NULs. Otherwise NUL-terminated strings, then a NUL. */
+  if (p + 2 > len)
+    return 0;
+  if (table[p] == 0)
+    return table[p + 1] == 0 ? p + 2 : 0;
+  while (p < len && table[p]) {
+    while (p < len && table[p])
+      p++;
+    if (p++ >= len)
+      return 0;
+    (*num_strings)++;
   }
+  return p < len ? p + 1 : 0;
+}
 
-  data->major_version = 2;
-  data->minor_version = 0;
+/**
+ * vpd_index_table - index a structure table in one bounded pass
+ *
+ * @table:  the first structure
+ * @len:  bytes available at table; no byte past it is read
+ * @index:  receives the structures, up to and including type 127
+ *
+ * Structures of any type are indexed. Known type 241 blobs are recorded in
+ * index->blobs so that they can be found without searching.
+ *
+ * returns 0 if successful
+ * returns <0 if the table is malformed, does not end within len, or has more
+ * than VPD_MAX_STRUCTURES structures
+ */
+int vpd_index_table(const uint8_t *table, uint32_t len,
+                    struct vpd_table_index *index)
+{
+  static const char *const known_uuids[VPD_NUM_KNOWN_BLOBS] = {
+    [VPD_BLOB_SPD] = GOOGLE_SPD_UUID,
+    [VPD_BLOB_VPD_2_0] = GOOGLE_VPD_2_0_UUID,
+    [VPD_BLOB_VPD_1_2] = GOOGLE_VPD_1_2_UUID,
+  };
+  uint8_t known[VPD_NUM_KNOWN_BLOBS][16];
+  uint32_t offset = 0;
+  int i;
 
-  if (variant) {
-    data->variant = string_index;
-    string_index++;
-    sprintf(string_ptr, "%s%c", variant, '\0');
-    string_ptr += strlen(variant) + 1;
+  memset(index, 0, sizeof(*index));
+  index->table = table;
+  for (i = 0; i < VPD_NUM_KNOWN_BLOBS; i++) {
+    index->blobs[i] = -1;
+    uuid_parse(known_uuids[i], known[i]);
   }
 
-  memset(&data->reserved[0], 0, 5);
+  for (;;) {
+    struct vpd_structure *structure;
+    const struct vpd_header *header;
+    const struct vpd_table_binary_blob_pointer *data;
+    uint32_t end;
+
+    if (index->count == VPD_MAX_STRUCTURES)
+      return -1;
+    if (offset + sizeof(*header) > len)
+      return -1;
+    header = (const struct vpd_header *)&table[offset];
+    if (header->length < sizeof(*header) || header->length > len - offset)
+      return -1;
+
+    structure = &index->structures[index->count];
+    structure->type = header->type;
+    structure->length = header->length;
+    structure->handle = header->handle;
+    structure->offset = offset;
+    end = vpd_skip_strings(table, len, header->type,
+                           offset + header->length,
+                           &structure->num_strings);
+    if (!end)
+      return -1;
+    structure->size = end - offset;
+
+    data = vpd_structure_blob(index, structure);
+    for (i = 0; data && i < VPD_NUM_KNOWN_BLOBS; i++) {
+      if (index->blobs[i] < 0 && !memcmp(data->uuid, known[i], 16))
+        index->blobs[i] = index->count;
+    }
 
-  if (uuid_parse(uuid, &data->uuid[0]) < 0) {
-    fprintf(stderr, "invalid UUID \"%s\" specified\n", uuid);
-    goto vpd_create_type241_fail;
+    index->count++;
+    offset = end;
+    if (header->type == VPD_TYPE_END)
+      break;
   }
+  index->len = offset;
+  return 0;
+}
 
-  data->offset = offset;
-  data->size = size;
+/**
+ * vpd_structure_string - get a string of an indexed structure
+ *
+ * @number:  string number as stored in the formatted area, from 1
+ *
+ * returns the string, or NULL if there is no such string
+ */
+const char *vpd_structure_string(const struct vpd_table_index *index,
+                                 const struct vpd_structure *structure,
+                                 uint8_t number)
+{
+  const char *str;
 
-  return total_len;
+  if (number == 0 || number > structure->num_strings)
+    return NULL;
+  /* vpd_index_table() made sure that every string is terminated. */
+  str = (const char *)index->table + structure->offset + structure->length;
+  while (--number)
+    str += strlen(str) + 1;
+  return str;
+}
 
-vpd_create_type241_fail:
+/**
+ * vpd_structure_blob - get the formatted area of an indexed type 241
+ *
+ * returns NULL if the structure is not a complete type 241
+ */
+const struct vpd_table_binary_blob_pointer *vpd_structure_blob(
+    const struct vpd_table_index *index,
+    const struct vpd_structure *structure)
+{
+  if (structure->type != VPD_TYPE_BINARY_BLOB_POINTER ||
+      structure->length < sizeof(struct vpd_header) +
+                          sizeof(struct vpd_table_binary_blob_pointer))
+    return NULL;
+  return (const struct vpd_table_binary_blob_pointer *)(
+      index->table + structure->offset + sizeof(struct vpd_header));
+}
+
+/**
+ * vpd_find_eps - find the entry point in a VPD partition
+ *
+ * @partition:  the VPD partition
+ * @size:  size of partition
+ *
+ * The EPS is searched on 16-byte boundaries, and only its anchor is checked.
+ * Both the SMBIOS 2.x "_SM_" and the 3.0 "_SM3_" anchors are recognised.
+ *
+ * returns the offset of the EPS, or <0 if there is none
+ */
+long vpd_find_eps(const uint8_t *partition, uint32_t size)
+{
+  uint32_t offset;
+
+  for (offset = 0; offset + sizeof(struct vpd_entry3) <= size; offset += 16) {
+    if (!memcmp(&partition[offset], VPD_ENTRY3_MAGIC,
+                sizeof(VPD_ENTRY3_MAGIC) - 1))
+      return offset;
+    if (offset + sizeof(struct vpd_entry) <= size &&
+        !memcmp(&partition[offset], VPD_ENTRY_MAGIC,
+                sizeof(VPD_ENTRY_MAGIC) - 1))
+      return offset;
+  }
   return -1;
 }
 
 /**
- * vpd_type241_size - return the size of type 241 structure table.
+ * vpd_read_eps - decode the entry point found by vpd_find_eps()
  *
- * Type 241 structure contains 3 variant length of string at end of table.
- * It is non-trival to get the length by sizeof(vpd_table_binary_blob_pointer).
- * This function can help by adding 3 strlen(NULL-terminated string).
+ * @partition:   the VPD partition
+ * @size:        size of partition
+ * @eps_offset:  offset of the EPS in partition
+ * @info:        filled with what the EPS says about the structure table
  *
- * @header:  pointer to the start address of this structure table.
+ * returns 0 on success, <0 if the EPS length does not fit
+ */
+int vpd_read_eps(const uint8_t *partition, uint32_t size, uint32_t eps_offset,
+                 struct vpd_eps_info *info)
+{
+  const uint8_t *anchor = &partition[eps_offset];
+  uint32_t min_length;
+
+  memset(info, 0, sizeof(*info));
+  if (!memcmp(anchor, VPD_ENTRY3_MAGIC, sizeof(VPD_ENTRY3_MAGIC) - 1)) {
+    const struct vpd_entry3 *eps = (const struct vpd_entry3 *)anchor;
+
+    info->major_ver = CONFIG_EPS3_VPD_MAJOR_VERSION;
+    info->entry_length = eps->entry_length;
+    info->eps_address = eps->table_address - sizeof(*eps);
+    min_length = sizeof(*eps);
+  } else {
+    const struct vpd_entry *eps = (const struct vpd_entry *)anchor;
+
+    info->major_ver = CONFIG_EPS_VPD_MAJOR_VERSION;
+    info->entry_length = eps->entry_length;
+    info->eps_address = eps->table_address - sizeof(*eps);
+    min_length = sizeof(*eps);
+  }
+  info->table_offset = eps_offset + info->entry_length;
+
+  if (info->entry_length < min_length || info->table_offset > size)
+    return -1;
+  return 0;
+}
+
+/*
+ * vpd_find_blob - find the blob of a type 241 table by UUID
  *
- * returns total size of this structure table.
- * returns <0 to indicate failure
+ * @partition: the VPD partition, starting with (or 16-byte aligned EPS in it).
+ * @size:      size of partition.
+ * @uuid:      UUID string of the blob, e.g. GOOGLE_VPD_2_0_UUID.
+ * @offset:    set to the offset of the blob in partition.
+ *
+ * Every table is checked against size, so partition may be untrusted.
+ *
+ * returns 0 if found, <0 to indicate failure
  */
-int vpd_type241_size(struct vpd_header *header) {
-  uint8_t *ptr = (uint8_t*)header;
-  char *str = (char*)ptr + header->length;
-  int length = sizeof(struct vpd_header) +
-               sizeof(struct vpd_table_binary_blob_pointer);
+int vpd_find_blob(const uint8_t *partition, uint32_t size,
+                  const char *uuid, uint32_t *offset)
+{
+  struct vpd_eps_info eps;
+  struct vpd_table_index index;
+  uint8_t want[16];
+  long eps_offset;
   int i;
 
-  /* Sanity check */
-  if (header->type != VPD_TYPE_BINARY_BLOB_POINTER) return -1;
+  if (uuid_parse(uuid, want)) return -1;
 
-  /* Three variant-length strings are following. */
-  for (i = 0; i < 3; ++i) {
-    int len = strlen(str) + 1;
-    length += len;
-    str += len;
-  }
+  eps_offset = vpd_find_eps(partition, size);
+  if (eps_offset < 0 || vpd_read_eps(partition, size, eps_offset, &eps))
+    return -1;
+  if (vpd_index_table(&partition[eps.table_offset], size - eps.table_offset,
+                      &index))
+    return -1;
 
-  /* Additional null(0) to indicate end of set, so called structure terminator.
-   * Refer to SMBIOS spec 3.1.3 Text Strings.
-   * However, in VPD 1.x, the mosys would generate a buggy type 241 structure,
-   * which missed the terminator. See mosys between r169 and r211.
-   * The workaround is simple, when counting VPD 241 length, look at the byte
-   * byte after variant string. If it is 0x00, means it's the structure
-   * terminator. If non-zero, then it must be the next table type.
-   */
-  if (ptr[length] == 0) length++;  /* increase only if this is terminator. */
-
-  return length;
+  for (i = 0; i < index.count; i++) {
+    const struct vpd_table_binary_blob_pointer *data =
+        vpd_structure_blob(&index, &index.structures[i]);
+
+    if (!data || memcmp(data->uuid, want, sizeof(want)))
+      continue;
+    if (data->offset - eps.eps_address >= size) return -1;
+    *offset = data->offset - eps.eps_address;
+    return 0;
+  }
+  return -1;
 }
 
 void vpd_free_table(void *data)
@@ -16,8 +16,18 @@ vpd_err_t decodeVpdString(
   return res == VPD_DECODE_OK ? VPD_OK : VPD_ERR_DECODE;
 }
 
+vpd_err_t decodeVpdRecord(
+    const uint32_t max_len, const uint8_t *input_buf, uint32_t *consumed,
+    VpdDecodeRecordCallback callback, void *callback_arg)
+{
+  int res = vpd_decode_record(
+      max_len, input_buf, consumed, callback, callback_arg);
+  return res == VPD_DECODE_OK ? VPD_OK : VPD_ERR_DECODE;
+}
+
 /* Include vpd_decode.c so we can test static functions */
 #define vpd_decode_string _dummy_
+#define vpd_decode_record _dummy_record_
 #include "vpd_decode.c"
 
 vpd_err_t decodeLen(
@@ -27,3 +37,11 @@ vpd_err_t decodeLen(
   int res = vpd_decode_len(max_len, in, length, decoded_len);
   return res == VPD_DECODE_OK ? VPD_OK : VPD_ERR_DECODE;
 }
+
+vpd_err_t decodeLenReference(
+    const uint32_t max_len, const uint8_t *in, uint32_t *length,
+    uint32_t *decoded_len)
+{
+  int res = vpd_decode_len_ref(max_len, in, length, decoded_len);
+  return res == VPD_DECODE_OK ? VPD_OK : VPD_ERR_DECODE;
+}
@@ -8,7 +8,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include "lib/base64.h"
+#include "lib/checksum.h"
+#include "lib/lib_smbios.h"
 #include "lib/lib_vpd.h"
+#include "lib/lz4_block.h"
+#include "lib/vpd.h"
+#include "lib/vpd_cache.h"
+#include "lib/vpd_lock.h"
 
 #ifndef NDEBUG
 enum {
@@ -125,6 +133,72 @@ int testDecodeLen() {
 }
 
 
+/* The fast paths of encodeLen() and decodeLen() against the references. */
+int testLenFastPath() {
+  static const int32_t big[] = { 0x3fff, 0x4000, 0x1fffff, 0x200000,
+                                 0xfffffff, 0x10000000, 0x7fffffff };
+  uint8_t fast[8], ref[8];
+  int32_t fast_len, ref_len, len;
+  uint32_t length, decoded, ref_length, ref_decoded;
+  uint32_t max_len;
+  size_t i;
+
+  for (len = 0; len < 0x10000; len++) {
+    for (max_len = 0; max_len <= 3; max_len++) {
+      memset(fast, 0xaa, sizeof(fast));
+      memset(ref, 0xaa, sizeof(ref));
+      assert(encodeLenReference(len, ref, max_len ? max_len : 8, &ref_len) ==
+             encodeLen(len, fast, max_len ? max_len : 8, &fast_len));
+      assert(ref_len == fast_len);
+      assert(!memcmp(ref, fast, sizeof(fast)));
+    }
+    assert(fast_len == encodeLenSize(len));
+  }
+  for (i = 0; i < sizeof(big) / sizeof(big[0]); i++) {
+    assert(VPD_OK == encodeLen(big[i], fast, sizeof(fast), &fast_len));
+    assert(fast_len == encodeLenSize(big[i]));
+    assert(VPD_OK == decodeLen(fast_len, fast, &length, &decoded));
+    assert((uint32_t)big[i] == length && (uint32_t)fast_len == decoded);
+  }
+  assert(VPD_ERR_OVERFLOW == encodeLen(0, fast, 0, &fast_len));
+
+  /* every two-byte input, with and without room for a third byte */
+  for (i = 0; i < 0x10000; i++) {
+    uint8_t in[3] = { i >> 8, i & 0xff, 0x01 };
+    for (max_len = 0; max_len <= 3; max_len++) {
+      assert(decodeLenReference(max_len, in, &ref_length, &ref_decoded) ==
+             decodeLen(max_len, in, &length, &decoded));
+      if (VPD_OK == decodeLen(max_len, in, &length, &decoded))
+        assert(ref_length == length && ref_decoded == decoded);
+    }
+  }
+
+  printf("[PASS] %s()\n", __FUNCTION__);
+  return TEST_OK;
+}
+
+int testEncodeContainerSize() {
+  struct PairContainer container;
+  uint8_t buf[0x1000];
+  char value[300];
+  int generated = 0;
+
+  memset(value, 'v', sizeof(value) - 1);
+  value[sizeof(value) - 1] = '\0';
+  initContainer(&container);
+  assert(0 == encodeContainerSize(&container));
+  setString(&container, CU8"KEY", CU8"1", VPD_AS_LONG_AS);
+  setString(&container, CU8"LONG", CU8 value, VPD_AS_LONG_AS);
+  setString(&container, CU8"PADDED", CU8"12345", 200);
+  setString(&container, CU8"CUT", CU8"12345", 2);
+  assert(VPD_OK == encodeContainer(&container, sizeof(buf), buf, &generated));
+  assert(generated == encodeContainerSize(&container));
+  destroyContainer(&container);
+
+  printf("[PASS] %s()\n", __FUNCTION__);
+  return TEST_OK;
+}
+
 int testEncodeVpdString() {
   unsigned char expected[] = {
     VPD_TYPE_STRING,
@@ -243,6 +317,355 @@ int testDecodeVpdString() {
 }
 
 
+static int _countRecords(const uint8_t *key, uint32_t key_len,
+                         const uint8_t *value, uint32_t value_len,
+                         void *arg) {
+  (*(int *)arg)++;
+  return VPD_DECODE_OK;
+}
+
+int testBinaryValue() {
+  /* A binary value after a string; encodeContainer() keeps that order. */
+  unsigned char expected[] = {
+    VPD_TYPE_STRING,
+    0x01, 'S',
+    0x02, 'a', 'b',
+    VPD_TYPE_BINARY,
+    0x03, 'I', 'C', 'C',
+    0x04, 0x00, 0xff, '"', 0x0a,
+  };
+  const struct {
+    const char *data;
+    const char *base64;
+  } vectors[] = {
+    {"", ""}, {"f", "Zg=="}, {"fo", "Zm8="}, {"foo", "Zm9v"},
+    {"foob", "Zm9vYg=="}, {"fooba", "Zm9vYmE="}, {"foobar", "Zm9vYmFy"},
+  };
+  unsigned char buf[256];
+  char text[16];
+  uint32_t consumed = 0;
+  struct PairContainer container;
+  struct StringPair *pair;
+  int generated = 0;
+  int records = 0;
+  size_t len;
+  int i;
+
+  for (i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+    len = strlen(vectors[i].data);
+    assert(strlen(vectors[i].base64) == base64EncodedSize(len));
+    base64Encode(CU8 vectors[i].data, len, text);
+    assert(!memcmp(vectors[i].base64, text, base64EncodedSize(len)));
+    assert(VPD_OK == base64Decode(vectors[i].base64,
+                                  strlen(vectors[i].base64), buf, &len));
+    assert(strlen(vectors[i].data) == len);
+    assert(!memcmp(vectors[i].data, buf, len));
+  }
+  assert(VPD_OK == base64Decode("Zm9v\nYmFy\r\n", 11, buf, &len));
+  assert(6 == len && !memcmp("foobar", buf, 6));
+  assert(VPD_ERR_SYNTAX == base64Decode("Zm9", 3, buf, &len));
+  assert(VPD_ERR_SYNTAX == base64Decode("Zm9*", 4, buf, &len));
+  assert(VPD_ERR_SYNTAX == base64Decode("Zg==Zg==", 8, buf, &len));
+
+  initContainer(&container);
+  while (consumed < sizeof(expected))
+    assert(VPD_OK == decodeToContainer(&container, sizeof(expected), expected,
+                                       &consumed));
+  assert(sizeof(expected) == consumed);
+  pair = findString(&container, CU8"ICC", NULL);
+  assert(pair && VPD_TYPE_BINARY == pair->type && 4 == pair->value_len);
+  assert(!memcmp("\x00\xff\"\n", pair->value, 4));
+  assert(VPD_TYPE_STRING == findString(&container, CU8"S", NULL)->type);
+
+  /* Readers that do not need the type get the raw bytes. */
+  consumed = 0;
+  while (consumed < sizeof(expected))
+    assert(VPD_DECODE_OK == vpd_decode_string(sizeof(expected), expected,
+                                              &consumed, _countRecords,
+                                              &records));
+  assert(2 == records);
+
+  assert(sizeof(expected) == encodeContainerSize(&container));
+  assert(VPD_OK == encodeContainer(&container, sizeof(buf), buf, &generated));
+  assert(sizeof(expected) == generated);
+  assert(!memcmp(expected, buf, generated));
+
+  /* Strings are encoded first, whatever the order in the container. */
+  destroyContainer(&container);
+  initContainer(&container);
+  setBinary(&container, CU8"ICC", CU8"\x00\xff\"\n", 4);
+  setString(&container, CU8"S", CU8"ab", VPD_AS_LONG_AS);
+  generated = 0;
+  assert(VPD_OK == encodeContainer(&container, sizeof(buf), buf, &generated));
+  assert(sizeof(expected) == generated);
+  assert(!memcmp(expected, buf, generated));
+
+  /* Text formats get base64, -g gets the bytes. */
+  generated = 0;
+  assert(VPD_OK == exportContainer(VPD_EXPORT_KEY_VALUE, &container,
+                                   sizeof(buf), buf, &generated));
+  assert(!memcmp("\"ICC\"=\"AP8iCg==\"\n\"S\"=\"ab\"\n", buf, generated));
+  generated = 0;
+  assert(VPD_OK == exportContainer(VPD_EXPORT_AS_PARAMETER, &container,
+                                   sizeof(buf), buf, &generated));
+  assert(!memcmp("    -b 'ICC=AP8iCg==' \\\n", buf, 24));
+  generated = 0;
+  assert(VPD_OK == exportStringValue(findString(&container, CU8"ICC", NULL),
+                                     sizeof(buf), buf, &generated));
+  assert(4 == generated && !memcmp("\x00\xff\"\n", buf, 4));
+  generated = 0;
+  assert(VPD_ERR_OVERFLOW ==
+         exportLookupResult(VPD_EXPORT_KEY_VALUE, CU8"ICC",
+                            findString(&container, CU8"ICC", NULL), 8, buf,
+                            &generated));
+
+  destroyContainer(&container);
+
+  printf("[PASS] %s()\n", __FUNCTION__);
+  return TEST_OK;
+}
+
+
+int testCompression() {
+  static uint8_t data[1000], block[1100], out[1000], buf[2048];
+  /* Literals only; a match of 8 at offset 4; an offset beyond the output. */
+  const uint8_t literals[] = {0x30, 'a', 'b', 'c'};
+  const uint8_t match[] = {0x44, 'a', 'b', 'c', 'd', 0x04, 0x00, 0x00};
+  const uint8_t bad_offset[] = {0x10, 'a', 0x02, 0x00, 0x00};
+  struct PairContainer container, decoded, merged;
+  struct StringPair *pair;
+  uint32_t consumed = 0;
+  int generated = 0, decoded_len = 0;
+  uint32_t seed = 1;
+  size_t len;
+  int i;
+
+  /* Runs longer than the 15 that fit in the token, then noise. */
+  for (i = 0; i < sizeof(data); i++) {
+    seed = seed * 1103515245 + 12345;
+    data[i] = i < 600 ? "ICC profile "[i % 12] : seed >> 24;
+  }
+  len = lz4CompressBlock(data, sizeof(data), block, sizeof(block));
+  assert(len > 0 && len < sizeof(data));
+  assert(VPD_OK == lz4DecompressBlock(block, len, out, sizeof(out)));
+  assert(!memcmp(data, out, sizeof(data)));
+  assert(VPD_ERR_DECODE == lz4DecompressBlock(block, len, out, 999));
+  assert(VPD_ERR_DECODE == lz4DecompressBlock(block, len - 1, out, 1000));
+  assert(0 == lz4CompressBlock(data, sizeof(data), block, 10));
+  for (len = 0; len < 20; len++) {
+    size_t block_len = lz4CompressBlock(data, len, block, sizeof(block));
+    assert(block_len > 0);
+    assert(VPD_OK == lz4DecompressBlock(block, block_len, out, len));
+    assert(!memcmp(data, out, len));
+  }
+  assert(VPD_OK == lz4DecompressBlock(literals, sizeof(literals), out, 3));
+  assert(!memcmp("abc", out, 3));
+  assert(VPD_OK == lz4DecompressBlock(match, sizeof(match), out, 12));
+  assert(!memcmp("abcdabcdabcd", out, 12));
+  assert(VPD_ERR_DECODE ==
+         lz4DecompressBlock(bad_offset, sizeof(bad_offset), out, 6));
+
+  /* Only binary values that are long enough and get smaller. */
+  initContainer(&container);
+  setBinary(&container, CU8"icc", data, 600);
+  setBinary(&container, CU8"short", data, VPD_COMPRESS_MIN_LEN - 1);
+  setBinary(&container, CU8"noise", data + 600, 400);
+  setString(&container, CU8"text", CU8"ICC profile ICC profile ICC profile "
+            "ICC profile ICC profile ICC profile ICC profile ICC profile "
+            "ICC profile ICC profile ICC profile ICC profile ", VPD_AS_LONG_AS);
+  packContainer(&container, 0);
+  assert(!findString(&container, CU8"icc", NULL)->packed);
+  packContainer(&container, VPD_COMPRESS_MIN_LEN);
+  pair = findString(&container, CU8"icc", NULL);
+  assert(pair->packed && pair->packed_len < 100);
+  assert(!findString(&container, CU8"short", NULL)->packed);
+  assert(!findString(&container, CU8"noise", NULL)->packed);
+  assert(!findString(&container, CU8"text", NULL)->packed);
+
+  generated = 0;
+  assert(VPD_OK == encodeContainer(&container, sizeof(buf), buf, &generated));
+  assert(generated == encodeContainerSize(&container));
+
+  /* Decoding keeps the value packed until it is used. */
+  initContainer(&decoded);
+  while (consumed < generated)
+    assert(VPD_OK == decodeToContainer(&decoded, generated, buf, &consumed));
+  pair = findString(&decoded, CU8"icc", NULL);
+  assert(pair && VPD_TYPE_BINARY == pair->type && 600 == pair->value_len);
+  assert(!pair->value && pair->packed);
+  assert(VPD_OK == encodeContainer(&decoded, sizeof(buf), buf,
+                                   &decoded_len));
+  assert(generated == decoded_len && !pair->value);
+  initContainer(&merged);
+  mergeContainer(&merged, &decoded);
+  assert(!findString(&merged, CU8"icc", NULL)->value);
+  assert(getPairValue(findString(&merged, CU8"icc", NULL)));
+  assert(!memcmp(data, getPairValue(pair), 600) && pair->value);
+  destroyContainer(&merged);
+
+  /* A corrupt block is found when the value is used. */
+  destroyContainer(&decoded);
+  initContainer(&decoded);
+  pair = findString(&container, CU8"icc", NULL);
+  pair->packed_len--;
+  generated = 0;
+  assert(VPD_OK == encodeContainer(&container, sizeof(buf), buf, &generated));
+  consumed = 0;
+  while (consumed < generated)
+    assert(VPD_OK == decodeToContainer(&decoded, generated, buf, &consumed));
+  assert(!getPairValue(findString(&decoded, CU8"icc", NULL)));
+  decoded_len = 0;
+  assert(VPD_ERR_DECODE == exportContainer(VPD_EXPORT_KEY_VALUE, &decoded,
+                                           sizeof(buf), buf, &decoded_len));
+
+  destroyContainer(&decoded);
+  destroyContainer(&container);
+
+  printf("[PASS] %s()\n", __FUNCTION__);
+  return TEST_OK;
+}
+
+
+int testPrefixKeys() {
+  unsigned char expected[] = {
+    VPD_TYPE_STRING,
+    0x05, 'r', 'l', 'z', '_', 'a',
+    0x01, '1',
+    VPD_TYPE_PREFIX_STRING,
+    0x04, 0x09, 0x04, 'b', 'c',
+    0x01, '2',
+  };
+  /* After the string "k"="", pointing at itself, before the start, into the
+   * middle of "k", and sharing more than its key. */
+  const unsigned char anchor[] = {VPD_TYPE_STRING, 0x01, 'k', 0x00};
+  unsigned char bad[][6] = {
+    {VPD_TYPE_PREFIX_STRING, 0x03, 0x00, 0x00, 'k', 0x00},
+    {VPD_TYPE_PREFIX_STRING, 0x03, 0x05, 0x00, 'k', 0x00},
+    {VPD_TYPE_PREFIX_STRING, 0x03, 0x02, 0x00, 'k', 0x00},
+    {VPD_TYPE_PREFIX_STRING, 0x03, 0x04, 0x02, 'k', 0x00},
+  };
+  unsigned char buf[512], plain[512];
+  struct PairContainer container, decoded;
+  struct StringPair *pair;
+  struct VpdKeyFilter filter;
+  uint32_t consumed = 0;
+  int generated = 0, plain_len = 0;
+  int i, size;
+
+  assert(VPD_OK == encodeVpdString(CU8"rlz_a", CU8"1", VPD_AS_LONG_AS,
+                                   sizeof(buf), buf, &generated));
+  assert(VPD_OK == encodeVpdPrefixString(generated, CU8"rlz_bc", 4, CU8"2",
+                                         VPD_AS_LONG_AS, sizeof(buf), buf,
+                                         &generated));
+  assert(sizeof(expected) == generated);
+  assert(!memcmp(expected, buf, generated));
+  assert(9 + encodeVpdPrefixStringSize(9, 4, 6, 1) == generated);
+
+  initContainer(&decoded);
+  while (consumed < sizeof(expected))
+    assert(VPD_OK == decodeToContainer(&decoded, sizeof(expected), expected,
+                                       &consumed));
+  assert(!strcmp("2", (char*)findString(&decoded, CU8"rlz_bc", NULL)->value));
+  assert(VPD_TYPE_STRING == findString(&decoded, CU8"rlz_bc", NULL)->type);
+  assert(findString(&decoded, CU8"rlz_bc", NULL)->prefix_key);
+  assert(!findString(&decoded, CU8"rlz_a", NULL)->prefix_key);
+  destroyContainer(&decoded);
+
+  /* Matched against the whole key. */
+  initKeyFilter(&filter);
+  assert(VPD_OK == addKeyFilterPattern(&filter, "rlz_b*", 6));
+  initContainer(&decoded);
+  consumed = 0;
+  while (consumed < sizeof(expected))
+    assert(VPD_OK == decodeToContainerFiltered(
+        &decoded, &filter, sizeof(expected), expected, &consumed));
+  assert(1 == lenOfContainer(&decoded));
+  assert(findString(&decoded, CU8"rlz_bc", NULL));
+  destroyContainer(&decoded);
+  destroyKeyFilter(&filter);
+
+  memcpy(buf, anchor, sizeof(anchor));
+  for (i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+    memcpy(buf + sizeof(anchor), bad[i], sizeof(bad[i]));
+    consumed = sizeof(anchor);
+    initContainer(&decoded);
+    assert(VPD_ERR_DECODE == decodeToContainer(
+        &decoded, sizeof(anchor) + sizeof(bad[i]), buf, &consumed));
+    destroyContainer(&decoded);
+  }
+  /* Sharing all of it is fine. */
+  buf[sizeof(anchor) + 3] = 0x01;
+  consumed = sizeof(anchor);
+  initContainer(&decoded);
+  assert(VPD_OK == decodeToContainer(&decoded, sizeof(anchor) + sizeof(bad[0]),
+                                     buf, &consumed));
+  assert(findString(&decoded, CU8"kk", NULL));
+  destroyContainer(&decoded);
+
+  /* Full keys first, then the rest against the key they share most with. */
+  initContainer(&container);
+  setString(&container, CU8"rlz_embargo_end_date", CU8"2026-01-01",
+            VPD_AS_LONG_AS);
+  setString(&container, CU8"serial_number", CU8"SN1", VPD_AS_LONG_AS);
+  setString(&container, CU8"rlz_embargo_start", CU8"x", 8);
+  setString(&container, CU8"rlz_brand_code", CU8"ABCD", VPD_AS_LONG_AS);
+  setString(&container, CU8"rlz", CU8"short", VPD_AS_LONG_AS);
+  setBinary(&container, CU8"serial_number_bin", CU8"\x01", 1);
+  setString(&container, CU8"serial_number_2", CU8"SN2", VPD_AS_LONG_AS);
+  assert(VPD_OK == encodeContainer(&container, sizeof(plain), plain,
+                                   &plain_len));
+
+  for (pair = container.first; pair; pair = pair->next)
+    pair->prefix_key = 1;
+  generated = 0;
+  assert(VPD_OK == encodeContainer(&container, sizeof(buf), buf, &generated));
+  assert(generated == encodeContainerSize(&container));
+  assert(generated < plain_len);
+  assert(VPD_TYPE_STRING == buf[0]);
+  assert(VPD_TYPE_BINARY == buf[generated - 21]);
+
+  initContainer(&decoded);
+  consumed = 0;
+  while (consumed < generated)
+    assert(VPD_OK == decodeToContainer(&decoded, generated, buf, &consumed));
+  assert(lenOfContainer(&container) == lenOfContainer(&decoded));
+  assert(!strcmp("x", (char*)findString(&decoded, CU8"rlz_embargo_start",
+                                         NULL)->value));
+  assert(!strcmp("SN2", (char*)findString(&decoded, CU8"serial_number_2",
+                                          NULL)->value));
+  assert(findString(&decoded, CU8"rlz_brand_code", NULL));
+  assert(findString(&decoded, CU8"rlz", NULL));
+
+  /* The same records again once decoded. */
+  plain_len = 0;
+  assert(VPD_OK == encodeContainer(&decoded, sizeof(plain), plain,
+                                   &plain_len));
+  assert(plain_len == generated && !memcmp(buf, plain, generated));
+
+  /* A new value keeps the record type; keys without prefix_key are stored
+   * in full, unless merged from pairs that have it. */
+  setString(&decoded, CU8"rlz_embargo_start", CU8"y", 8);
+  assert(findString(&decoded, CU8"rlz_embargo_start", NULL)->prefix_key);
+  size = encodeContainerSize(&decoded);
+  setString(&decoded, CU8"serial_number_3", CU8"SN3", VPD_AS_LONG_AS);
+  assert(size + encodeVpdStringSize(15, 3) == encodeContainerSize(&decoded));
+  destroyContainer(&container);
+  initContainer(&container);
+  setString(&container, CU8"serial_number_4", CU8"SN4", VPD_AS_LONG_AS);
+  container.first->prefix_key = 1;
+  size = encodeContainerSize(&decoded);
+  mergeContainer(&decoded, &container);
+  assert(findString(&decoded, CU8"serial_number_4", NULL)->prefix_key);
+  assert(size + encodeVpdStringSize(15, 3) > encodeContainerSize(&decoded));
+
+  destroyContainer(&decoded);
+  destroyContainer(&container);
+
+  printf("[PASS] %s()\n", __FUNCTION__);
+  return TEST_OK;
+}
+
+
 int testDeleteEmptyContainer() {
   struct PairContainer container;
 
@@ -375,6 +798,478 @@ int testDeleteSecondOfThree() {
   printf("[PASS] %s()\n", __FUNCTION__);
   return TEST_OK;
 }
+
+
+int testKeyFilter() {
+  struct VpdKeyFilter filter;
+  struct PairContainer container;
+  int i;
+
+  initKeyFilter(&filter);
+  assert(isKeyFilterEmpty(&filter));
+  assert(VPD_OK == addKeyFilterList(&filter, "serial_number,rlz_*, re?ion"));
+  assert(VPD_ERR_SYNTAX == addKeyFilterPattern(&filter, "", 0));
+
+  assert(matchKeyFilter(&filter, CU8"serial_number", 13));
+  assert(!matchKeyFilter(&filter, CU8"serial_number", 6));
+  assert(!matchKeyFilter(&filter, CU8"mlb_serial_number", 17));
+  assert(matchKeyFilter(&filter, CU8"rlz_brand_code", 14));
+  assert(!matchKeyFilter(&filter, CU8"rl", 2));
+  assert(matchKeyFilter(&filter, CU8"region", 6));
+  assert(!matchKeyFilter(&filter, CU8"regions", 7));
+
+  /* keys added as keys are never wildcards */
+  assert(VPD_OK == addKeyFilterKey(&filter, "oem_*", 5));
+  assert(matchKeyFilter(&filter, CU8"oem_*", 5));
+  assert(!matchKeyFilter(&filter, CU8"oem_name", 8));
+  assert(VPD_ERR_SYNTAX == addKeyFilterKey(&filter, "", 0));
+
+  /* globs also match keys too long for the stack copy */
+  {
+    char long_key[300];
+    memset(long_key, 'x', sizeof(long_key));
+    memcpy(long_key, "region", 6);
+    assert(!matchKeyFilter(&filter, CU8 long_key, sizeof(long_key)));
+    assert(VPD_OK == addKeyFilterPattern(&filter, "re?ion*x", 8));
+    assert(matchKeyFilter(&filter, CU8 long_key, sizeof(long_key)));
+  }
+
+  /* grow the hash set beyond its initial size */
+  for (i = 0; i < 100; ++i) {
+    char key[16];
+    snprintf(key, sizeof(key), "key%d", i);
+    assert(VPD_OK == addKeyFilterPattern(&filter, key, strlen(key)));
+  }
+  assert(matchKeyFilter(&filter, CU8"key0", 4));
+  assert(matchKeyFilter(&filter, CU8"key99", 5));
+  assert(!matchKeyFilter(&filter, CU8"key100", 6));
+  assert(matchKeyFilter(&filter, CU8"serial_number", 13));
+
+  /* decode only the matched pairs */
+  {
+    unsigned char encoded[] = {
+      VPD_TYPE_STRING,
+      0x03, 'K', 'E', 'Y',
+      0x01, '1',
+      VPD_TYPE_STRING,
+      0x06, 'r', 'e', 'g', 'i', 'o', 'n',
+      0x02, 'u', 's',
+    };
+    uint32_t consumed = 0;
+
+    initContainer(&container);
+    while (consumed < sizeof(encoded))
+      assert(VPD_OK == decodeToContainerFiltered(
+          &container, &filter, sizeof(encoded), encoded, &consumed));
+    assert(1 == lenOfContainer(&container));
+    assert(NULL != findString(&container, CU8"region", NULL));
+
+    setString(&container, CU8"KEY", CU8"1", VPD_AS_LONG_AS);
+    assert(VPD_OK == setContainerKeyFilter(&container, &filter));
+    assert(!findString(&container, CU8"region", NULL)->filter_out);
+    assert(findString(&container, CU8"KEY", NULL)->filter_out);
+
+    /* An exact key, even with wildcard characters. */
+    assert(VPD_OK == setContainerFilter(&container, CU8"KEY"));
+    assert(findString(&container, CU8"region", NULL)->filter_out);
+    assert(!findString(&container, CU8"KEY", NULL)->filter_out);
+    assert(VPD_OK == setContainerFilter(&container, CU8"K*"));
+    assert(findString(&container, CU8"KEY", NULL)->filter_out);
+    setString(&container, CU8"K*", CU8"2", VPD_AS_LONG_AS);
+    assert(VPD_OK == setContainerFilter(&container, CU8"K*"));
+    assert(!findString(&container, CU8"K*", NULL)->filter_out);
+    destroyContainer(&container);
+  }
+
+  destroyKeyFilter(&filter);
+  assert(isKeyFilterEmpty(&filter));
+
+  printf("[PASS] %s()\n", __FUNCTION__);
+  return TEST_OK;
+}
+
+
+int testCheckContainer() {
+  struct PairContainer container, present, absent;
+  const uint8_t *failed_key = NULL;
+
+  initContainer(&container);
+  initContainer(&present);
+  initContainer(&absent);
+  setString(&container, CU8"FIRST", CU8"1", VPD_AS_LONG_AS);
+  setString(&container, CU8"SECOND", CU8"2", VPD_AS_LONG_AS);
+
+  /* no conditions always hold */
+  assert(VPD_OK == checkContainer(&container, &present, &absent, NULL));
+
+  setString(&present, CU8"SECOND", CU8"2", VPD_AS_LONG_AS);
+  setString(&absent, CU8"THIRD", CU8"", VPD_AS_LONG_AS);
+  assert(VPD_OK == checkContainer(&container, &present, &absent, &failed_key));
+  assert(NULL == failed_key);
+
+  /* different value */
+  setString(&present, CU8"FIRST", CU8"10", VPD_AS_LONG_AS);
+  assert(VPD_ERR_CONDITION ==
+         checkContainer(&container, &present, &absent, &failed_key));
+  assert(!strcmp("FIRST", (const char *)failed_key));
+  setString(&present, CU8"FIRST", CU8"1", VPD_AS_LONG_AS);
+
+  /* present key expected absent */
+  setString(&absent, CU8"SECOND", CU8"", VPD_AS_LONG_AS);
+  assert(VPD_ERR_CONDITION ==
+         checkContainer(&container, &present, &absent, &failed_key));
+  assert(!strcmp("SECOND", (const char *)failed_key));
+
+  /* missing key expected present */
+  assert(VPD_OK == deleteKey(&absent, CU8"SECOND"));
+  setString(&present, CU8"THIRD", CU8"", VPD_AS_LONG_AS);
+  assert(VPD_ERR_CONDITION ==
+         checkContainer(&container, &present, &absent, &failed_key));
+  assert(!strcmp("THIRD", (const char *)failed_key));
+
+  destroyContainer(&container);
+  destroyContainer(&present);
+  destroyContainer(&absent);
+
+  printf("[PASS] %s()\n", __FUNCTION__);
+  return TEST_OK;
+}
+
+
+int testLock() {
+  char dir[] = "/tmp/vpd_lock_test.XXXXXX";
+  char path[64];
+  struct VpdLock reader1, reader2, writer;
+
+  assert(mkdtemp(dir));
+  setenv(VPD_LOCK_DIR_ENV, dir, 1);
+  unsetenv(VPD_LOCK_HELD_ENV);
+
+  /* readers share, writers wait */
+  assert(VPD_OK == vpdLock(&reader1, 0, 0));
+  assert(VPD_OK == vpdLock(&reader2, 0, 0));
+  assert(VPD_ERR_BUSY == vpdLock(&writer, 1, 0));
+  vpdUnlock(&reader1);
+  assert(VPD_ERR_BUSY == vpdLock(&writer, 1, 0));
+  vpdUnlock(&reader2);
+  vpdUnlock(&reader2);
+
+  /* writers exclude everyone */
+  assert(VPD_OK == vpdLock(&writer, 1, 0));
+  assert(VPD_ERR_BUSY == vpdLock(&reader1, 0, 0));
+  assert(VPD_ERR_BUSY == vpdLock(&reader1, 1, 0));
+
+  /* unless the lock is held by the parent */
+  setenv(VPD_LOCK_HELD_ENV, "1", 1);
+  assert(VPD_OK == vpdLock(&reader1, 1, 0));
+  assert(-1 == reader1.fd);
+  unsetenv(VPD_LOCK_HELD_ENV);
+  vpdUnlock(&writer);
+
+  snprintf(path, sizeof(path), "%s/%s", dir, VPD_LOCK_FILE);
+  unlink(path);
+  snprintf(path, sizeof(path), "%s/%s", dir, VPD_LOCK_GATE_FILE);
+  unlink(path);
+  rmdir(dir);
+  unsetenv(VPD_LOCK_DIR_ENV);
+
+  printf("[PASS] %s()\n", __FUNCTION__);
+  return TEST_OK;
+}
+
+
+int testVpdCache() {
+  char dir[] = "/tmp/vpd_cache_test.XXXXXX";
+  char path[64];
+  struct PairContainer ro, rw;
+  struct VpdCache cache;
+  const uint8_t *value;
+  const char *key;
+  uint32_t value_len;
+  uint64_t generation;
+  int type;
+  FILE *f;
+
+  assert(mkdtemp(dir));
+  snprintf(path, sizeof(path), "%s/cache", dir);
+  assert(VPD_ERR_NOT_FOUND == openVpdCache(&cache, path));
+  assert(VPD_ERR_NOT_FOUND == readVpdCacheGeneration(path, &generation));
+
+  initContainer(&ro);
+  initContainer(&rw);
+  setString(&ro, CU8"serial_number", CU8"SN1234", 0);
+  setString(&ro, CU8"region", CU8"us", 0);
+  setString(&ro, CU8"region_extra", CU8"", 0);
+  setString(&rw, CU8"gbind_attribute", CU8"abc", 0);
+  setBinary(&rw, CU8"icc", CU8"\x00\x01\xff", 3);
+  assert(VPD_OK == writeVpdCache(path, 7, &ro, &rw));
+
+  assert(VPD_OK == openVpdCache(&cache, path));
+  assert(7 == getVpdCacheGeneration(&cache));
+  assert(3 == getVpdCacheCount(&cache, VPD_CACHE_RO));
+  assert(2 == getVpdCacheCount(&cache, VPD_CACHE_RW));
+
+  /* entries are sorted by key */
+  getVpdCacheEntry(&cache, VPD_CACHE_RO, 0, &key, &value, &value_len, &type);
+  assert(!strcmp(key, "region") && 2 == value_len && !memcmp(value, "us", 2));
+  assert(VPD_TYPE_STRING == type);
+  getVpdCacheEntry(&cache, VPD_CACHE_RO, 1, &key, &value, &value_len, &type);
+  assert(!strcmp(key, "region_extra") && 0 == value_len);
+  getVpdCacheEntry(&cache, VPD_CACHE_RW, 1, &key, &value, &value_len, &type);
+  assert(!strcmp(key, "icc") && 3 == value_len &&
+         !memcmp(value, "\x00\x01\xff", 3) && VPD_TYPE_BINARY == type);
+
+  assert(VPD_OK == lookupVpdCache(&cache, VPD_CACHE_RO, "serial_number",
+                                  &value, &value_len));
+  assert(6 == value_len && !strcmp((const char *)value, "SN1234"));
+  assert(VPD_OK == lookupVpdCache(&cache, VPD_CACHE_RO, "region",
+                                  &value, &value_len));
+  assert(VPD_FAIL == lookupVpdCache(&cache, VPD_CACHE_RO, "regio",
+                                    &value, &value_len));
+  assert(VPD_FAIL == lookupVpdCache(&cache, VPD_CACHE_RO, "gbind_attribute",
+                                    &value, &value_len));
+  assert(VPD_OK == lookupVpdCache(&cache, VPD_CACHE_RW, "gbind_attribute",
+                                  &value, &value_len));
+  assert(VPD_FAIL == lookupVpdCache(&cache, VPD_CACHE_RW, "",
+                                    &value, &value_len));
+  closeVpdCache(&cache);
+
+  /* empty sections */
+  assert(VPD_OK == writeVpdCache(path, 8, NULL, NULL));
+  assert(VPD_OK == openVpdCache(&cache, path));
+  assert(0 == getVpdCacheCount(&cache, VPD_CACHE_RO));
+  assert(VPD_FAIL == lookupVpdCache(&cache, VPD_CACHE_RW, "region",
+                                    &value, &value_len));
+  closeVpdCache(&cache);
+
+  /* corrupted data fails the checksum */
+  assert(VPD_OK == writeVpdCache(path, 9, &ro, &rw));
+  f = fopen(path, "r+");
+  assert(f);
+  fseek(f, -2, SEEK_END);
+  fputc('X', f);
+  fclose(f);
+  assert(VPD_ERR_INVALID == openVpdCache(&cache, path));
+  assert(NULL == cache.data);
+  closeVpdCache(&cache);
+  /* but the generation can still be read */
+  assert(VPD_OK == readVpdCacheGeneration(path, &generation));
+  assert(9 == generation);
+
+  /* so does a truncated file */
+  f = fopen(path, "w");
+  assert(f);
+  fputs(VPD_CACHE_MAGIC, f);
+  fclose(f);
+  assert(VPD_ERR_INVALID == openVpdCache(&cache, path));
+  assert(VPD_ERR_INVALID == readVpdCacheGeneration(path, &generation));
+
+  destroyContainer(&ro);
+  destroyContainer(&rw);
+  unlink(path);
+  rmdir(dir);
+
+  printf("[PASS] %s()\n", __FUNCTION__);
+  return TEST_OK;
+}
+int testTableBuilder() {
+  const char *const spd_strings[] = { GOOGLE_SPD_VENDOR,
+                                      GOOGLE_SPD_DESCRIPTION,
+                                      GOOGLE_SPD_VARIANT };
+  const char *const vpd_strings[] = { GOOGLE_VPD_2_0_VENDOR,
+                                      GOOGLE_VPD_2_0_DESCRIPTION,
+                                      GOOGLE_VPD_2_0_VARIANT };
+  const size_t blob_len = sizeof(struct vpd_table_binary_blob_pointer);
+  const size_t spd_len = vpd_structure_size(blob_len, spd_strings, 3);
+  const size_t total = spd_len +
+                       vpd_structure_size(blob_len, vpd_strings, 3) +
+                       vpd_structure_size(0, NULL, 0);
+  struct vpd_table_builder builder;
+  struct vpd_table_binary_blob_pointer *data;
+  struct vpd_header *header;
+  struct vpd_entry *eps;
+  uint8_t partition[0x800];
+  uint8_t *reserved;
+  uint32_t offset;
+
+  /* reserved once, built in place */
+  assert(0 == vpd_table_builder_init(&builder, total));
+  reserved = builder.buf;
+  assert(0 == vpd_table_builder_add_type241(
+      &builder, GOOGLE_SPD_UUID, 0x400, 256, GOOGLE_SPD_VENDOR,
+      GOOGLE_SPD_DESCRIPTION, GOOGLE_SPD_VARIANT));
+  assert(0 == vpd_table_builder_add_type241(
+      &builder, GOOGLE_VPD_2_0_UUID, 0x600, 0x10, GOOGLE_VPD_2_0_VENDOR,
+      GOOGLE_VPD_2_0_DESCRIPTION, GOOGLE_VPD_2_0_VARIANT));
+  assert(0 == vpd_table_builder_add_type127(&builder));
+  assert(-1 == vpd_table_builder_add_type241(&builder, "bad", 0, 0, NULL,
+                                             NULL, NULL));
+  assert(reserved == builder.buf);
+  assert(total == builder.len);
+  assert(3 == builder.count);
+
+  header = (struct vpd_header *)(builder.buf + spd_len);
+  data = (struct vpd_table_binary_blob_pointer *)(header + 1);
+  assert(VPD_TYPE_BINARY_BLOB_POINTER == header->type);
+  assert(1 == header->handle);
+  assert(2 == data->description);
+  assert(!strcmp((char *)(data + 1) + strlen(GOOGLE_VPD_2_0_VENDOR) + 1,
+                 GOOGLE_VPD_2_0_DESCRIPTION));
+  assert(VPD_TYPE_END == builder.buf[total - 6]);
+  assert(0 == builder.buf[total - 1] && 0 == builder.buf[total - 2]);
+
+  /* appending without reserving grows the buffer */
+  assert(NULL != vpd_table_builder_append(&builder, 1,
+                                          sizeof(struct vpd_table_system),
+                                          spd_strings, 2, NULL));
+  assert(4 == builder.count);
+
+  /* vpd_find_blob() follows the table from the EPS */
+  memset(partition, 0xff, sizeof(partition));
+  eps = vpd_create_eps(total, 3, 0);
+  assert(eps);
+  memcpy(partition, eps, eps->entry_length);
+  memcpy(partition + eps->entry_length, builder.buf, total);
+  assert(0 == vpd_find_blob(partition, sizeof(partition),
+                            GOOGLE_VPD_2_0_UUID, &offset));
+  assert(0x600 == offset);
+  assert(-1 == vpd_find_blob(partition, sizeof(partition),
+                             GOOGLE_VPD_1_2_UUID, &offset));
+  assert(-1 == vpd_find_blob(partition, eps->entry_length + 8,
+                             GOOGLE_VPD_2_0_UUID, &offset));
+  free(eps);
+
+  vpd_table_builder_free(&builder);
+  assert(NULL == builder.buf);
+
+  printf("[PASS] %s()\n", __FUNCTION__);
+  return TEST_OK;
+}
+
+int testTableIndex() {
+  struct vpd_table_builder builder;
+  struct vpd_table_index index;
+  const struct vpd_table_binary_blob_pointer *data;
+  const char *const strings[] = { "vendor", "product" };
+  uint8_t *formatted;
+
+  assert(0 == vpd_table_builder_init(&builder, 0));
+  assert(0 == vpd_table_builder_add_type241(
+      &builder, GOOGLE_SPD_UUID, 0x400, 256, GOOGLE_SPD_VENDOR,
+      GOOGLE_SPD_DESCRIPTION, GOOGLE_SPD_VARIANT));
+  /* an unknown type is indexed, but has no blob */
+  formatted = vpd_table_builder_append(&builder, 0x80, 8, strings, 2, NULL);
+  assert(formatted);
+  formatted[4] = 1;
+  assert(0 == vpd_table_builder_add_type241(
+      &builder, GOOGLE_VPD_2_0_UUID, 0x600, 0x10, GOOGLE_VPD_2_0_VENDOR,
+      GOOGLE_VPD_2_0_DESCRIPTION, GOOGLE_VPD_2_0_VARIANT));
+  assert(0 == vpd_table_builder_add_type127(&builder));
+
+  assert(0 == vpd_index_table(builder.buf, builder.len, &index));
+  assert(4 == index.count);
+  assert(0 == index.blobs[VPD_BLOB_SPD]);
+  assert(2 == index.blobs[VPD_BLOB_VPD_2_0]);
+  assert(-1 == index.blobs[VPD_BLOB_VPD_1_2]);
+  assert(0x80 == index.structures[1].type);
+  assert(!vpd_structure_blob(&index, &index.structures[1]));
+  assert(!strcmp("vendor", vpd_structure_string(&index, &index.structures[1],
+                                                1)));
+  assert(!vpd_structure_string(&index, &index.structures[1], 3));
+  assert(!strcmp(GOOGLE_VPD_2_0_DESCRIPTION,
+                 vpd_structure_string(&index, &index.structures[2], 2)));
+  data = vpd_structure_blob(&index, &index.structures[2]);
+  assert(data && 0x600 == data->offset && 0x10 == data->size);
+  assert(VPD_TYPE_END == index.structures[3].type);
+
+  /* truncated anywhere, the table is rejected */
+  assert(-1 == vpd_index_table(builder.buf, builder.len - 1, &index));
+  assert(-1 == vpd_index_table(builder.buf, 3, &index));
+  assert(-1 == vpd_index_table(builder.buf, index.structures[1].offset + 6,
+                               &index));
+
+  /* a formatted area shorter than its header */
+  builder.buf[1] = 2;
+  assert(-1 == vpd_index_table(builder.buf, builder.len, &index));
+  /* or running past the table */
+  builder.buf[1] = 0xff;
+  assert(-1 == vpd_index_table(builder.buf, builder.len, &index));
+
+  vpd_table_builder_free(&builder);
+
+  printf("[PASS] %s()\n", __FUNCTION__);
+  return TEST_OK;
+}
+
+int testEps3() {
+  struct vpd_table_builder builder;
+  struct vpd_entry3 eps;
+  struct vpd_eps_info info;
+  uint8_t partition[0x800];
+  uint32_t offset;
+
+  assert(0 == vpd_table_builder_init(&builder, 0));
+  assert(0 == vpd_table_builder_add_type241(
+      &builder, GOOGLE_VPD_2_0_UUID, 0x10000600, 0x10, GOOGLE_VPD_2_0_VENDOR,
+      GOOGLE_VPD_2_0_DESCRIPTION, GOOGLE_VPD_2_0_VARIANT));
+  assert(0 == vpd_table_builder_add_type127(&builder));
+
+  /* a 3.0 EPS, with the partition at 0x10000000 in ROM */
+  memset(&eps, 0, sizeof(eps));
+  memcpy(eps.anchor_string, VPD_ENTRY3_MAGIC, 5);
+  eps.entry_length = sizeof(eps);
+  eps.major_ver = CONFIG_EPS3_VPD_MAJOR_VERSION;
+  eps.table_max_size = builder.len;
+  eps.table_address = 0x10000000 + sizeof(eps);
+  memset(partition, 0xff, sizeof(partition));
+  memcpy(partition, &eps, sizeof(eps));
+  memcpy(partition + sizeof(eps), builder.buf, builder.len);
+
+  assert(0 == vpd_find_eps(partition, sizeof(partition)));
+  assert(0 == vpd_read_eps(partition, sizeof(partition), 0, &info));
+  assert(CONFIG_EPS3_VPD_MAJOR_VERSION == info.major_ver);
+  assert(sizeof(eps) == info.table_offset);
+  assert(0x10000000 == info.eps_address);
+  assert(0 == vpd_find_blob(partition, sizeof(partition),
+                            GOOGLE_VPD_2_0_UUID, &offset));
+  assert(0x600 == offset);
+
+  /* the EPS must fit */
+  assert(-1 == vpd_find_eps(partition, sizeof(eps) - 1));
+  assert(-1 == vpd_read_eps(partition, sizeof(eps) - 1, 0, &info));
+  partition[offsetof(struct vpd_entry3, entry_length)] = 8;
+  assert(-1 == vpd_read_eps(partition, sizeof(partition), 0, &info));
+
+  vpd_table_builder_free(&builder);
+
+  printf("[PASS] %s()\n", __FUNCTION__);
+  return TEST_OK;
+}
+
+int testChecksum() {
+  uint8_t buf[100];
+  size_t offset, len, i;
+
+  for (i = 0; i < sizeof(buf); i++)
+    buf[i] = i * 37 + 11;
+
+  /* every alignment and length, including the SIMD tails */
+  for (offset = 0; offset < 16; offset++) {
+    for (len = 0; offset + len <= sizeof(buf); len++) {
+      uint8_t expected = 0;
+      for (i = 0; i < len; i++)
+        expected += buf[offset + i];
+      assert(expected == sum8(buf + offset, len));
+    }
+  }
+
+  buf[sizeof(buf) - 1] = 0;
+  buf[sizeof(buf) - 1] = zero8_csum(buf, sizeof(buf));
+  assert(0 == sum8(buf, sizeof(buf)));
+
+  printf("[PASS] %s()\n", __FUNCTION__);
+  return TEST_OK;
+}
 #endif
 
 
@@ -382,16 +1277,29 @@ int main() {
 #ifndef NDEBUG
   assert(TEST_OK == testEncodeLen());
   assert(TEST_OK == testDecodeLen());
+  assert(TEST_OK == testLenFastPath());
+  assert(TEST_OK == testEncodeContainerSize());
   assert(TEST_OK == testEncodeVpdString());
   assert(TEST_OK == testEncodeVpdStringPadding());
   assert(TEST_OK == testEncodeMultiStrings());
   assert(TEST_OK == testContainer());
   assert(TEST_OK == testDecodeVpdString());
+  assert(TEST_OK == testBinaryValue());
+  assert(TEST_OK == testCompression());
+  assert(TEST_OK == testPrefixKeys());
   assert(TEST_OK == testDeleteEmptyContainer());
   assert(TEST_OK == testDeleteFirstOfOne());
   assert(TEST_OK == testDeleteFirstOfTwo());
   assert(TEST_OK == testDeleteSecondOfTwo());
   assert(TEST_OK == testDeleteSecondOfThree());
+  assert(TEST_OK == testKeyFilter());
+  assert(TEST_OK == testCheckContainer());
+  assert(TEST_OK == testLock());
+  assert(TEST_OK == testVpdCache());
+  assert(TEST_OK == testTableBuilder());
+  assert(TEST_OK == testTableIndex());
+  assert(TEST_OK == testEps3());
+  assert(TEST_OK == testChecksum());
 
   printf("SUCCESS!\n");
 #endif
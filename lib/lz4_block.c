@@ -0,0 +1,171 @@
+/*
+ * Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ */
+#include <string.h>
+
+#include "lib/lz4_block.h"
+
+enum {
+  LZ4_MIN_MATCH = 4,
+  /* The last match must start at least 12 bytes before the end, and the
+   * last 5 bytes are always literals. */
+  LZ4_MF_LIMIT = 12,
+  LZ4_LAST_LITERALS = 5,
+  LZ4_MAX_OFFSET = 0xffff,
+  LZ4_HASH_BITS = 12,
+};
+
+static uint32_t _read32(const uint8_t *p) {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+static uint32_t _hash(uint32_t sequence) {
+  return (sequence * 2654435761u) >> (32 - LZ4_HASH_BITS);
+}
+
+/* Writes the part of a length beyond the 15 that fit in the token. */
+static int _putLength(size_t len, uint8_t *out, size_t max_out_len,
+                      size_t *out_pos) {
+  for (; len >= 0xff; len -= 0xff) {
+    if (*out_pos >= max_out_len)
+      return 0;
+    out[(*out_pos)++] = 0xff;
+  }
+  if (*out_pos >= max_out_len)
+    return 0;
+  out[(*out_pos)++] = len;
+  return 1;
+}
+
+/* Writes a sequence of literals and, unless match_len is 0, a match. */
+static int _putSequence(const uint8_t *literals, size_t literal_len,
+                        size_t offset, size_t match_len,
+                        uint8_t *out, size_t max_out_len, size_t *out_pos) {
+  size_t token_pos = *out_pos;
+  uint8_t token;
+
+  if (*out_pos >= max_out_len)
+    return 0;
+  (*out_pos)++;
+
+  token = (literal_len < 15 ? literal_len : 15) << 4;
+  if (literal_len >= 15 &&
+      !_putLength(literal_len - 15, out, max_out_len, out_pos))
+    return 0;
+  if (literal_len > max_out_len - *out_pos)
+    return 0;
+  memcpy(out + *out_pos, literals, literal_len);
+  *out_pos += literal_len;
+
+  if (match_len) {
+    match_len -= LZ4_MIN_MATCH;
+    token |= match_len < 15 ? match_len : 15;
+    if (max_out_len - *out_pos < 2)
+      return 0;
+    out[(*out_pos)++] = offset & 0xff;
+    out[(*out_pos)++] = offset >> 8;
+    if (match_len >= 15 &&
+        !_putLength(match_len - 15, out, max_out_len, out_pos))
+      return 0;
+  }
+  out[token_pos] = token;
+  return 1;
+}
+
+size_t lz4CompressBlock(const uint8_t *in,
+                        size_t len,
+                        uint8_t *out,
+                        size_t max_out_len) {
+  /* Positions + 1 of the last occurrence of each hashed 4 bytes. */
+  uint32_t table[1 << LZ4_HASH_BITS] = {0};
+  size_t anchor = 0, pos = 0, out_pos = 0;
+
+  /* Greedy: take the first match the hash table finds. */
+  while (len >= LZ4_MF_LIMIT && pos + LZ4_MF_LIMIT <= len) {
+    uint32_t sequence = _read32(in + pos);
+    uint32_t hash = _hash(sequence);
+    size_t ref = table[hash], match_len;
+
+    table[hash] = pos + 1;
+    if (!ref-- || pos - ref > LZ4_MAX_OFFSET ||
+        _read32(in + ref) != sequence) {
+      pos++;
+      continue;
+    }
+
+    match_len = LZ4_MIN_MATCH;
+    while (pos + match_len < len - LZ4_LAST_LITERALS &&
+           in[ref + match_len] == in[pos + match_len])
+      match_len++;
+    if (!_putSequence(in + anchor, pos - anchor, pos - ref, match_len, out,
+                      max_out_len, &out_pos))
+      return 0;
+    pos += match_len;
+    anchor = pos;
+  }
+
+  if (!_putSequence(in + anchor, len - anchor, 0, 0, out, max_out_len,
+                    &out_pos))
+    return 0;
+  return out_pos;
+}
+
+/* Reads the part of a length beyond the 15 in the token. */
+static int _getLength(const uint8_t *in, size_t len, size_t *in_pos,
+                      size_t *value) {
+  uint8_t byte;
+
+  do {
+    if (*in_pos >= len)
+      return 0;
+    byte = in[(*in_pos)++];
+    *value += byte;
+  } while (byte == 0xff);
+  return 1;
+}
+
+vpd_err_t lz4DecompressBlock(const uint8_t *in,
+                             size_t len,
+                             uint8_t *out,
+                             size_t out_len) {
+  size_t in_pos = 0, out_pos = 0;
+
+  while (in_pos < len) {
+    uint8_t token = in[in_pos++];
+    size_t literal_len = token >> 4, match_len = token & 0xf, offset;
+
+    if (literal_len == 15 && !_getLength(in, len, &in_pos, &literal_len))
+      return VPD_ERR_DECODE;
+    if (literal_len > len - in_pos || literal_len > out_len - out_pos)
+      return VPD_ERR_DECODE;
+    memcpy(out + out_pos, in + in_pos, literal_len);
+    in_pos += literal_len;
+    out_pos += literal_len;
+
+    /* The last sequence has no match. */
+    if (in_pos == len)
+      break;
+
+    if (len - in_pos < 2)
+      return VPD_ERR_DECODE;
+    offset = in[in_pos] | in[in_pos + 1] << 8;
+    in_pos += 2;
+    if (!offset || offset > out_pos)
+      return VPD_ERR_DECODE;
+    if (match_len == 15 && !_getLength(in, len, &in_pos, &match_len))
+      return VPD_ERR_DECODE;
+    match_len += LZ4_MIN_MATCH;
+    if (match_len > out_len - out_pos)
+      return VPD_ERR_DECODE;
+    /* Byte by byte: the match may overlap what it produces. */
+    for (; match_len; match_len--, out_pos++)
+      out[out_pos] = out[out_pos - offset];
+  }
+
+  return out_pos == out_len ? VPD_OK : VPD_ERR_DECODE;
+}
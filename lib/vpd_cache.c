@@ -0,0 +1,327 @@
+/*
+ * Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "lib/vpd_cache.h"
+
+/* CRC-32 with the zlib polynomial. */
+static uint32_t _crc32(const uint8_t *data, size_t len) {
+  static uint32_t table[256];
+  uint32_t crc = 0xffffffff;
+  size_t i;
+
+  if (!table[1]) {
+    uint32_t n, k, c;
+    for (n = 0; n < 256; n++) {
+      for (c = n, k = 0; k < 8; k++)
+        c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+      table[n] = c;
+    }
+  }
+  for (i = 0; i < len; i++)
+    crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+  return crc ^ 0xffffffff;
+}
+
+static const struct vpd_cache_header *_header(const struct VpdCache *cache) {
+  return (const struct vpd_cache_header *)cache->data;
+}
+
+static const struct vpd_cache_entry *_index(const struct VpdCache *cache,
+                                            int section) {
+  return (const struct vpd_cache_entry *)(
+      cache->data + _header(cache)->sections[section].index_offset);
+}
+
+/* Returns 1 if [offset, offset + len] (including the trailing '\0') is
+ * inside the cache and the byte at offset + len is '\0'. */
+static int _isValidString(const struct VpdCache *cache,
+                          uint32_t offset,
+                          uint32_t len) {
+  return offset < cache->size && len < cache->size - offset &&
+         cache->data[offset + len] == '\0';
+}
+
+static vpd_err_t _validate(const struct VpdCache *cache) {
+  const struct vpd_cache_header *header = _header(cache);
+  int section;
+  uint32_t i;
+
+  if (cache->size < sizeof(*header) ||
+      memcmp(header->magic, VPD_CACHE_MAGIC, sizeof(header->magic)) ||
+      header->version != VPD_CACHE_VERSION || header->size != cache->size)
+    return VPD_ERR_INVALID;
+  if (header->checksum != _crc32(cache->data + sizeof(*header),
+                                 cache->size - sizeof(*header)))
+    return VPD_ERR_INVALID;
+
+  /* Check the bounds once so that lookups do not have to. */
+  for (section = 0; section < VPD_CACHE_NUM_SECTIONS; section++) {
+    const struct vpd_cache_section *s = &header->sections[section];
+    const struct vpd_cache_entry *index;
+
+    if (s->index_offset > cache->size ||
+        s->num_entries > (cache->size - s->index_offset) /
+                         sizeof(struct vpd_cache_entry))
+      return VPD_ERR_INVALID;
+    index = _index(cache, section);
+    for (i = 0; i < s->num_entries; i++) {
+      if (!_isValidString(cache, index[i].key_offset, index[i].key_len) ||
+          !_isValidString(cache, index[i].value_offset, index[i].value_len))
+        return VPD_ERR_INVALID;
+    }
+  }
+  return VPD_OK;
+}
+
+vpd_err_t openVpdCache(struct VpdCache *cache, const char *path) {
+  struct stat st;
+  void *data;
+  vpd_err_t retval;
+  int fd;
+
+  cache->data = NULL;
+  cache->size = 0;
+
+  fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return errno == ENOENT ? VPD_ERR_NOT_FOUND : VPD_ERR_SYSTEM;
+  if (fstat(fd, &st) < 0) {
+    close(fd);
+    return VPD_ERR_SYSTEM;
+  }
+  if ((size_t)st.st_size < sizeof(struct vpd_cache_header) ||
+      st.st_size > UINT32_MAX) {
+    close(fd);
+    return VPD_ERR_INVALID;
+  }
+  data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+    return VPD_ERR_SYSTEM;
+
+  cache->data = data;
+  cache->size = st.st_size;
+  retval = _validate(cache);
+  if (VPD_OK != retval)
+    closeVpdCache(cache);
+  return retval;
+}
+
+void closeVpdCache(struct VpdCache *cache) {
+  if (cache->data)
+    munmap((void *)cache->data, cache->size);
+  cache->data = NULL;
+  cache->size = 0;
+}
+
+uint64_t getVpdCacheGeneration(const struct VpdCache *cache) {
+  return _header(cache)->generation;
+}
+
+vpd_err_t readVpdCacheGeneration(const char *path, uint64_t *generation) {
+  struct vpd_cache_header header;
+  ssize_t got;
+  int fd;
+
+  fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return errno == ENOENT ? VPD_ERR_NOT_FOUND : VPD_ERR_SYSTEM;
+  got = pread(fd, &header, sizeof(header), 0);
+  close(fd);
+  if (got < 0)
+    return VPD_ERR_SYSTEM;
+  if (got != sizeof(header) ||
+      memcmp(header.magic, VPD_CACHE_MAGIC, sizeof(header.magic)) ||
+      header.version != VPD_CACHE_VERSION)
+    return VPD_ERR_INVALID;
+  *generation = header.generation;
+  return VPD_OK;
+}
+
+uint32_t getVpdCacheCount(const struct VpdCache *cache, int section) {
+  return _header(cache)->sections[section].num_entries;
+}
+
+void getVpdCacheEntry(const struct VpdCache *cache,
+                      int section,
+                      uint32_t index,
+                      const char **key,
+                      const uint8_t **value,
+                      uint32_t *value_len,
+                      int *type) {
+  const struct vpd_cache_entry *entry = &_index(cache, section)[index];
+
+  *key = (const char *)cache->data + entry->key_offset;
+  *value = cache->data + entry->value_offset;
+  *value_len = entry->value_len;
+  *type = entry->type;
+}
+
+vpd_err_t lookupVpdCache(const struct VpdCache *cache,
+                         int section,
+                         const char *key,
+                         const uint8_t **value,
+                         uint32_t *value_len) {
+  const struct vpd_cache_entry *index = _index(cache, section);
+  uint32_t low = 0, high = getVpdCacheCount(cache, section);
+  size_t key_len = strlen(key);
+
+  while (low < high) {
+    uint32_t mid = low + (high - low) / 2;
+    const struct vpd_cache_entry *entry = &index[mid];
+    /* Compare the '\0' too, so that a prefix sorts first. */
+    int cmp = memcmp(key, cache->data + entry->key_offset,
+                     (key_len < entry->key_len ? key_len : entry->key_len) + 1);
+
+    if (!cmp) {
+      *value = cache->data + entry->value_offset;
+      *value_len = entry->value_len;
+      return VPD_OK;
+    }
+    if (cmp < 0)
+      high = mid;
+    else
+      low = mid + 1;
+  }
+  return VPD_FAIL;
+}
+
+/***********************************************************************
+ * Writer
+ ***********************************************************************/
+
+static int _comparePairs(const void *a, const void *b) {
+  const struct StringPair *pa = *(const struct StringPair *const *)a;
+  const struct StringPair *pb = *(const struct StringPair *const *)b;
+
+  return strcmp((const char *)pa->key, (const char *)pb->key);
+}
+
+/* Returns the pairs of container sorted by key in a malloc()ed array. */
+static const struct StringPair **_sortedPairs(
+    const struct PairContainer *container, uint32_t *count) {
+  const struct StringPair **pairs;
+  const struct StringPair *pair;
+  uint32_t i = 0;
+
+  *count = container ? lenOfContainer(container) : 0;
+  pairs = malloc((*count + 1) * sizeof(*pairs));
+  if (!pairs)
+    return NULL;
+  for (pair = container ? container->first : NULL; pair; pair = pair->next)
+    pairs[i++] = pair;
+  qsort(pairs, *count, sizeof(*pairs), _comparePairs);
+  return pairs;
+}
+
+vpd_err_t writeVpdCache(const char *path,
+                        uint64_t generation,
+                        const struct PairContainer *ro,
+                        const struct PairContainer *rw) {
+  const struct PairContainer *containers[VPD_CACHE_NUM_SECTIONS] = {ro, rw};
+  const struct StringPair **pairs[VPD_CACHE_NUM_SECTIONS] = {NULL, NULL};
+  uint32_t counts[VPD_CACHE_NUM_SECTIONS];
+  struct vpd_cache_header *header;
+  struct vpd_cache_entry *entry;
+  uint8_t *out = NULL;
+  size_t size, data_offset;
+  char tmp_path[PATH_MAX];
+  vpd_err_t retval = VPD_ERR_SYSTEM;
+  int section;
+  uint32_t i;
+  int fd;
+
+  /* Sort and size everything first. */
+  size = sizeof(*header);
+  for (section = 0; section < VPD_CACHE_NUM_SECTIONS; section++) {
+    pairs[section] = _sortedPairs(containers[section], &counts[section]);
+    if (!pairs[section])
+      goto out;
+    for (i = 0; i < counts[section]; i++) {
+      /* The cache has the values decompressed. */
+      if (!getPairValue(pairs[section][i])) {
+        retval = VPD_ERR_DECODE;
+        goto out;
+      }
+      size += sizeof(*entry) +
+              strlen((const char *)pairs[section][i]->key) + 1 +
+              pairs[section][i]->value_len + 1;
+    }
+  }
+  if (size > UINT32_MAX) {
+    retval = VPD_ERR_OVERFLOW;
+    goto out;
+  }
+  out = calloc(1, size);
+  if (!out)
+    goto out;
+
+  header = (struct vpd_cache_header *)out;
+  memcpy(header->magic, VPD_CACHE_MAGIC, sizeof(header->magic));
+  header->version = VPD_CACHE_VERSION;
+  header->size = size;
+  header->generation = generation;
+
+  entry = (struct vpd_cache_entry *)(out + sizeof(*header));
+  data_offset = sizeof(*header) +
+                (counts[VPD_CACHE_RO] + counts[VPD_CACHE_RW]) * sizeof(*entry);
+  for (section = 0; section < VPD_CACHE_NUM_SECTIONS; section++) {
+    header->sections[section].num_entries = counts[section];
+    header->sections[section].index_offset = (uint8_t *)entry - out;
+    for (i = 0; i < counts[section]; i++, entry++) {
+      const char *key = (const char *)pairs[section][i]->key;
+      const uint8_t *value = getPairValue(pairs[section][i]);
+
+      entry->key_offset = data_offset;
+      entry->key_len = strlen(key);
+      memcpy(out + data_offset, key, entry->key_len + 1);
+      data_offset += entry->key_len + 1;
+      entry->value_offset = data_offset;
+      entry->value_len = pairs[section][i]->value_len;
+      entry->type = pairs[section][i]->type;
+      memcpy(out + data_offset, value, entry->value_len + 1);
+      data_offset += entry->value_len + 1;
+    }
+  }
+  header->checksum = _crc32(out + sizeof(*header), size - sizeof(*header));
+
+  /* Write a temporary file next to path and rename it over, so that readers
+   * always see a complete cache. Like mkstemp(), the cache is only readable
+   * by its owner. */
+  if (snprintf(tmp_path, sizeof(tmp_path), "%s.XXXXXX", path) >=
+      (int)sizeof(tmp_path))
+    goto out;
+  fd = mkstemp(tmp_path);
+  if (fd < 0)
+    goto out;
+  if (write(fd, out, size) != (ssize_t)size || fsync(fd) < 0) {
+    close(fd);
+    unlink(tmp_path);
+    goto out;
+  }
+  close(fd);
+  if (rename(tmp_path, path) < 0) {
+    unlink(tmp_path);
+    goto out;
+  }
+  retval = VPD_OK;
+
+out:
+  for (section = 0; section < VPD_CACHE_NUM_SECTIONS; section++)
+    free(pairs[section]);
+  free(out);
+  return retval;
+}
@@ -8,7 +8,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "lib/base64.h"
 #include "lib/lib_vpd.h"
+#include "lib/lz4_block.h"
 
 
 #ifndef MIN
@@ -54,39 +56,56 @@ struct StringPair *findString(struct PairContainer *container,
   return NULL;
 }
 
-/* Just a helper function for setString() */
+/* Returns a copy of len bytes of data, followed by a '\0'. */
+static uint8_t *_copyBytes(const uint8_t *data, const int len) {
+  uint8_t *copy = malloc(len + 1);
+  assert(copy);
+  memcpy(copy, data, len);
+  copy[len] = '\0';
+  return copy;
+}
+
+/* Just a helper function for _setPair(). value may be NULL if the packed
+ * value is set afterwards. */
 static void fillStringPair(struct StringPair *pair,
                            const uint8_t *key,
+                           const int type,
                            const uint8_t *value,
+                           const int value_len,
                            const int pad_len) {
   pair->key = malloc(strlen((char*)key) + 1);
   assert(pair->key);
   strcpy((char*)pair->key, (char*)key);
-  pair->value = malloc(strlen((char*)value) + 1);
-  strcpy((char*)pair->value, (char*)value);
+  pair->value = value ? _copyBytes(value, value_len) : NULL;
+  pair->type = type;
+  pair->value_len = value_len;
   pair->pad_len = pad_len;
+  pair->packed = NULL;
+  pair->packed_len = 0;
 }
 
-/* If key is already existed in container, its value will be replaced.
- * If not existed, creates new entry in container.
- */
-void setString(struct PairContainer *container,
-               const uint8_t *key,
-               const uint8_t *value,
-               const int pad_len) {
+/* The common part of setString() and setBinary(). Returns the pair. */
+static struct StringPair *_setPair(struct PairContainer *container,
+                                   const uint8_t *key,
+                                   const int type,
+                                   const uint8_t *value,
+                                   const int value_len,
+                                   const int pad_len) {
   struct StringPair *found;
 
   found = findString(container, key, NULL);
   if (found) {
     free(found->key);
     free(found->value);
-    fillStringPair(found, key, value, pad_len);
+    free(found->packed);
+    fillStringPair(found, key, type, value, value_len, pad_len);
+    return found;
   } else {
     struct StringPair *new_pair = malloc(sizeof(struct StringPair));
     assert(new_pair);
     memset(new_pair, 0, sizeof(struct StringPair));
 
-    fillStringPair(new_pair, key, value, pad_len);
+    fillStringPair(new_pair, key, type, value, value_len, pad_len);
 
     /* append this pair to the end of list. to keep the order */
     if ((found = container->first)) {
@@ -96,6 +115,125 @@ void setString(struct PairContainer *container,
       container->first = new_pair;
     }
     new_pair->next = NULL;
+    return new_pair;
+  }
+}
+
+/* If key is already existed in container, its value will be replaced.
+ * If not existed, creates new entry in container.
+ */
+void setString(struct PairContainer *container,
+               const uint8_t *key,
+               const uint8_t *value,
+               const int pad_len) {
+  _setPair(container, key, VPD_TYPE_STRING, value, strlen((char*)value),
+           pad_len);
+}
+
+void setBinary(struct PairContainer *container,
+               const uint8_t *key,
+               const uint8_t *value,
+               const int value_len) {
+  _setPair(container, key, VPD_TYPE_BINARY, value, value_len,
+           VPD_AS_LONG_AS);
+}
+
+/* Adds a binary value of value_len bytes that is only known packed. */
+static void _setPacked(struct PairContainer *container,
+                       const uint8_t *key,
+                       const uint8_t *packed,
+                       const int packed_len,
+                       const int value_len) {
+  struct StringPair *pair = _setPair(container, key, VPD_TYPE_BINARY, NULL,
+                                     value_len, VPD_AS_LONG_AS);
+  pair->packed = _copyBytes(packed, packed_len);
+  pair->packed_len = packed_len;
+}
+
+/* Parses the length in front of a packed value. Returns VPD_OK and the
+ * length of the value and of the LZ4 block that follows. */
+static vpd_err_t _parsePacked(const uint8_t *packed,
+                              const uint32_t packed_len,
+                              uint32_t *value_len,
+                              uint32_t *block_offset) {
+  if (VPD_OK != decodeLen(packed_len, packed, value_len, block_offset))
+    return VPD_ERR_DECODE;
+  /* An LZ4 block cannot expand more than 255 times. */
+  if (*value_len > INT32_MAX - 1 ||
+      *value_len / 255 > packed_len - *block_offset)
+    return VPD_ERR_DECODE;
+  return VPD_OK;
+}
+
+vpd_err_t unpackValue(const uint8_t *packed,
+                      const uint32_t packed_len,
+                      uint8_t **value,
+                      uint32_t *value_len) {
+  uint32_t block_offset;
+
+  if (VPD_OK != _parsePacked(packed, packed_len, value_len, &block_offset))
+    return VPD_ERR_DECODE;
+  *value = malloc(*value_len + 1);
+  assert(*value);
+  if (VPD_OK != lz4DecompressBlock(packed + block_offset,
+                                   packed_len - block_offset, *value,
+                                   *value_len)) {
+    free(*value);
+    *value = NULL;
+    return VPD_ERR_DECODE;
+  }
+  (*value)[*value_len] = '\0';
+  return VPD_OK;
+}
+
+const uint8_t *getPairValue(const struct StringPair *pair) {
+  struct StringPair *mutable_pair = (struct StringPair *)pair;
+  uint32_t value_len;
+  uint8_t *value;
+
+  if (pair->value || !pair->packed)
+    return pair->value;
+
+  if (VPD_OK != unpackValue(pair->packed, pair->packed_len, &value,
+                            &value_len))
+    return NULL;
+  if (value_len != pair->value_len) {
+    free(value);
+    return NULL;
+  }
+  mutable_pair->value = value;
+  return value;
+}
+
+void packContainer(struct PairContainer *container, const int min_len) {
+  struct StringPair *current;
+
+  if (min_len <= 0)
+    return;
+
+  for (current = container->first; current; current = current->next) {
+    uint8_t *packed;
+    int32_t len_size;
+    size_t block_len;
+
+    if (current->type != VPD_TYPE_BINARY || current->packed ||
+        current->value_len < min_len)
+      continue;
+
+    /* Only worth it if the record gets smaller. */
+    packed = malloc(current->value_len);
+    assert(packed);
+    if (VPD_OK != encodeLen(current->value_len, packed, current->value_len,
+                            &len_size) ||
+        current->value_len - len_size <= 1 ||
+        !(block_len = lz4CompressBlock(current->value, current->value_len,
+                                       packed + len_size,
+                                       current->value_len - len_size - 1))) {
+      free(packed);
+      continue;
+    }
+    current->packed = packed;
+    current->packed_len = len_size + block_len;
   }
 }
 
@@ -112,6 +250,7 @@ vpd_err_t deleteKey(struct PairContainer *container,
   if (found) {
     free(found->key);
     free(found->value);
+    free(found->packed);
 
     /* remove the 'found' from the linked list. */
     assert(prev_next);
@@ -148,7 +287,15 @@ void mergeContainer(struct PairContainer *dst,
   struct StringPair *current;
 
   for (current = src->first; current; current = current->next) {
-    setString(dst, current->key, current->value, current->pad_len);
+    struct StringPair *pair = _setPair(dst, current->key, current->type,
+                                       current->value, current->value_len,
+                                       current->pad_len);
+    if (current->prefix_key)
+      pair->prefix_key = 1;
+    if (current->packed) {
+      pair->packed = _copyBytes(current->packed, current->packed_len);
+      pair->packed_len = current->packed_len;
+    }
   }
 }
 
@@ -167,39 +314,262 @@ int subtractContainer(struct PairContainer *dst,
 }
 
 
+vpd_err_t checkContainer(struct PairContainer *container,
+                         const struct PairContainer *present,
+                         const struct PairContainer *absent,
+                         const uint8_t **failed_key) {
+  struct StringPair *current, *found;
+
+  for (current = present->first; current; current = current->next) {
+    found = findString(container, current->key, NULL);
+    if (!found || found->value_len != current->value_len ||
+        !getPairValue(found) ||
+        memcmp(found->value, current->value, current->value_len)) {
+      if (failed_key)
+        *failed_key = current->key;
+      return VPD_ERR_CONDITION;
+    }
+  }
+  for (current = absent->first; current; current = current->next) {
+    if (findString(container, current->key, NULL)) {
+      if (failed_key)
+        *failed_key = current->key;
+      return VPD_ERR_CONDITION;
+    }
+  }
+
+  return VPD_OK;
+}
+
+
+/* Where encodeContainer() puts a string if some have prefix_key set. */
+struct KeyPlan {
+  int shared;  /* bytes shared with the key of anchor, 0 if stored in full */
+  int anchor;  /* index of the pair whose key is shared */
+  int offset;  /* of the record, from the first string */
+};
+
+/* Returns the length of the value of the string record of pair. */
+static int _paddedValueLen(const struct StringPair *pair) {
+  return pair->pad_len == VPD_AS_LONG_AS ? pair->value_len : pair->pad_len;
+}
+
+/* Returns TRUE if some string of container may be prefix-coded. */
+static int _hasPrefixKeys(const struct PairContainer *container) {
+  struct StringPair *current;
+
+  for (current = container->first; current; current = current->next) {
+    if (current->prefix_key && current->type == VPD_TYPE_STRING)
+      return 1;
+  }
+  return 0;
+}
+
+/* Returns a KeyPlan for each pair in container, and in *size the number of
+ * bytes the strings take. Strings with prefix_key sharing enough with the
+ * full key of an earlier one point back at it; all others are stored in
+ * full, first.
+ */
+static struct KeyPlan *_planPrefixKeys(const struct PairContainer *container,
+                                       int *size) {
+  struct KeyPlan *plans = calloc(lenOfContainer(container) + 1,
+                                 sizeof(*plans));
+  struct StringPair *current, *anchor;
+  int i, j;
+
+  assert(plans);
+  *size = 0;
+  for (i = 0, current = container->first; current;
+       i++, current = current->next) {
+    if (current->type != VPD_TYPE_STRING)
+      continue;
+    for (j = 0, anchor = container->first; current->prefix_key && j < i;
+         j++, anchor = anchor->next) {
+      int shared = 0;
+
+      if (anchor->type != VPD_TYPE_STRING || plans[j].shared)
+        continue;
+      while (current->key[shared] &&
+             current->key[shared] == anchor->key[shared])
+        shared++;
+      if (shared >= VPD_PREFIX_MIN_LEN && shared > plans[i].shared) {
+        plans[i].shared = shared;
+        plans[i].anchor = j;
+      }
+    }
+    if (plans[i].shared)
+      continue;
+    plans[i].offset = *size;
+    *size += encodeVpdStringSize(strlen((char *)current->key),
+                                 _paddedValueLen(current));
+  }
+  for (i = 0, current = container->first; current;
+       i++, current = current->next) {
+    if (!plans[i].shared)
+      continue;
+    plans[i].offset = *size;
+    *size += encodeVpdPrefixStringSize(
+        plans[i].offset - plans[plans[i].anchor].offset, plans[i].shared,
+        strlen((char *)current->key), _paddedValueLen(current));
+  }
+  return plans;
+}
+
+int encodeContainerSize(const struct PairContainer *container) {
+  struct StringPair *current;
+  int size = 0;
+  int planned = _hasPrefixKeys(container);
+
+  if (planned)
+    free(_planPrefixKeys(container, &size));
+
+  for (current = container->first; current; current = current->next) {
+    int value_len = current->pad_len;
+
+    if (planned && current->type == VPD_TYPE_STRING)
+      continue;
+
+    if (current->packed)
+      value_len = current->packed_len;
+    else if (value_len == VPD_AS_LONG_AS)
+      value_len = current->value_len;
+    size += encodeVpdStringSize(strlen((char *)current->key), value_len);
+  }
+  return size;
+}
+
+/* Encodes the strings of container that _planPrefixKeys() points back at
+ * other strings. */
+static vpd_err_t _encodePrefixStrings(const struct PairContainer *container,
+                                      const struct KeyPlan *plans,
+                                      const int max_buf_len,
+                                      uint8_t *buf,
+                                      int *generated) {
+  struct StringPair *current;
+  int i;
+
+  for (i = 0, current = container->first; current;
+       i++, current = current->next) {
+    if (!plans[i].shared)
+      continue;
+    if (VPD_OK != encodeVpdPrefixString(
+                      plans[i].offset - plans[plans[i].anchor].offset,
+                      current->key,
+                      plans[i].shared,
+                      current->value,
+                      current->pad_len,
+                      max_buf_len,
+                      buf,
+                      generated)) {
+      return VPD_FAIL;
+    }
+  }
+  return VPD_OK;
+}
+
 vpd_err_t encodeContainer(const struct PairContainer *container,
                           const int max_buf_len,
                           uint8_t *buf,
                           int *generated) {
   struct StringPair *current;
+  struct KeyPlan *plans = NULL;
+  vpd_err_t retval;
+  int size, i;
 
-  for (current = container->first; current; current = current->next) {
+  if (_hasPrefixKeys(container))
+    plans = _planPrefixKeys(container, &size);
+
+  for (i = 0, current = container->first; current;
+       i++, current = current->next) {
+    if (current->type != VPD_TYPE_STRING || (plans && plans[i].shared))
+      continue;
     if (VPD_OK != encodeVpdString(current->key,
                                   current->value,
                                   current->pad_len,
                                   max_buf_len,
                                   buf,
                                   generated)) {
+      free(plans);
+      return VPD_FAIL;
+    }
+  }
+  if (plans) {
+    retval = _encodePrefixStrings(container, plans, max_buf_len, buf,
+                                  generated);
+    free(plans);
+    if (VPD_OK != retval)
+      return retval;
+  }
+  for (current = container->first; current; current = current->next) {
+    if (current->type != VPD_TYPE_BINARY)
+      continue;
+    if (current->packed) {
+      if (VPD_OK != encodeVpdCompressed(current->key,
+                                        current->packed,
+                                        current->packed_len,
+                                        max_buf_len,
+                                        buf,
+                                        generated)) {
+        return VPD_FAIL;
+      }
+    } else if (VPD_OK != encodeVpdBinary(current->key,
+                                         current->value,
+                                         current->value_len,
+                                         max_buf_len,
+                                         buf,
+                                         generated)) {
       return VPD_FAIL;
     }
   }
   return VPD_OK;
 }
 
-static int callbackDecodeToContainer(const uint8_t *key,
-                                           uint32_t key_len,
-                                           const uint8_t *value,
-                                           uint32_t value_len,
-                                           void *arg) {
+/* Returns a copy of the key of a decoded record, followed by a '\0'. */
+static uint8_t *_joinKey(const uint8_t *key_prefix,
+                         uint32_t key_prefix_len,
+                         const uint8_t *key,
+                         uint32_t key_len) {
+  uint8_t *key_string = malloc(key_prefix_len + key_len + 1);
+  assert(key_string);
+  memcpy(key_string, key_prefix, key_prefix_len);
+  memcpy(key_string + key_prefix_len, key, key_len);
+  key_string[key_prefix_len + key_len] = '\0';
+  return key_string;
+}
+
+static int callbackDecodeToContainer(const uint8_t type,
+                                     const uint8_t *key_prefix,
+                                     uint32_t key_prefix_len,
+                                     const uint8_t *key,
+                                     uint32_t key_len,
+                                     const uint8_t *value,
+                                     uint32_t value_len,
+                                     void *arg) {
   struct PairContainer *container = (struct PairContainer*)arg;
-  uint8_t *key_string = (uint8_t*)malloc(key_len + 1),
-          *value_string = (uint8_t*)malloc(value_len + 1);
-  assert(key_string && value_string);
-  memcpy(key_string, key, key_len);
-  memcpy(value_string, value, value_len);
-  key_string[key_len] = '\0';
-  value_string[value_len] = '\0';
-  setString(container, key_string, value_string, value_len);
+  uint8_t *key_string, *value_string;
+
+  if (type == VPD_TYPE_COMPRESSED) {
+    uint32_t unpacked_len, block_offset;
+
+    /* Decompressed only when the value is used. */
+    if (VPD_OK != _parsePacked(value, value_len, &unpacked_len,
+                               &block_offset))
+      return VPD_DECODE_FAIL;
+    key_string = _joinKey(key_prefix, key_prefix_len, key, key_len);
+    _setPacked(container, key_string, value, value_len, unpacked_len);
+    free(key_string);
+    return VPD_DECODE_OK;
+  }
+
+  key_string = _joinKey(key_prefix, key_prefix_len, key, key_len);
+  value_string = _copyBytes(value, value_len);
+  if (type == VPD_TYPE_BINARY)
+    setBinary(container, key_string, value_string, value_len);
+  else
+    setString(container, key_string, value_string, value_len);
+  /* Written back the same way. */
+  if (type == VPD_TYPE_PREFIX_STRING)
+    findString(container, key_string, NULL)->prefix_key = 1;
   /* setString() makes its own copies. */
   free(key_string);
   free(value_string);
@@ -210,27 +580,83 @@ vpd_err_t decodeToContainer(struct PairContainer *container,
                             const uint32_t max_len,
                             const uint8_t *input_buf,
                             uint32_t *consumed) {
-  return decodeVpdString(max_len, input_buf, consumed,
+  return decodeVpdRecord(max_len, input_buf, consumed,
                          callbackDecodeToContainer, (void*)container);
 }
 
+struct FilteredDecodeArg {
+  struct PairContainer *container;
+  const struct VpdKeyFilter *filter;
+};
+
+static int callbackDecodeToContainerFiltered(const uint8_t type,
+                                             const uint8_t *key_prefix,
+                                             uint32_t key_prefix_len,
+                                             const uint8_t *key,
+                                             uint32_t key_len,
+                                             const uint8_t *value,
+                                             uint32_t value_len,
+                                             void *arg) {
+  struct FilteredDecodeArg *decode_arg = (struct FilteredDecodeArg*)arg;
+  uint8_t *key_string;
+  int matched;
+
+  if (!key_prefix_len) {
+    matched = matchKeyFilter(decode_arg->filter, key, key_len);
+  } else {
+    key_string = _joinKey(key_prefix, key_prefix_len, key, key_len);
+    matched = matchKeyFilter(decode_arg->filter, key_string,
+                             key_prefix_len + key_len);
+    free(key_string);
+  }
+  if (!matched)
+    return VPD_DECODE_OK;
+  return callbackDecodeToContainer(type, key_prefix, key_prefix_len, key,
+                                   key_len, value, value_len,
+                                   decode_arg->container);
+}
+
+vpd_err_t decodeToContainerFiltered(struct PairContainer *container,
+                                    const struct VpdKeyFilter *filter,
+                                    const uint32_t max_len,
+                                    const uint8_t *input_buf,
+                                    uint32_t *consumed) {
+  struct FilteredDecodeArg arg = { container, filter };
+
+  if (!filter || isKeyFilterEmpty(filter))
+    return decodeToContainer(container, max_len, input_buf, consumed);
+  return decodeVpdRecord(max_len, input_buf, consumed,
+                         callbackDecodeToContainerFiltered, (void*)&arg);
+}
+
 vpd_err_t setContainerFilter(struct PairContainer *container,
                              const uint8_t *filter) {
+  struct VpdKeyFilter key_filter;
+  vpd_err_t retval;
+
+  initKeyFilter(&key_filter);
+  if (filter) {
+    retval = addKeyFilterKey(&key_filter, (const char*)filter,
+                             strlen((const char*)filter));
+    if (VPD_OK != retval) {
+      destroyKeyFilter(&key_filter);
+      return retval;
+    }
+  }
+  retval = setContainerKeyFilter(container, &key_filter);
+  destroyKeyFilter(&key_filter);
+  return retval;
+}
+
+vpd_err_t setContainerKeyFilter(struct PairContainer *container,
+                                const struct VpdKeyFilter *filter) {
   struct StringPair *str;
+  int match_all = !filter || isKeyFilterEmpty(filter);
 
   for (str = container->first; str; str = str->next) {
-    if (filter) {
-      /*
-       * TODO(yjlou):
-       * Now, we treat the inputing filter string as plain string.
-       * Will support regular expression syntax in future if needed.
-       */
-      if (strcmp((char*)str->key, (char*)filter)) {
-        str->filter_out = 1;
-      }
-    } else {
-      str->filter_out = 0;
-    }
+    str->filter_out =
+        !match_all &&
+        !matchKeyFilter(filter, str->key, strlen((char*)str->key));
   }
   return VPD_OK;
 }
@@ -258,25 +684,51 @@ static vpd_err_t _appendToBuf(const void *buf_to_append,
  * value field of an instance of StringPair.
  */
 static int _getStringPairValueLen(const struct StringPair *str) {
-  int len = strlen((const char*)(str->value));
+  int len = str->value_len;
   return VPD_AS_LONG_AS == str->pad_len ? len : MIN(str->pad_len, len);
 }
 
 
+/*
+ * A helper function to append the value of an instance of StringPair to the
+ * given buffer as text: strings as they are, binary values in base64.
+ */
+static vpd_err_t _appendValueTextToBuf(const struct StringPair *str,
+                                       const int max_buf_len,
+                                       uint8_t *buf,
+                                       int *generated) {
+  const uint8_t *value = getPairValue(str);
+  int len;
+
+  if (!value) return VPD_ERR_DECODE;
+  if (str->type != VPD_TYPE_BINARY)
+    return _appendToBuf(value, _getStringPairValueLen(str),
+                        max_buf_len, buf, generated);
+
+  len = base64EncodedSize(str->value_len);
+  if (*generated + len > max_buf_len) return VPD_ERR_OVERFLOW;
+  base64Encode(value, str->value_len, (char*)&buf[*generated]);
+  *generated += len;
+  return VPD_OK;
+}
+
+
 /* A helper function to export an instance of StringPair to the given buffer. */
 static vpd_err_t _exportStringPairKeyValue(const struct StringPair *str,
                                            const int max_buf_len,
                                            uint8_t *buf,
                                            int *generated) {
-  const void *strs[5] = {"\"", str->key, "\"=\"", str->value, "\"\n"};
-  const int lens[5] = {
-      1, strlen((const char*)str->key), 3, _getStringPairValueLen(str), 2};
+  const void *strs[5] = {"\"", str->key, "\"=\"", NULL, "\"\n"};
+  const int lens[5] = {1, strlen((const char*)str->key), 3, 0, 2};
 
   int retval;
   int i;
 
   for (i = 0; i < sizeof(lens) / sizeof(int); ++i) {
-    retval = _appendToBuf(strs[i], lens[i], max_buf_len, buf, generated);
+    if (strs[i])
+      retval = _appendToBuf(strs[i], lens[i], max_buf_len, buf, generated);
+    else
+      retval = _appendValueTextToBuf(str, max_buf_len, buf, generated);
     if (VPD_OK != retval) {
       break;
     }
@@ -322,7 +774,11 @@ static vpd_err_t _exportStringPairAsParameter(const struct StringPair *str,
 
   {
     char extra_params[32];
-    snprintf(extra_params, sizeof(extra_params), "    -p %d -s ", str->pad_len);
+    if (str->type == VPD_TYPE_BINARY)
+      snprintf(extra_params, sizeof(extra_params), "    -b ");
+    else
+      snprintf(extra_params, sizeof(extra_params), "    -p %d -s ",
+               str->pad_len);
     retval = _appendToBuf(extra_params, strlen(extra_params),
                           max_buf_len, buf, generated);
     if (VPD_OK != retval) return retval;
@@ -338,8 +794,12 @@ static vpd_err_t _exportStringPairAsParameter(const struct StringPair *str,
   if (*generated + 1 > max_buf_len) return VPD_ERR_OVERFLOW;
   buf[(*generated)++] = '=';
 
-  retval = _appendToBufWithShellEscape(
-      (const char*)str->value, max_buf_len, buf, generated);
+  /* base64 needs no escaping. */
+  if (str->type == VPD_TYPE_BINARY)
+    retval = _appendValueTextToBuf(str, max_buf_len, buf, generated);
+  else
+    retval = _appendToBufWithShellEscape(
+        (const char*)str->value, max_buf_len, buf, generated);
   if (VPD_OK != retval) return retval;
 
   retval = _appendToBuf("' \\\n", 4, max_buf_len, buf, generated);
@@ -365,8 +825,7 @@ static vpd_err_t _exportStringPairNullTerminate(const struct StringPair *str,
   if (*generated + 1 > max_buf_len) return VPD_ERR_OVERFLOW;
   buf[(*generated)++] = '=';
 
-  retval = _appendToBuf(str->value, _getStringPairValueLen(str),
-                        max_buf_len, buf, generated);
+  retval = _appendValueTextToBuf(str, max_buf_len, buf, generated);
   if (VPD_OK != retval) return retval;
 
   if (*generated + 1 > max_buf_len) return VPD_ERR_OVERFLOW;
@@ -381,13 +840,54 @@ vpd_err_t exportStringValue(const struct StringPair *str,
                             const int max_buf_len,
                             uint8_t *buf,
                             int *generated) {
+  const uint8_t *value = getPairValue(str);
+
   assert(generated);
 
-  return _appendToBuf(str->value, _getStringPairValueLen(str),
+  if (!value) return VPD_ERR_DECODE;
+  return _appendToBuf(value, _getStringPairValueLen(str),
                       max_buf_len, buf, generated);
 }
 
 
+/* Export the result of looking up a key with its found/missing status. */
+vpd_err_t exportLookupResult(const int export_type,
+                             const uint8_t *key,
+                             const struct StringPair *str,
+                             const int max_buf_len,
+                             uint8_t *buf,
+                             int *generated) {
+  int index;
+  int retval;
+
+  assert(generated);
+  index = *generated;
+
+  retval = _appendToBuf(str ? "+" : "-", 1, max_buf_len, buf, &index);
+  if (VPD_OK != retval) return retval;
+
+  retval = _appendToBuf(key, strlen((const char*)key),
+                        max_buf_len, buf, &index);
+  if (VPD_OK != retval) return retval;
+
+  if (str) {
+    retval = _appendToBuf("=", 1, max_buf_len, buf, &index);
+    if (VPD_OK != retval) return retval;
+
+    retval = _appendValueTextToBuf(str, max_buf_len, buf, &index);
+    if (VPD_OK != retval) return retval;
+  }
+
+  retval = _appendToBuf(VPD_EXPORT_NULL_TERMINATE == export_type ? "" : "\n",
+                        1, max_buf_len, buf, &index);
+  if (VPD_OK != retval) return retval;
+
+  *generated = index;
+
+  return VPD_OK;
+}
+
+
 /* Export the container content with human-readable text. */
 vpd_err_t exportContainer(const int export_type,
                           const struct PairContainer *container,
@@ -431,6 +931,7 @@ void destroyContainer(struct PairContainer *container) {
 
     if (current->key) free(current->key);
     if (current->value) free(current->value);
+    free(current->packed);
     next = current->next;
     free(current);
     current = next;
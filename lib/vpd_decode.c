@@ -5,7 +5,11 @@
  */
 #include "vpd_decode.h"
 
-static int vpd_decode_len(
+/*
+ * Reference decoder, one byte at a time. vpd_decode_len() falls back to it
+ * for lengths of three bytes or more.
+ */
+static int vpd_decode_len_ref(
 		const u32 max_len, const u8 *in, u32 *length, u32 *decoded_len)
 {
 	u8 more;
@@ -29,6 +33,32 @@ static int vpd_decode_len(
 	return VPD_DECODE_OK;
 }
 
+/*
+ * Lengths below 0x4000, one or two bytes, cover almost every key and value.
+ * They are decoded without branching on the first byte.
+ */
+static int vpd_decode_len(
+		const u32 max_len, const u8 *in, u32 *length, u32 *decoded_len)
+{
+	u32 more, mask;
+
+	if (!length || !decoded_len)
+		return VPD_DECODE_FAIL;
+
+	if (max_len < 2)
+		return vpd_decode_len_ref(max_len, in, length, decoded_len);
+
+	more = in[0] >> 7;
+	if (more & (in[1] >> 7))
+		return vpd_decode_len_ref(max_len, in, length, decoded_len);
+
+	/* in[1] only counts if in[0] has the MORE bit. */
+	mask = 0 - more;
+	*length = ((u32)(in[0] & 0x7f) << (7 & mask)) | (in[1] & mask);
+	*decoded_len = 1 + more;
+	return VPD_DECODE_OK;
+}
+
 static int vpd_decode_entry(
 		const u32 max_len, const u8 *input_buf, u32 *consumed,
 		const u8 **entry, u32 *entry_len)
@@ -52,38 +82,86 @@ static int vpd_decode_entry(
 	return VPD_DECODE_OK;
 }
 
-int vpd_decode_string(
+/*
+ * Splits the key of the VPD_TYPE_PREFIX_STRING record at start into the
+ * shared bytes of the key it points back to, and the rest.
+ */
+static int vpd_decode_prefix_key(
+		const u8 *input_buf, const u32 start, const u8 **key_prefix,
+		u32 *key_prefix_len, const u8 **key, u32 *key_len)
+{
+	u32 back, back_len, shared_len, anchor_key_len;
+	u32 anchor;
+
+	if (vpd_decode_len(*key_len, *key, &back, &back_len) != VPD_DECODE_OK ||
+	    vpd_decode_len(*key_len - back_len, *key + back_len,
+			   key_prefix_len, &shared_len) != VPD_DECODE_OK)
+		return VPD_DECODE_FAIL;
+	*key += back_len + shared_len;
+	*key_len -= back_len + shared_len;
+
+	/* The record pointed to must be an earlier one with a full key. */
+	if (back == 0 || back > start)
+		return VPD_DECODE_FAIL;
+	anchor = start - back;
+	switch (input_buf[anchor]) {
+	case VPD_TYPE_STRING:
+	case VPD_TYPE_BINARY:
+	case VPD_TYPE_COMPRESSED:
+		break;
+	default:
+		return VPD_DECODE_FAIL;
+	}
+	anchor++;
+	if (vpd_decode_entry(start, input_buf, &anchor, key_prefix,
+			     &anchor_key_len) != VPD_DECODE_OK ||
+	    *key_prefix_len > anchor_key_len)
+		return VPD_DECODE_FAIL;
+
+	return VPD_DECODE_OK;
+}
+
+/*
+ * Decodes the type, key and value of one record. Returns VPD_DECODE_FAIL for
+ * unknown types.
+ */
+static int vpd_decode_one(
 		const u32 max_len, const u8 *input_buf, u32 *consumed,
-		vpd_decode_callback callback, void *callback_arg)
+		u8 *type, const u8 **key_prefix, u32 *key_prefix_len,
+		const u8 **key, u32 *key_len, const u8 **value,
+		u32 *value_len)
 {
-	int type;
-	u32 key_len;
-	u32 value_len;
-	const u8 *key;
-	const u8 *value;
+	const u32 start = *consumed;
 
 	/* type */
 	if (*consumed >= max_len)
 		return VPD_DECODE_FAIL;
 
-	type = input_buf[*consumed];
+	*type = input_buf[*consumed];
 
-	switch (type) {
+	switch (*type) {
 	case VPD_TYPE_INFO:
 	case VPD_TYPE_STRING:
+	case VPD_TYPE_BINARY:
+	case VPD_TYPE_COMPRESSED:
+	case VPD_TYPE_PREFIX_STRING:
 		(*consumed)++;
 
-		if (vpd_decode_entry(max_len, input_buf, consumed, &key,
-				     &key_len) != VPD_DECODE_OK)
+		if (vpd_decode_entry(max_len, input_buf, consumed, key,
+				     key_len) != VPD_DECODE_OK)
 			return VPD_DECODE_FAIL;
 
-		if (vpd_decode_entry(max_len, input_buf, consumed, &value,
-				     &value_len) != VPD_DECODE_OK)
+		if (vpd_decode_entry(max_len, input_buf, consumed, value,
+				     value_len) != VPD_DECODE_OK)
 			return VPD_DECODE_FAIL;
 
-		if (type == VPD_TYPE_STRING)
-			return callback(key, key_len, value, value_len,
-					callback_arg);
+		*key_prefix = *key;
+		*key_prefix_len = 0;
+		if (*type == VPD_TYPE_PREFIX_STRING &&
+		    vpd_decode_prefix_key(input_buf, start, key_prefix,
+					  key_prefix_len, key,
+					  key_len) != VPD_DECODE_OK)
+			return VPD_DECODE_FAIL;
 		break;
 
 	default:
@@ -92,3 +170,50 @@ int vpd_decode_string(
 
 	return VPD_DECODE_OK;
 }
+
+int vpd_decode_string(
+		const u32 max_len, const u8 *input_buf, u32 *consumed,
+		vpd_decode_callback callback, void *callback_arg)
+{
+	u8 type;
+	u32 key_prefix_len;
+	u32 key_len;
+	u32 value_len;
+	const u8 *key_prefix;
+	const u8 *key;
+	const u8 *value;
+
+	if (vpd_decode_one(max_len, input_buf, consumed, &type, &key_prefix,
+			   &key_prefix_len, &key, &key_len, &value,
+			   &value_len) != VPD_DECODE_OK)
+		return VPD_DECODE_FAIL;
+
+	if (type == VPD_TYPE_STRING || type == VPD_TYPE_BINARY)
+		return callback(key, key_len, value, value_len, callback_arg);
+
+	return VPD_DECODE_OK;
+}
+
+int vpd_decode_record(
+		const u32 max_len, const u8 *input_buf, u32 *consumed,
+		vpd_decode_record_callback callback, void *callback_arg)
+{
+	u8 type;
+	u32 key_prefix_len;
+	u32 key_len;
+	u32 value_len;
+	const u8 *key_prefix;
+	const u8 *key;
+	const u8 *value;
+
+	if (vpd_decode_one(max_len, input_buf, consumed, &type, &key_prefix,
+			   &key_prefix_len, &key, &key_len, &value,
+			   &value_len) != VPD_DECODE_OK)
+		return VPD_DECODE_FAIL;
+
+	if (type != VPD_TYPE_INFO)
+		return callback(type, key_prefix, key_prefix_len, key, key_len,
+				value, value_len, callback_arg);
+
+	return VPD_DECODE_OK;
+}
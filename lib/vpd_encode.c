@@ -11,6 +11,40 @@
 #include "lib_vpd.h"
 
 
+/* Bytes of an encoded length, by the number of significant bits in it. */
+static const uint8_t encoded_len_size[33] = {
+  1, 1, 1, 1, 1, 1, 1, 1,  /* 0 to 7 bits */
+  2, 2, 2, 2, 2, 2, 2,     /* 8 to 14 bits */
+  3, 3, 3, 3, 3, 3, 3,
+  4, 4, 4, 4, 4, 4, 4,
+  5, 5, 5, 5,
+};
+
+int encodeLenSize(const uint32_t len) {
+  return encoded_len_size[len ? 32 - __builtin_clz(len) : 0];
+}
+
+int encodeVpdStringSize(const int key_len, const int value_len) {
+  return 1 + encodeLenSize(key_len) + key_len + encodeLenSize(value_len) +
+         value_len;
+}
+
+/* Bytes of the key field of a VPD_TYPE_PREFIX_STRING record. */
+static int _prefixKeySize(const uint32_t back,
+                          const int shared_len,
+                          const int key_len) {
+  return encodeLenSize(back) + encodeLenSize(shared_len) + key_len -
+         shared_len;
+}
+
+int encodeVpdPrefixStringSize(const uint32_t back,
+                              const int shared_len,
+                              const int key_len,
+                              const int value_len) {
+  return encodeVpdStringSize(_prefixKeySize(back, shared_len, key_len),
+                             value_len);
+}
+
 /* Encodes the len into multiple bytes with the following format.
  *
  *    7   6 ............ 0
@@ -25,8 +59,33 @@ vpd_err_t encodeLen(
     uint8_t *encode_buf,
     const int32_t max_len,
     int32_t *encoded_len) {
+  int32_t more;
+
+  assert(encoded_len);
+
+  if (len < 0) return VPD_ERR_INVALID;
+  if (len >= 0x4000)
+    return encodeLenReference(len, encode_buf, max_len, encoded_len);
+
+  /* One or two bytes, written without branching on which. */
+  more = !!(len >> 7);
+  *encoded_len = 1 + more;
+  if (*encoded_len > max_len) return VPD_ERR_OVERFLOW;
+  encode_buf[0] = (len >> (7 * more)) | (more << 7);
+  encode_buf[more] = len & 0x7f;  /* the same byte again if more is 0 */
+
+  return VPD_OK;
+}
+
+/* The original bit-reversing encoder, kept as the reference that encodeLen()
+ * falls back to for lengths of three bytes or more. */
+vpd_err_t encodeLenReference(
+    const int32_t len,
+    uint8_t *encode_buf,
+    const int32_t max_len,
+    int32_t *encoded_len) {
   unsigned int shifting;
-  unsigned int reversed_7bits = 0;
+  uint64_t reversed_7bits = 0;
   int out_index = 0;
 
   assert(encoded_len);
@@ -69,28 +128,29 @@ vpd_err_t encodeVpdTerminator(
   return VPD_OK;
 }
 
-/* Encodes a string with padding support. */
-vpd_err_t encodeVpdString(
+/* Encodes a record of the given type with key_len bytes of key; see
+ * encodeVpdString(). */
+static vpd_err_t _encodeVpdRecord(
+    const uint8_t type,
     const uint8_t *key,
+    const int key_len,
     const uint8_t *value,
+    int value_len,
     const int pad_value_len,
     const int max_buffer_len,
     uint8_t *output_buf,
     int *generated_len) {
-  int key_len, value_len;
   int ret_len;
   int pad_len = 0;
   vpd_err_t retval;
 
   assert(generated_len);
 
-  key_len = strlen((char*)key);
-  value_len = strlen((char*)value);
   output_buf += *generated_len;  /* move cursor to end of string */
 
   /* encode type */
   if (*generated_len >= max_buffer_len) return VPD_ERR_OVERFLOW;
-  *(output_buf++) = VPD_TYPE_STRING;
+  *(output_buf++) = type;
   (*generated_len)++;
 
   /* encode key len */
@@ -134,3 +194,68 @@ vpd_err_t encodeVpdString(
 
   return VPD_OK;
 }
+
+vpd_err_t encodeVpdString(
+    const uint8_t *key,
+    const uint8_t *value,
+    const int pad_value_len,
+    const int max_buffer_len,
+    uint8_t *output_buf,
+    int *generated_len) {
+  return _encodeVpdRecord(VPD_TYPE_STRING, key, strlen((char*)key), value,
+                          strlen((char*)value), pad_value_len,
+                          max_buffer_len, output_buf, generated_len);
+}
+
+vpd_err_t encodeVpdPrefixString(
+    const uint32_t back,
+    const uint8_t *key,
+    const int shared_len,
+    const uint8_t *value,
+    const int pad_value_len,
+    const int max_buffer_len,
+    uint8_t *output_buf,
+    int *generated_len) {
+  int key_len = strlen((char*)key);
+  int field_len = _prefixKeySize(back, shared_len, key_len);
+  uint8_t *field;
+  int32_t back_len, shared_size;
+  vpd_err_t retval;
+
+  assert(shared_len <= key_len);
+  field = malloc(field_len);
+  assert(field);
+  encodeLen(back, field, field_len, &back_len);
+  encodeLen(shared_len, field + back_len, field_len - back_len, &shared_size);
+  memcpy(field + back_len + shared_size, key + shared_len,
+         key_len - shared_len);
+  retval = _encodeVpdRecord(VPD_TYPE_PREFIX_STRING, field, field_len, value,
+                            strlen((char*)value), pad_value_len,
+                            max_buffer_len, output_buf, generated_len);
+  free(field);
+  return retval;
+}
+
+vpd_err_t encodeVpdBinary(
+    const uint8_t *key,
+    const uint8_t *value,
+    const int value_len,
+    const int max_buffer_len,
+    uint8_t *output_buf,
+    int *generated_len) {
+  return _encodeVpdRecord(VPD_TYPE_BINARY, key, strlen((char*)key), value,
+                          value_len, VPD_AS_LONG_AS, max_buffer_len,
+                          output_buf, generated_len);
+}
+
+vpd_err_t encodeVpdCompressed(
+    const uint8_t *key,
+    const uint8_t *packed,
+    const int packed_len,
+    const int max_buffer_len,
+    uint8_t *output_buf,
+    int *generated_len) {
+  return _encodeVpdRecord(VPD_TYPE_COMPRESSED, key, strlen((char*)key),
+                          packed, packed_len, VPD_AS_LONG_AS, max_buffer_len,
+                          output_buf, generated_len);
+}
@@ -0,0 +1,221 @@
+/*
+ * Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ */
+#include <assert.h>
+#include <fnmatch.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lib/lib_vpd.h"
+
+
+/***********************************************************************
+ * Key filter helpers
+ ***********************************************************************/
+
+/* FNV-1a, good enough for short ASCII key names. */
+static uint32_t _hashKey(const uint8_t *key, uint32_t key_len) {
+  uint32_t hash = 2166136261u;
+  uint32_t i;
+
+  for (i = 0; i < key_len; ++i) {
+    hash ^= key[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+/* Returns true if the first len bytes of 'pattern' contain fnmatch() syntax. */
+static int _hasGlobChar(const char *pattern, size_t len) {
+  size_t i;
+
+  for (i = 0; i < len; ++i) {
+    if (strchr("*?[]\\", pattern[i]))
+      return 1;
+  }
+  return 0;
+}
+
+/*
+ * Looks up the slot in the open-addressing table for 'key'. Returns the index
+ * of either the matching slot or the first empty slot.
+ */
+static size_t _findSlot(const struct VpdKeyFilter *filter,
+                        const uint8_t *key,
+                        uint32_t key_len) {
+  size_t mask = filter->exact_cap - 1;
+  size_t slot = _hashKey(key, key_len) & mask;
+
+  while (filter->exact[slot]) {
+    const char *entry = filter->exact[slot];
+    if (strlen(entry) == key_len && !memcmp(entry, key, key_len))
+      break;
+    slot = (slot + 1) & mask;
+  }
+  return slot;
+}
+
+/* Doubles the hash table (keeping the load factor under 1/2). */
+static vpd_err_t _growExactTable(struct VpdKeyFilter *filter) {
+  size_t old_cap = filter->exact_cap;
+  char **old = filter->exact;
+  size_t i;
+
+  filter->exact_cap = old_cap ? old_cap * 2 : 16;
+  filter->exact = calloc(filter->exact_cap, sizeof(char *));
+  if (!filter->exact) {
+    filter->exact = old;
+    filter->exact_cap = old_cap;
+    return VPD_ERR_SYSTEM;
+  }
+
+  for (i = 0; i < old_cap; ++i) {
+    if (old[i]) {
+      size_t slot = _findSlot(filter, (const uint8_t *)old[i], strlen(old[i]));
+      filter->exact[slot] = old[i];
+    }
+  }
+  free(old);
+  return VPD_OK;
+}
+
+/* Appends a copy of 'pattern' to a growable string array. */
+static vpd_err_t _appendPattern(char ***array, int *count,
+                                const char *pattern, size_t len) {
+  char **grown = realloc(*array, sizeof(char *) * (*count + 1));
+  char *copy;
+
+  if (!grown)
+    return VPD_ERR_SYSTEM;
+  *array = grown;
+
+  copy = strndup(pattern, len);
+  if (!copy)
+    return VPD_ERR_SYSTEM;
+  (*array)[(*count)++] = copy;
+  return VPD_OK;
+}
+
+void initKeyFilter(struct VpdKeyFilter *filter) {
+  memset(filter, 0, sizeof(*filter));
+}
+
+vpd_err_t addKeyFilterPattern(struct VpdKeyFilter *filter,
+                              const char *pattern,
+                              size_t len) {
+  assert(filter);
+
+  if (!len)
+    return VPD_ERR_SYNTAX;
+
+  /* "prefix*" is by far the most common wildcard; avoid fnmatch() for it. */
+  if (pattern[len - 1] == '*' && !_hasGlobChar(pattern, len - 1))
+    return _appendPattern(&filter->prefixes, &filter->num_prefixes,
+                          pattern, len - 1);
+
+  if (_hasGlobChar(pattern, len))
+    return _appendPattern(&filter->globs, &filter->num_globs, pattern, len);
+
+  return addKeyFilterKey(filter, pattern, len);
+}
+
+vpd_err_t addKeyFilterKey(struct VpdKeyFilter *filter,
+                          const char *key,
+                          size_t len) {
+  size_t slot;
+
+  assert(filter);
+
+  if (!len)
+    return VPD_ERR_SYNTAX;
+
+  if ((filter->num_exact + 1) * 2 > filter->exact_cap) {
+    vpd_err_t retval = _growExactTable(filter);
+    if (VPD_OK != retval)
+      return retval;
+  }
+  slot = _findSlot(filter, (const uint8_t *)key, len);
+  if (filter->exact[slot])
+    return VPD_OK;  /* duplicated */
+  filter->exact[slot] = strndup(key, len);
+  if (!filter->exact[slot])
+    return VPD_ERR_SYSTEM;
+  filter->num_exact++;
+  return VPD_OK;
+}
+
+vpd_err_t addKeyFilterList(struct VpdKeyFilter *filter, const char *list) {
+  const char *start = list;
+
+  for (;;) {
+    size_t len = strcspn(start, ", \t\n");
+    if (len) {
+      vpd_err_t retval = addKeyFilterPattern(filter, start, len);
+      if (VPD_OK != retval)
+        return retval;
+    }
+    if (!start[len])
+      break;
+    start += len + 1;
+  }
+  return VPD_OK;
+}
+
+int isKeyFilterEmpty(const struct VpdKeyFilter *filter) {
+  return !filter->num_exact && !filter->num_prefixes && !filter->num_globs;
+}
+
+int matchKeyFilter(const struct VpdKeyFilter *filter,
+                   const uint8_t *key,
+                   uint32_t key_len) {
+  int i;
+
+  if (filter->num_exact &&
+      filter->exact[_findSlot(filter, key, key_len)])
+    return 1;
+
+  for (i = 0; i < filter->num_prefixes; ++i) {
+    size_t len = strlen(filter->prefixes[i]);
+    if (len <= key_len && !memcmp(filter->prefixes[i], key, len))
+      return 1;
+  }
+
+  if (filter->num_globs) {
+    /* fnmatch() needs a NULL-terminated key; long ones go to the heap. */
+    char short_name[256];
+    char *name = short_name;
+    int matched = 0;
+
+    if (key_len >= sizeof(short_name)) {
+      name = malloc(key_len + 1);
+      if (!name)
+        return 0;
+    }
+    memcpy(name, key, key_len);
+    name[key_len] = '\0';
+    for (i = 0; i < filter->num_globs && !matched; ++i)
+      matched = !fnmatch(filter->globs[i], name, 0);
+    if (name != short_name)
+      free(name);
+    return matched;
+  }
+  return 0;
+}
+
+void destroyKeyFilter(struct VpdKeyFilter *filter) {
+  size_t i;
+  int j;
+
+  for (i = 0; i < filter->exact_cap; ++i)
+    free(filter->exact[i]);
+  free(filter->exact);
+  for (j = 0; j < filter->num_prefixes; ++j)
+    free(filter->prefixes[j]);
+  free(filter->prefixes);
+  for (j = 0; j < filter->num_globs; ++j)
+    free(filter->globs[j]);
+  free(filter->globs);
+  initKeyFilter(filter);
+}
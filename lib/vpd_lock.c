@@ -0,0 +1,102 @@
+/*
+ * Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/file.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "lib/vpd_lock.h"
+
+static uint64_t _nowMs(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* Opens dir/name and flock()s it with operation until deadline_ms.
+ * Returns the fd, or -1 with errno set (ETIMEDOUT on timeout). */
+static int _lockFile(const char *dir,
+                     const char *name,
+                     int operation,
+                     uint64_t deadline_ms) {
+  char path[PATH_MAX];
+  useconds_t delay_us = 1000;
+  int fd;
+
+  if (snprintf(path, sizeof(path), "%s/%s", dir, name) >= (int)sizeof(path)) {
+    errno = ENAMETOOLONG;
+    return -1;
+  }
+  fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  if (fd < 0)
+    return -1;
+
+  /* flock() has no timeout, so poll with a growing delay. */
+  while (flock(fd, operation | LOCK_NB) < 0) {
+    if (errno != EWOULDBLOCK && errno != EINTR) {
+      int saved_errno = errno;
+      close(fd);
+      errno = saved_errno;
+      return -1;
+    }
+    if (_nowMs() >= deadline_ms) {
+      close(fd);
+      errno = ETIMEDOUT;
+      return -1;
+    }
+    usleep(delay_us);
+    if (delay_us < 50000)
+      delay_us *= 2;
+  }
+  return fd;
+}
+
+vpd_err_t vpdLock(struct VpdLock *lock, int exclusive, int timeout_sec) {
+  const char *dir = getenv(VPD_LOCK_DIR_ENV);
+  uint64_t deadline_ms;
+  int gate_fd;
+
+  lock->fd = -1;
+  if (getenv(VPD_LOCK_HELD_ENV))
+    return VPD_OK;
+
+  if (!dir || !*dir)
+    dir = VPD_LOCK_DIR;
+  if (timeout_sec < 0) {
+    const char *timeout = getenv(VPD_LOCK_TIMEOUT_ENV);
+    timeout_sec = timeout ? atoi(timeout) : VPD_LOCK_TIMEOUT_SEC;
+  }
+  deadline_ms = _nowMs() + (uint64_t)timeout_sec * 1000;
+
+  gate_fd = _lockFile(dir, VPD_LOCK_GATE_FILE, LOCK_EX, deadline_ms);
+  if (gate_fd >= 0) {
+    lock->fd = _lockFile(dir, VPD_LOCK_FILE, exclusive ? LOCK_EX : LOCK_SH,
+                         deadline_ms);
+    close(gate_fd);
+  }
+  if (lock->fd < 0) {
+    if (errno == ETIMEDOUT) {
+      fprintf(stderr, "[ERROR] Timed out waiting for the VPD lock.\n");
+      return VPD_ERR_BUSY;
+    }
+    fprintf(stderr, "[ERROR] Cannot take the VPD lock in %s.\n", dir);
+    return VPD_ERR_SYSTEM;
+  }
+  return VPD_OK;
+}
+
+void vpdUnlock(struct VpdLock *lock) {
+  if (lock->fd >= 0) {
+    close(lock->fd);
+    lock->fd = -1;
+  }
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "lib/vpdd_client.h"
+
+const char *vpddSocketPath(void) {
+  const char *path = getenv(VPDD_SOCKET_ENV);
+
+  return (path && *path) ? path : VPDD_SOCKET_PATH;
+}
+
+int vpddConnect(const char *socket_path) {
+  struct sockaddr_un addr;
+  int fd;
+
+  if (strlen(socket_path) >= sizeof(addr.sun_path))
+    return -1;
+
+  fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0)
+    return -1;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, socket_path);
+  if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+static int _writeAll(int fd, const void *data, size_t len) {
+  const uint8_t *p = data;
+
+  while (len) {
+    ssize_t written = send(fd, p, len, MSG_NOSIGNAL);
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      return -1;
+    }
+    p += written;
+    len -= written;
+  }
+  return 0;
+}
+
+static int _readAll(int fd, void *data, size_t len) {
+  uint8_t *p = data;
+
+  while (len) {
+    ssize_t got = read(fd, p, len);
+    if (got < 0 && errno == EINTR)
+      continue;
+    if (got <= 0)
+      return -1;
+    p += got;
+    len -= got;
+  }
+  return 0;
+}
+
+vpd_err_t vpddSendRequest(int fd, const char *request) {
+  if (_writeAll(fd, request, strlen(request)) || _writeAll(fd, "\n", 1))
+    return VPD_ERR_SYSTEM;
+  return VPD_OK;
+}
+
+vpd_err_t vpddReadResponse(int fd, uint8_t **response, uint32_t *response_len) {
+  char header[32];
+  size_t header_len = 0;
+  int status;
+  unsigned int len;
+
+  *response = NULL;
+  *response_len = 0;
+
+  /* Header line: "<status> <length>\n" */
+  for (;;) {
+    if (header_len + 1 >= sizeof(header) ||
+        _readAll(fd, &header[header_len], 1))
+      return VPD_ERR_SYSTEM;
+    if (header[header_len] == '\n')
+      break;
+    header_len++;
+  }
+  header[header_len] = '\0';
+  if (sscanf(header, "%d %u", &status, &len) != 2)
+    return VPD_ERR_SYSTEM;
+
+  *response = malloc(len + 1);
+  if (!*response)
+    return VPD_ERR_SYSTEM;
+  if (_readAll(fd, *response, len)) {
+    free(*response);
+    *response = NULL;
+    return VPD_ERR_SYSTEM;
+  }
+  (*response)[len] = '\0';
+  *response_len = len;
+
+  return (vpd_err_t)status;
+}
+
+vpd_err_t vpddRequest(int fd,
+                      const char *request,
+                      uint8_t **response,
+                      uint32_t *response_len) {
+  *response = NULL;
+  *response_len = 0;
+
+  if (VPD_OK != vpddSendRequest(fd, request))
+    return VPD_ERR_SYSTEM;
+  return vpddReadResponse(fd, response, response_len);
+}
@@ -0,0 +1,165 @@
+/*
+ * Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "libvpd/libvpd.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+extern "C" {
+#include "lib/vpd_lock.h"
+};
+
+#include "libvpd/vpd_region.h"
+
+namespace libvpd {
+
+namespace {
+
+const uint8_t* toBytes(const std::string& s) {
+  return reinterpret_cast<const uint8_t*>(s.c_str());
+}
+
+}  // namespace
+
+std::unique_ptr<Vpd> Vpd::OpenFlash(bool writable) {
+  std::unique_ptr<Vpd> vpd(new Vpd("", writable));
+
+  if (writable) {
+    struct VpdLock lock;
+    if (VPD_OK != vpdLock(&lock, true, -1))
+      return nullptr;
+    vpd->lock_fd_ = lock.fd;
+  }
+  return vpd;
+}
+
+std::unique_ptr<Vpd> Vpd::OpenImage(std::string path) {
+  return std::unique_ptr<Vpd>(new Vpd(std::move(path), true));
+}
+
+Vpd::Vpd(std::string path, bool writable)
+    : path_(std::move(path)), writable_(writable) {}
+
+Vpd::~Vpd() {
+  struct VpdLock lock = {lock_fd_};
+  vpdUnlock(&lock);
+}
+
+vpd_err_t Vpd::Load(Partition partition) {
+  std::unique_ptr<VpdRegion>& region = regions_[static_cast<int>(partition)];
+  if (region)
+    return VPD_OK;
+
+  auto loading = std::make_unique<VpdRegion>();
+  loading->name = partition == Partition::kRo ? "RO_VPD" : "RW_VPD";
+
+  /* A writable flash holds the lock already. */
+  struct VpdLock lock = {-1};
+  if (path_.empty() && !writable_) {
+    vpd_err_t retval = vpdLock(&lock, false, -1);
+    if (VPD_OK != retval)
+      return retval;
+  }
+  vpd_err_t retval = openRegion(loading.get(),
+                                path_.empty() ? NULL : path_.c_str(), false,
+                                false);
+  vpdUnlock(&lock);
+  if (VPD_OK != retval)
+    return retval;
+
+  region = std::move(loading);
+  return VPD_OK;
+}
+
+VpdRegion* Vpd::Region(Partition partition) {
+  if (VPD_OK != Load(partition))
+    return NULL;
+  return regions_[static_cast<int>(partition)].get();
+}
+
+std::optional<std::string> Vpd::Get(Partition partition,
+                                    std::string_view key) {
+  VpdRegion* region = Region(partition);
+  if (!region)
+    return std::nullopt;
+
+  const std::string key_str(key);
+  const struct StringPair* pair = findString(&region->file, toBytes(key_str),
+                                             NULL);
+  const uint8_t* value = pair ? getPairValue(pair) : NULL;
+  if (!value)
+    return std::nullopt;
+  return std::string(reinterpret_cast<const char*>(value), pair->value_len);
+}
+
+vpd_err_t Vpd::List(Partition partition,
+                    std::vector<std::pair<std::string, std::string>>* pairs) {
+  vpd_err_t retval = Load(partition);
+  if (VPD_OK != retval)
+    return retval;
+
+  pairs->clear();
+  for (const struct StringPair* pair = Region(partition)->file.first; pair;
+       pair = pair->next) {
+    const uint8_t* value = getPairValue(pair);
+    if (!value)
+      return VPD_ERR_DECODE;
+    pairs->emplace_back(
+        reinterpret_cast<const char*>(pair->key),
+        std::string(reinterpret_cast<const char*>(value), pair->value_len));
+  }
+  return VPD_OK;
+}
+
+vpd_err_t Vpd::Set(Partition partition, std::string key, std::string value) {
+  if (key.empty() || key.find('\0') != std::string::npos ||
+      value.find('\0') != std::string::npos)
+    return VPD_ERR_PARAM;
+  if (!writable_) {
+    fprintf(stderr, "[ERROR] The flash was opened read-only.\n");
+    return VPD_ERR_PARAM;
+  }
+
+  vpd_err_t retval = Load(partition);
+  if (VPD_OK != retval)
+    return retval;
+
+  VpdRegion* region = Region(partition);
+  setString(&region->file, toBytes(key), toBytes(value), VPD_AS_LONG_AS);
+  region->modified++;
+  return VPD_OK;
+}
+
+vpd_err_t Vpd::Delete(Partition partition, std::string_view key) {
+  if (!writable_) {
+    fprintf(stderr, "[ERROR] The flash was opened read-only.\n");
+    return VPD_ERR_PARAM;
+  }
+
+  vpd_err_t retval = Load(partition);
+  if (VPD_OK != retval)
+    return retval;
+
+  VpdRegion* region = Region(partition);
+  retval = deleteKey(&region->file, toBytes(std::string(key)));
+  if (VPD_OK == retval)
+    region->modified++;
+  return retval;
+}
+
+vpd_err_t Vpd::Commit() {
+  for (auto& region : regions_) {
+    if (!region || !region->modified)
+      continue;
+    vpd_err_t retval = commitRegion(region.get());
+    if (VPD_OK != retval && VPD_UNCHANGED != retval)
+      return retval;
+  }
+  return VPD_OK;
+}
+
+}  // namespace libvpd
@@ -0,0 +1,145 @@
+/*
+ * Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Exercises the libvpd API against the image file given as argument. Driven
+ * by tests/test_libvpd.sh, which also checks the result with vpd.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+extern "C" {
+#include "lib/lib_smbios.h"
+};
+
+#include "libvpd/libvpd.h"
+#include "libvpd/smbios_tables.h"
+#include "libvpd/vpd_encoding.h"
+
+using libvpd::Partition;
+using libvpd::Vpd;
+
+namespace {
+
+const char* image;
+
+/* Checks that the compile-time record equals what encodeVpdString() makes. */
+template <size_t N>
+void expectEncoded(const libvpd::Bytes<N>& record,
+                   const char* key,
+                   const char* value,
+                   int pad) {
+  uint8_t buf[512];
+  int generated = 0;
+  assert(VPD_OK == encodeVpdString(reinterpret_cast<const uint8_t*>(key),
+                                   reinterpret_cast<const uint8_t*>(value),
+                                   pad, sizeof(buf), buf, &generated));
+  assert(N == generated);
+  assert(!memcmp(record.data, buf, N));
+}
+
+void testConstexprEncoders() {
+  using libvpd::encoding::encodeString;
+
+  /* A value of 0x90 bytes has a two-byte length. */
+  constexpr char kLong[] =
+      "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef"
+      "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef"
+      "0123456789abcdef";
+  static_assert(sizeof(kLong) - 1 == 0x90);
+
+  expectEncoded(encodeString("serial_number", "SN1234"), "serial_number",
+                "SN1234", VPD_AS_LONG_AS);
+  expectEncoded(encodeString("k", ""), "k", "", VPD_AS_LONG_AS);
+  expectEncoded(encodeString("long", kLong), "long", kLong, VPD_AS_LONG_AS);
+  expectEncoded(encodeString<0x100>("pad", "x"), "pad", "x", 0x100);
+  expectEncoded(encodeString<3>("cut", "value"), "cut", "value", 3);
+
+  printf("[PASS] %s()\n", __FUNCTION__);
+}
+
+/* Checks that the compile-time tables buildEpsAndTables() writes are what
+ * the table builder makes, with the blob addresses and sizes left 0. */
+void testSmbiosTables() {
+  using libvpd::smbios::kStructureTable;
+  struct vpd_table_builder builder;
+
+  assert(0 == vpd_table_builder_init(&builder, 0));
+  assert(0 == vpd_table_builder_add_type241(
+                  &builder, GOOGLE_SPD_UUID, 0, 0, GOOGLE_SPD_VENDOR,
+                  GOOGLE_SPD_DESCRIPTION, GOOGLE_SPD_VARIANT));
+  assert(0 == vpd_table_builder_add_type241(
+                  &builder, GOOGLE_VPD_2_0_UUID, 0, 0, GOOGLE_VPD_2_0_VENDOR,
+                  GOOGLE_VPD_2_0_DESCRIPTION, GOOGLE_VPD_2_0_VARIANT));
+  assert(0 == vpd_table_builder_add_type127(&builder));
+  assert(kStructureTable.size() == builder.len);
+  assert(!memcmp(kStructureTable.data, builder.buf, builder.len));
+  vpd_table_builder_free(&builder);
+
+  printf("[PASS] %s()\n", __FUNCTION__);
+}
+
+void testSetAndCommit() {
+  auto vpd = Vpd::OpenImage(image);
+  assert(vpd);
+  assert(VPD_OK == vpd->Load(Partition::kRo));
+
+  std::string value = "libvpd_value";
+  assert(VPD_OK == vpd->Set(Partition::kRo, "libvpd_ro", std::move(value)));
+  assert(VPD_OK == vpd->Set(Partition::kRo, "libvpd_gone", "x"));
+  assert(VPD_OK == vpd->Set(Partition::kRw, "libvpd_rw", "rw_value"));
+  assert(VPD_ERR_PARAM == vpd->Set(Partition::kRw, "", "empty"));
+  assert("libvpd_value" == vpd->Get(Partition::kRo, "libvpd_ro"));
+  assert(!vpd->Get(Partition::kRw, "libvpd_ro"));
+  assert(VPD_OK == vpd->Commit());
+
+  printf("[PASS] %s()\n", __FUNCTION__);
+}
+
+void testReopenAndDelete() {
+  auto vpd = Vpd::OpenImage(image);
+  assert(vpd);
+  assert("libvpd_value" == vpd->Get(Partition::kRo, "libvpd_ro"));
+  assert("rw_value" == vpd->Get(Partition::kRw, "libvpd_rw"));
+
+  assert(VPD_OK == vpd->Delete(Partition::kRo, "libvpd_gone"));
+  assert(VPD_FAIL == vpd->Delete(Partition::kRo, "libvpd_gone"));
+  assert(!vpd->Get(Partition::kRo, "libvpd_gone"));
+
+  std::vector<std::pair<std::string, std::string>> pairs;
+  assert(VPD_OK == vpd->List(Partition::kRw, &pairs));
+  assert(1 == pairs.size());
+  assert("libvpd_rw" == pairs[0].first);
+  assert(VPD_OK == vpd->Commit());
+  /* Nothing left to write. */
+  assert(VPD_OK == vpd->Commit());
+
+  printf("[PASS] %s()\n", __FUNCTION__);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc != 2) {
+    fprintf(stderr, "Usage: %s <image>\n", argv[0]);
+    return 1;
+  }
+  image = argv[1];
+
+#ifndef NDEBUG
+  testConstexprEncoders();
+  testSmbiosTables();
+  testSetAndCommit();
+  testReopenAndDelete();
+
+  printf("SUCCESS!\n");
+#endif
+  return 0;
+}
@@ -0,0 +1,1133 @@
+/*
+ * Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "libvpd/vpd_region.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <assert.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <fmap.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <uuid/uuid.h>
+
+extern "C" {
+#include "lib/checksum.h"
+#include "lib/flashrom.h"
+#include "lib/lib_smbios.h"
+#include "lib/vpd_cache.h"
+#include "lib/vpd_tables.h"
+};
+
+#include "libvpd/smbios_tables.h"
+#include "libvpd/vpd_encoding.h"
+
+namespace libvpd {
+
+namespace {
+
+/* Default locations. Each can be overridden by the environment variable of
+ * the same name, mostly for testing. */
+#define VPD_SYSFS_DIR "/sys/firmware/vpd"
+#define VPD_CACHE_FILE \
+  "/mnt/stateful_partition/unencrypted/cache/vpd/full-v2.txt"
+#define VPD_RUN_DIR "/run/vpd"
+#define VPD_BINARY_CACHE_FILE \
+  "/mnt/stateful_partition/unencrypted/cache/vpd/full-v2.bin"
+
+/* The line in VPD_CACHE_FILE separating RO_VPD from RW_VPD. */
+#define CACHE_RO_RW_DELIMITER "\"___ro_rw_delimiter___\"=\"___RW_VPD_below___\""
+
+/* Creates a temporary file owned by region and returns its name, or NULL for
+ * any failure.
+ */
+const char* makeTempFile(struct VpdRegion* region) {
+  char tmp_file[] = "/tmp/vpd.flashrom.XXXXXX";
+
+  int fd = mkstemp(tmp_file);
+  if (fd < 0) {
+    fprintf(stderr, "mkstemp(%s) failed\n", tmp_file);
+    return NULL;
+  }
+
+  close(fd);
+  region->temp_files.push_back(tmp_file);
+  return region->temp_files.back().c_str();
+}
+
+/*  Given the offset of blob block (related to the first byte of EPS) and
+ *  the size of blob, the is function generates an SMBIOS ESP.
+ */
+vpd_err_t buildEpsAndTables(const struct VpdRegion* region,
+                            const int size_blob,
+                            const int max_buf_len,
+                            unsigned char* buf,
+                            int* generated) {
+  using smbios::kEps3AndTables;
+  using smbios::kEpsAndTables;
+
+  assert(buf);
+  assert(generated);
+  assert(region->eps_base != UNKNOWN_EPS_BASE);
+
+  const bool eps3 = CONFIG_EPS3_VPD_MAJOR_VERSION == region->eps_major_ver;
+  const uint8_t* tables = eps3 ? kEps3AndTables.data : kEpsAndTables.data;
+  const size_t tables_len =
+      eps3 ? kEps3AndTables.size() : kEpsAndTables.size();
+  const size_t eps_len =
+      eps3 ? sizeof(struct vpd_entry3) : sizeof(struct vpd_entry);
+
+  if (*generated < 0 || max_buf_len < *generated ||
+      tables_len > static_cast<size_t>(max_buf_len - *generated))
+    return VPD_FAIL;
+  buf += *generated;
+  memcpy(buf, tables, tables_len);
+
+  /* type 241 - SPD data */
+  struct vpd_table_binary_blob_pointer* data =
+      reinterpret_cast<struct vpd_table_binary_blob_pointer*>(
+          buf + eps_len + smbios::kSpdTableStart + sizeof(struct vpd_header));
+  data->offset = region->eps_base + GOOGLE_SPD_OFFSET;
+  data->size = region->spd_len;
+
+  /*
+   * TODO(hungte) Once most systems have been updated to support VPD_INFO
+   * record, we can remove the +sizeof(google_vpd_info) hack.
+   */
+
+  /* type 241 - VPD 2.0 */
+  data = reinterpret_cast<struct vpd_table_binary_blob_pointer*>(
+      buf + eps_len + smbios::kVpd20TableStart + sizeof(struct vpd_header));
+  data->offset = region->eps_base + GOOGLE_VPD_2_0_OFFSET +
+                 sizeof(struct google_vpd_info);
+  data->size = size_blob;
+
+  if (eps3) {
+    struct vpd_entry3* eps = reinterpret_cast<struct vpd_entry3*>(buf);
+    eps->table_address = region->eps_base + sizeof(*eps);
+    eps->entry_cksum = zero8_csum(buf, eps->entry_length);
+  } else {
+    struct vpd_entry* eps = reinterpret_cast<struct vpd_entry*>(buf);
+    eps->table_address = region->eps_base + sizeof(*eps);
+    /* calculate IEPS checksum first, then the EPS checksum */
+    eps->inter_anchor_cksum = zero8_csum(&eps->inter_anchor_string[0], 0xf);
+    eps->entry_cksum = zero8_csum(buf, eps->entry_length);
+  }
+
+  *generated += tables_len;
+  return VPD_OK;
+}
+
+/* Checks that the EPS (and for 2.x, its intermediate part) sums to 0, as
+ * written by buildEpsAndTables(), so that a corrupted partition is caught
+ * before it is decoded. vpd_read_eps() has checked entry_length against the
+ * partition.
+ */
+vpd_err_t verifyEps(const struct VpdRegion* region,
+                    const uint8_t* eps,
+                    const struct vpd_eps_info& info) {
+  if (CHECKSUM_OFF == region->checksum_mode)
+    return VPD_OK;
+
+  bool valid = !sum8(eps, info.entry_length);
+  if (CONFIG_EPS_VPD_MAJOR_VERSION == info.major_ver) {
+    const struct vpd_entry* eps2 = reinterpret_cast<const struct vpd_entry*>(eps);
+    valid = valid && !sum8(eps2->inter_anchor_string, 0xf);
+  }
+  if (valid)
+    return VPD_OK;
+
+  const bool strict = CHECKSUM_STRICT == region->checksum_mode;
+  fprintf(stderr, "[%s] %s: SMBIOS %d.x EPS checksum mismatch.\n",
+          strict ? "ERROR" : "WARN", region->name.c_str(), info.major_ver);
+  return strict ? VPD_ERR_INVALID : VPD_OK;
+}
+
+/* There are two possible file content appearng here:
+ *   1. a full and complete BIOS file
+ *   2. a full but only VPD partition area is valid. (no fmap)
+ *   3. a full BIOS, but VPD partition is blank.
+ *
+ * The first case is easy. Just lookup the fmap and find out the VPD partition.
+ * The second is harder. We try to search the SMBIOS signature (since others
+ * are blank). For the third, we just return and leave caller to read full
+ * content, including fmap info.
+ *
+ * If found, vpd_offset and vpd_size are updated.
+ */
+vpd_err_t findVpdPartition(const std::vector<uint8_t>& read_buf,
+                           const std::string& region_name,
+                           uint32_t* vpd_offset,
+                           uint32_t* vpd_size,
+                           bool* found_vpd) {
+  assert(vpd_offset);
+  assert(vpd_size);
+
+  /* scan the file and find out the VPD partition. */
+  const off_t sig_offset = fmap_find(read_buf.data(), read_buf.size());
+  if (sig_offset < 0) {
+    return VPD_ERR_NOT_FOUND;
+  }
+
+  const struct fmap* fmap;
+  if (sig_offset + sizeof(*fmap) > read_buf.size()) {
+    fprintf(stderr, "[ERROR] Bad FMAP at: %jd\n", (intmax_t)sig_offset);
+    return VPD_FAIL;
+  }
+  /* FMAP signature is found, try to search the partition name in table. */
+  fmap = (const struct fmap*)(read_buf.data() + sig_offset);
+
+  const struct fmap_area* area = fmap_find_area(fmap, region_name.c_str());
+  if (!area) {
+    fprintf(stderr, "[ERROR] The VPD partition [%s] is not found.\n",
+            region_name.c_str());
+    return VPD_ERR_NOT_FOUND;
+  }
+  *vpd_offset = area->offset;
+  *vpd_size = area->size;
+  /* Mark found here then saveFile() knows where to write back (vpd_offset,
+   * vpd_size). */
+  *found_vpd = true;
+  return VPD_OK;
+}
+
+vpd_err_t getVpdPartitionFromFullBios(struct VpdRegion* region,
+                                      uint32_t* offset,
+                                      uint32_t* size,
+                                      bool* found_vpd) {
+  const char* filename = makeTempFile(region);
+  if (!filename) {
+    return VPD_ERR_SYSTEM;
+  }
+
+  if (FLASHROM_OK != flashromFullRead(filename)) {
+    fprintf(stderr, "[WARN] Cannot read full BIOS.\n");
+    return VPD_ERR_ROM_READ;
+  }
+  auto buf = readFileToBytes(filename);
+  assert(buf);
+  if (findVpdPartition(*buf, region->name, offset, size, found_vpd)) {
+    fprintf(stderr, "[WARN] Cannot get eps_base from full BIOS.\n");
+    return VPD_ERR_INVALID;
+  }
+  return VPD_OK;
+}
+
+/* Below 2 functions are the helper functions for extract data from VPD 1.x
+ * binary-encoded structure.
+ * Note that the returning pointer is a static buffer. Thus the later call will
+ * destroy the former call's result.
+ */
+uint8_t* extractString(const uint8_t* value, const int max_len) {
+  static uint8_t buf[128];
+
+  /* not longer than the buffer size */
+  const int copy_len = (max_len > sizeof(buf) - 1) ? sizeof(buf) - 1 : max_len;
+  memcpy(buf, value, copy_len);
+  buf[copy_len] = '\0';
+
+  return buf;
+}
+
+uint8_t* extractHex(const uint8_t* value, const int len) {
+  char tmp[4]; /* for a hex string */
+  static uint8_t buf[128];
+  int in, out; /* in points to value[], while out points to buf[]. */
+
+  for (in = 0, out = 0;; ++in) {
+    if (out + 3 > sizeof(buf) - 1) {
+      goto end_of_func; /* no more buffer */
+    }
+    if (in >= len) { /* no more input */
+      if (out)
+        --out; /* remove the tailing colon */
+      goto end_of_func;
+    }
+    snprintf(tmp, sizeof(tmp), "%02x:", value[in]);
+    memcpy(&buf[out], tmp, strnlen(tmp, sizeof(tmp)));
+    out += strlen(tmp);
+  }
+
+end_of_func:
+  buf[out] = '\0';
+
+  return buf;
+}
+
+vpd_err_t loadRawFile(const char* filename, struct VpdRegion* region) {
+  struct PairContainer* container = &region->file;
+  uint32_t index;
+
+  auto vpd_buf = readFileToBytes(filename);
+  if (!vpd_buf) {
+    fprintf(stderr, "[ERROR] Cannot LoadRawFile('%s').\n", filename);
+    return VPD_ERR_SYSTEM;
+  }
+
+  for (index = 0; index < vpd_buf->size() &&
+                  (*vpd_buf)[index] != VPD_TYPE_TERMINATOR &&
+                  (*vpd_buf)[index] != VPD_TYPE_IMPLICIT_TERMINATOR;) {
+    vpd_err_t retval = decodeToContainerFiltered(
+        container, region->decode_filter, vpd_buf->size(), vpd_buf->data(), &index);
+    if (VPD_OK != retval) {
+      fprintf(stderr, "decodeToContainer() error.\n");
+      return retval;
+    }
+  }
+  region->file_flag |= HAS_VPD_2_0;
+
+  return VPD_OK;
+}
+
+vpd_err_t loadFile(struct VpdRegion* region,
+                   const char* filename,
+                   bool overwrite_it) {
+  struct PairContainer* container = &region->file;
+  struct vpd_eps_info eps;
+  uint32_t related_eps_base;
+  struct vpd_table_index tables;
+  uint32_t index;
+  vpd_err_t retval = VPD_OK;
+
+  auto read_buf = readFileToBytes(filename);
+  if (!read_buf) {
+    fprintf(stderr, "[WARN] Cannot LoadFile('%s'), that's fine.\n", filename);
+    return VPD_OK;
+  }
+
+  if (0 == findVpdPartition(*read_buf, region->name, &region->vpd_offset,
+                            &region->vpd_size, &region->found_vpd)) {
+    region->eps_base = region->vpd_offset;
+  } else {
+    /* We cannot parse out the VPD partition address from given file.
+     * Then, try to read the whole BIOS chip. */
+    uint32_t offset, size;
+    retval = getVpdPartitionFromFullBios(region, &offset, &size,
+                                         &region->found_vpd);
+    if (VPD_OK == retval) {
+      region->eps_base = offset;
+      region->vpd_size = size;
+    } else {
+      if (overwrite_it) {
+        return VPD_OK;
+      } else {
+        fprintf(stderr, "[ERROR] getVpdPartitionFromFullBios() failed.");
+        return retval;
+      }
+    }
+  }
+
+  /* Update the following variables:
+   *   eps_base: integer, the VPD EPS address in ROM.
+   *   vpd_offset: integer, the VPD partition offset in file (read_buf[]).
+   *   vpd_buf: uint8_t*, points to the VPD partition.
+   *   eps: vpd_eps_info, what the EPS of either kind says.
+   *   eps_offset: integer, the offset of EPS related to vpd_buf[].
+   */
+  const uint8_t* vpd_buf = read_buf->data() + region->vpd_offset;
+  /* Never look past the file, whatever fmap says. */
+  const uint32_t vpd_size =
+      region->vpd_offset < read_buf->size()
+          ? std::min<size_t>(region->vpd_size,
+                             read_buf->size() - region->vpd_offset)
+          : 0;
+  /* eps and eps_offset will be set slightly later. */
+
+  if (region->eps_base == UNKNOWN_EPS_BASE) {
+    fprintf(stderr,
+            "[ERROR] Cannot determine eps_base. Cannot go on.\n"
+            "        Ensure you have a valid FMAP.\n");
+    return VPD_ERR_INVALID;
+  }
+
+  if (vpd_size)
+    region->loaded.assign(vpd_buf, vpd_buf + vpd_size);
+
+  /* In overwrite mode, we don't care the content inside. Stop parsing. */
+  if (overwrite_it) {
+    return VPD_OK;
+  }
+
+  if (vpd_size < sizeof(struct vpd_entry)) {
+    fprintf(stderr, "[ERROR] vpd_size:%d is too small to be compared.\n",
+            vpd_size);
+    return VPD_ERR_INVALID;
+  }
+  /* try to search the EPS if it is not aligned to the begin of partition. */
+  const long eps_offset = vpd_find_eps(vpd_buf, vpd_size);
+  /* jump if the VPD partition is not recognized. */
+  if (eps_offset < 0) {
+    /* But OKAY if the VPD partition starts with FF, which might be un-used. */
+    if (!memcmp("\xff\xff\xff\xff", vpd_buf, sizeof(VPD_ENTRY_MAGIC) - 1)) {
+      fprintf(stderr, "[WARN] VPD partition not formatted. It's fine.\n");
+      return VPD_OK;
+    } else {
+      fprintf(stderr, "SMBIOS signature is not matched.\n");
+      fprintf(stderr, "You may use -O to overwrite the data.\n");
+      return VPD_ERR_INVALID;
+    }
+  }
+  region->eps_offset = eps_offset;
+  if (vpd_read_eps(vpd_buf, vpd_size, eps_offset, &eps)) {
+    fprintf(stderr, "[ERROR] The EPS length %d is invalid.\n",
+            eps.entry_length);
+    return VPD_ERR_INVALID;
+  }
+  /* Write back the same kind of EPS. */
+  region->eps_major_ver = eps.major_ver;
+
+  /* adjust the eps_base for data->offset field below. */
+  related_eps_base = eps.eps_address;
+
+  retval = verifyEps(region, vpd_buf + eps_offset, eps);
+  if (VPD_OK != retval)
+    return retval;
+
+  /* EPS is done above. Index the structure tables at the tail of EPS. */
+  if (vpd_index_table(vpd_buf + eps.table_offset,
+                      vpd_size - eps.table_offset, &tables)) {
+    fprintf(stderr,
+            "[ERROR] The SMBIOS structure table is corrupted.\n"
+            "        Use -O option to re-format.\n");
+    return VPD_ERR_INVALID;
+  }
+
+  /* Iterate all tables */
+  for (int i = 0; i < tables.count; ++i) {
+    const struct vpd_structure* structure = &tables.structures[i];
+    if (structure->type == VPD_TYPE_END)
+      break;
+
+    /* Only Binary Blob Pointer (241) carries VPD; skip the others. */
+    const struct vpd_table_binary_blob_pointer* data =
+        vpd_structure_blob(&tables, structure);
+    if (!data) {
+      fprintf(stderr, "[WARN] Skipping SMBIOS structure type %d.\n",
+              structure->type);
+      continue;
+    }
+
+    /* point to the table 241 data part */
+    index = data->offset - related_eps_base;
+    if (index >= vpd_size) {
+      fprintf(stderr,
+              "[ERROR] the table offset looks suspicious. "
+              "index=0x%x, data->offset=0x%x, related_eps_base=0x%x\n",
+              index, data->offset, related_eps_base);
+      return VPD_ERR_INVALID;
+    }
+
+    /*
+     * The main switch case
+     */
+    if (i == tables.blobs[VPD_BLOB_SPD]) {
+      /* SPD */
+      const uint32_t vpd_offset = region->vpd_offset;
+      const uint32_t spd_offset = index;
+      const int32_t spd_len = data->size;
+      region->spd_offset = spd_offset;
+      region->spd_len = spd_len;
+      if (spd_len < 0 ||
+          (uint64_t)vpd_offset + spd_offset + spd_len >= read_buf->size()) {
+        fprintf(stderr,
+                "[ERROR] SPD offset in BBP is not correct.\n"
+                "        vpd=0x%x spd=0x%x len=0x%x file_size=0x%zx\n"
+                "        If this file is VPD partition only, try to\n"
+                "        use -E to adjust offset values.\n",
+                (uint32_t)vpd_offset, (uint32_t)spd_offset, spd_len,
+                read_buf->size());
+        return VPD_ERR_INVALID;
+      }
+
+      free(region->spd_data);
+      region->spd_data = reinterpret_cast<uint8_t*>(malloc(spd_len));
+      if (!region->spd_data) {
+        fprintf(stderr, "spd_data: malloc(%d bytes) failed.\n", spd_len);
+        return VPD_ERR_SYSTEM;
+      }
+      memcpy(region->spd_data, read_buf->data() + vpd_offset + spd_offset,
+             spd_len);
+      region->file_flag |= HAS_SPD;
+
+    } else if (i == tables.blobs[VPD_BLOB_VPD_2_0]) {
+      /* VPD 2.0 */
+      /* Like coreboot, find the pairs through the google_vpd_info that
+       * saveFile() writes at vpd_2_0_offset. */
+      const uint32_t info_offset = region->vpd_2_0_offset;
+      if (info_offset + sizeof(struct google_vpd_info) <= vpd_size) {
+        const struct google_vpd_info* info =
+            reinterpret_cast<const struct google_vpd_info*>(vpd_buf +
+                                                            info_offset);
+        const uint8_t* pairs = vpd_buf + info_offset + sizeof(*info);
+        if (!memcmp(info->header.magic, encoding::kVpdInfoHeader.data,
+                    encoding::kVpdInfoHeader.size()) &&
+            info->size <= vpd_size - info_offset - sizeof(*info))
+          region->raw_pairs.assign(pairs, pairs + info->size);
+      }
+      /* iterate all pairs */
+      for (; index < vpd_size && vpd_buf[index] != VPD_TYPE_TERMINATOR &&
+             vpd_buf[index] != VPD_TYPE_IMPLICIT_TERMINATOR;) {
+        retval = decodeToContainerFiltered(container, region->decode_filter,
+                                           vpd_size, vpd_buf, &index);
+        if (VPD_OK != retval) {
+          fprintf(stderr, "decodeToContainer() error.\n");
+          return retval;
+        }
+      }
+      region->file_flag |= HAS_VPD_2_0;
+
+    } else if (i == tables.blobs[VPD_BLOB_VPD_1_2]) {
+      /* VPD 1_2: please refer to "Google VPD Type 241 Format v1.2" */
+      const struct V12 {
+        uint8_t prod_sn[0x20];
+        uint8_t sku[0x10];
+        uint8_t uuid[0x10];
+        uint8_t mb_sn[0x10];
+        uint8_t imei[0x10];
+        uint8_t ssd_sn[0x10];
+        uint8_t mem_sn[0x10];
+        uint8_t wlan_mac[0x06];
+      }* v12 = reinterpret_cast<const struct V12*>(&vpd_buf[index]);
+      if (sizeof(*v12) > vpd_size - index) {
+        fprintf(stderr, "[ERROR] VPD 1.2 data is truncated.\n");
+        return VPD_ERR_INVALID;
+      }
+      setString(container, reinterpret_cast<const uint8_t*>("Product_SN"),
+                extractString(v12->prod_sn, sizeof(v12->prod_sn)),
+                VPD_AS_LONG_AS);
+      setString(container, reinterpret_cast<const uint8_t*>("SKU"),
+                extractString(v12->sku, sizeof(v12->sku)), VPD_AS_LONG_AS);
+      setString(container, reinterpret_cast<const uint8_t*>("UUID"),
+                extractHex(v12->uuid, sizeof(v12->uuid)), VPD_AS_LONG_AS);
+      setString(container, reinterpret_cast<const uint8_t*>("MotherBoard_SN"),
+                extractString(v12->mb_sn, sizeof(v12->mb_sn)), VPD_AS_LONG_AS);
+      setString(container, reinterpret_cast<const uint8_t*>("IMEI"),
+                extractString(v12->imei, sizeof(v12->imei)), VPD_AS_LONG_AS);
+      setString(container, reinterpret_cast<const uint8_t*>("SSD_SN"),
+                extractString(v12->ssd_sn, sizeof(v12->ssd_sn)),
+                VPD_AS_LONG_AS);
+      setString(container, reinterpret_cast<const uint8_t*>("Memory_SN"),
+                extractString(v12->mem_sn, sizeof(v12->mem_sn)),
+                VPD_AS_LONG_AS);
+      setString(container, reinterpret_cast<const uint8_t*>("WLAN_MAC"),
+                extractHex(v12->wlan_mac, sizeof(v12->wlan_mac)),
+                VPD_AS_LONG_AS);
+      region->file_flag |= HAS_VPD_1_2;
+
+    } else {
+      /* un-supported UUID */
+      char outstr[37]; /* 36-char + 1 null terminator */
+
+      uuid_unparse(data->uuid, outstr);
+      fprintf(stderr, "[ERROR] un-supported UUID: %s\n", outstr);
+      return VPD_ERR_INVALID;
+    }
+  }
+
+  return VPD_OK;
+}
+
+/* Encodes region->file into region->encoded and the EPS with its tables into
+ * eps[]. */
+vpd_err_t encodeRegion(struct VpdRegion* region,
+                       int max_eps_len,
+                       unsigned char* eps,
+                       int* eps_len) {
+  std::vector<uint8_t>& buf = region->encoded;
+  int buf_len;
+
+  memset(eps, 0xff, max_eps_len);
+  packContainer(&region->file, region->compress_min);
+  /* Room for the info, the pairs and the terminator, up to BUF_LEN. */
+  buf.assign(std::min<size_t>(sizeof(struct google_vpd_info) +
+                                  encodeContainerSize(&region->file) + 1,
+                              BUF_LEN),
+             0);
+
+  /* prepare info */
+  struct google_vpd_info* info = (struct google_vpd_info*)buf.data();
+  buf_len = sizeof(*info);
+  memcpy(info->header.magic, encoding::kVpdInfoHeader.data,
+         encoding::kVpdInfoHeader.size());
+
+  /* encode into buffer */
+  vpd_err_t retval =
+      encodeContainer(&region->file, buf.size(), buf.data(), &buf_len);
+  if (VPD_OK != retval) {
+    fprintf(stderr, "encodeContainer() error.\n");
+    return retval;
+  }
+  retval = encodeVpdTerminator(buf.size(), buf.data(), &buf_len);
+  if (VPD_OK != retval) {
+    fprintf(stderr, "Out of space for terminator.\n");
+    return retval;
+  }
+  info->size = buf_len - sizeof(*info);
+  buf.resize(buf_len);
+
+  *eps_len = 0;
+  retval = buildEpsAndTables(region, buf_len, max_eps_len, eps, eps_len);
+  if (VPD_OK != retval) {
+    fprintf(stderr, "Cannot build EPS.\n");
+    return retval;
+  }
+  assert(*eps_len <= GOOGLE_SPD_OFFSET);
+  return VPD_OK;
+}
+
+/* Returns true if data[0..len) at offset of the loaded partition is the same
+ * as what saveFile() is about to write there. */
+bool isLoadedSame(const struct VpdRegion* region,
+                  uint32_t offset,
+                  const uint8_t* data,
+                  size_t len) {
+  return offset <= region->loaded.size() &&
+         len <= region->loaded.size() - offset &&
+         !memcmp(region->loaded.data() + offset, data, len);
+}
+
+/* Returns true if the encoded region in eps[] and region->encoded would not
+ * change the loaded partition. */
+bool isRegionUnchanged(const struct VpdRegion* region,
+                       const unsigned char* eps,
+                       int eps_len) {
+  /* saveFile() recreates the file if the partition was not found. */
+  if (!region->found_vpd)
+    return false;
+  if (!isLoadedSame(region, region->eps_offset, eps, eps_len))
+    return false;
+  if (region->spd_data && !isLoadedSame(region, region->spd_offset,
+                                        region->spd_data, region->spd_len))
+    return false;
+  return isLoadedSame(region, region->vpd_2_0_offset, region->encoded.data(),
+                      region->encoded.size());
+}
+
+vpd_err_t saveFile(const struct VpdRegion* region,
+                   const char* filename,
+                   int write_back_to_flash,
+                   const unsigned char* eps,
+                   int eps_len) {
+  FILE* fp;
+
+  /* Write data in the following order:
+   *   1. EPS
+   *   2. SPD
+   *   3. VPD 2.0
+   */
+  if (region->found_vpd) {
+    /* We found VPD partition in -f file, which means file is existed.
+     * Instead of truncating the whole file, open to write partial. */
+    if (!(fp = fopen(filename, "r+"))) {
+      fprintf(stderr, "File [%s] cannot be opened for write.\n", filename);
+      return VPD_ERR_SYSTEM;
+    }
+  } else {
+    /* VPD is not found, which means the file is pure VPD data.
+     * Always creates the new file and overwrites the original content. */
+    if (!(fp = fopen(filename, "w+"))) {
+      fprintf(stderr, "File [%s] cannot be opened for write.\n", filename);
+      return VPD_ERR_SYSTEM;
+    }
+  }
+
+  const uint32_t file_seek = write_back_to_flash ? 0 : region->vpd_offset;
+
+  /* write EPS */
+  fseek(fp, file_seek + region->eps_offset, SEEK_SET);
+  if (fwrite(eps, eps_len, 1, fp) != 1) {
+    fprintf(stderr, "fwrite(EPS) error (%s)\n", strerror(errno));
+    return VPD_ERR_SYSTEM;
+  }
+
+  /* write SPD */
+  if (region->spd_data) {
+    fseek(fp, file_seek + region->spd_offset, SEEK_SET);
+    if (fwrite(region->spd_data, region->spd_len, 1, fp) != 1) {
+      fprintf(stderr, "fwrite(SPD) error (%s)\n", strerror(errno));
+      return VPD_ERR_SYSTEM;
+    }
+  }
+
+  /* write VPD 2.0 */
+  fseek(fp, file_seek + region->vpd_2_0_offset, SEEK_SET);
+  if (fwrite(region->encoded.data(), region->encoded.size(), 1, fp) != 1) {
+    fprintf(stderr, "fwrite(VPD 2.0) error (%s)\n", strerror(errno));
+    return VPD_ERR_SYSTEM;
+  }
+  fclose(fp);
+
+  return VPD_OK;
+}
+
+/* Returns the value of the environment variable name, or fallback if it is
+ * not set. */
+const char* getPath(const char* name, const char* fallback) {
+  const char* path = getenv(name);
+  return (path && *path) ? path : fallback;
+}
+
+/* The marker file touched whenever a region is written to flash. It lives on
+ * tmpfs, so it tells whether sysfs (decoded at boot) is still current. */
+std::string writtenMarker(const std::string& region_name) {
+  return std::string(getPath("VPD_RUN_DIR", VPD_RUN_DIR)) + "/" +
+         region_name + ".written";
+}
+
+void markRegionWritten(const std::string& region_name) {
+  std::string marker = writtenMarker(region_name);
+  mkdir(getPath("VPD_RUN_DIR", VPD_RUN_DIR), 0755);
+  int fd = open(marker.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0 || futimens(fd, NULL) < 0)
+    fprintf(stderr, "[WARN] Cannot update %s.\n", marker.c_str());
+  if (fd >= 0)
+    close(fd);
+}
+
+/* Adds key=value to region->file unless region->decode_filter drops the
+ * key. */
+void addSourcePair(struct VpdRegion* region,
+                   const std::string& key,
+                   const std::string& value) {
+  const struct VpdKeyFilter* decode_filter = region->decode_filter;
+  if (decode_filter && !isKeyFilterEmpty(decode_filter) &&
+      !matchKeyFilter(decode_filter,
+                      reinterpret_cast<const uint8_t*>(key.c_str()),
+                      key.size()))
+    return;
+  setString(&region->file, reinterpret_cast<const uint8_t*>(key.c_str()),
+            reinterpret_cast<const uint8_t*>(value.c_str()), VPD_AS_LONG_AS);
+}
+
+/* The blob of all records of region that the kernel exports in sysfs. */
+std::string sysfsRawPath(const struct VpdRegion* region) {
+  return std::string(getPath("VPD_SYSFS_DIR", VPD_SYSFS_DIR)) +
+         (region->name == "RO_VPD" ? "/ro_raw" : "/rw_raw");
+}
+
+/* Loads region->file from /sys/firmware/vpd. The kernel only makes files in
+ * {ro,rw} for the strings in front of the first record of a type it does not
+ * know, so those are read one file per key only without {ro,rw}_raw. */
+vpd_err_t loadFromSysfs(struct VpdRegion* region) {
+  const std::string raw = sysfsRawPath(region);
+  if (!access(raw.c_str(), R_OK))
+    return loadRawFile(raw.c_str(), region);
+
+  std::string dir = std::string(getPath("VPD_SYSFS_DIR", VPD_SYSFS_DIR)) +
+                    (region->name == "RO_VPD" ? "/ro" : "/rw");
+  DIR* d = opendir(dir.c_str());
+  if (!d)
+    return VPD_ERR_NOT_FOUND;
+
+  std::vector<std::string> keys;
+  struct dirent* entry;
+  while ((entry = readdir(d))) {
+    if (entry->d_name[0] != '.')
+      keys.push_back(entry->d_name);
+  }
+  closedir(d);
+  /* readdir() order is arbitrary; keep -l output stable. */
+  std::sort(keys.begin(), keys.end());
+
+  for (const auto& key : keys) {
+    std::string value;
+    if (!readFileToString((dir + "/" + key).c_str(), &value)) {
+      fprintf(stderr, "[ERROR] Cannot read %s/%s.\n", dir.c_str(),
+              key.c_str());
+      return VPD_ERR_SYSTEM;
+    }
+    addSourcePair(region, key, value);
+  }
+  return VPD_OK;
+}
+
+/* Loads region->file from the text cache written by dump_vpd_log: lines of
+ * "key"="value", RO_VPD first, then CACHE_RO_RW_DELIMITER and RW_VPD.
+ * Returns VPD_ERR_INVALID if the cache is not in that format. */
+vpd_err_t loadFromCacheText(struct VpdRegion* region, const char* path) {
+  std::string text;
+  if (!readFileToString(path, &text))
+    return VPD_ERR_NOT_FOUND;
+
+  const bool want_rw = region->name == "RW_VPD";
+  bool in_rw = false;
+  size_t start = 0;
+  while (start < text.size()) {
+    size_t end = text.find('\n', start);
+    if (end == std::string::npos)
+      end = text.size();
+    const std::string line = text.substr(start, end - start);
+    start = end + 1;
+
+    if (line == CACHE_RO_RW_DELIMITER) {
+      if (in_rw)
+        return VPD_ERR_INVALID;
+      in_rw = true;
+      continue;
+    }
+    /* dump_vpd_log notes a partition it failed to read with a comment,
+     * which only spoils that partition. */
+    if (!line.empty() && line.front() == '#') {
+      if (in_rw == want_rw)
+        return VPD_ERR_INVALID;
+      continue;
+    }
+    size_t sep = line.find("\"=\"");
+    if (line.size() < 5 || line.front() != '"' || line.back() != '"' ||
+        sep == std::string::npos || sep + 3 > line.size() - 1)
+      return VPD_ERR_INVALID;
+    if (in_rw == want_rw)
+      addSourcePair(region, line.substr(1, sep - 1),
+                    line.substr(sep + 3, line.size() - sep - 4));
+  }
+  /* A cache without the delimiter was cut short, or never generated. */
+  return in_rw ? VPD_OK : VPD_ERR_INVALID;
+}
+
+/* Replaces path with len bytes of data, atomically. */
+vpd_err_t writeFileAtomically(const char* path, const void* data, size_t len) {
+  std::string tmp_path = std::string(path) + ".XXXXXX";
+  int fd = mkstemp(&tmp_path[0]);
+  if (fd < 0)
+    return VPD_ERR_SYSTEM;
+  if (write(fd, data, len) != static_cast<ssize_t>(len) || fsync(fd) < 0) {
+    close(fd);
+    unlink(tmp_path.c_str());
+    return VPD_ERR_SYSTEM;
+  }
+  close(fd);
+  if (rename(tmp_path.c_str(), path) < 0) {
+    unlink(tmp_path.c_str());
+    return VPD_ERR_SYSTEM;
+  }
+  return VPD_OK;
+}
+
+/* Writes ro and rw to path in the text cache format of dump_vpd_log,
+ * replacing it atomically. */
+vpd_err_t writeTextCache(const char* path,
+                         struct PairContainer* ro,
+                         struct PairContainer* rw) {
+  std::string text;
+  for (struct PairContainer* container : {ro, rw}) {
+    std::vector<uint8_t> buf(BUF_LEN * 5 + 64);
+    int len = 0;
+
+    setContainerKeyFilter(container, NULL);
+    vpd_err_t retval = exportContainer(VPD_EXPORT_KEY_VALUE, container,
+                                       buf.size(), buf.data(), &len);
+    if (VPD_OK != retval)
+      return retval;
+    text.append(reinterpret_cast<const char*>(buf.data()), len);
+    if (container == ro)
+      text += CACHE_RO_RW_DELIMITER "\n";
+  }
+  return writeFileAtomically(path, text.data(), text.size());
+}
+
+/* Loads region->name from the binary cache at path into region->file, and
+ * sets generation to that of the cache. */
+vpd_err_t loadFromBinaryCache(struct VpdRegion* region,
+                              const char* path,
+                              uint64_t* generation) {
+  const int section =
+      region->name == "RO_VPD" ? VPD_CACHE_RO : VPD_CACHE_RW;
+  struct VpdCache cache;
+  vpd_err_t retval = openVpdCache(&cache, path);
+  if (VPD_OK != retval)
+    return retval;
+
+  for (uint32_t i = 0; i < getVpdCacheCount(&cache, section); i++) {
+    const char* key;
+    const uint8_t* value;
+    uint32_t value_len;
+    int type;
+
+    getVpdCacheEntry(&cache, section, i, &key, &value, &value_len, &type);
+    if (type == VPD_TYPE_BINARY)
+      setBinary(&region->file, reinterpret_cast<const uint8_t*>(key), value,
+                value_len);
+    else
+      setString(&region->file, reinterpret_cast<const uint8_t*>(key), value,
+                VPD_AS_LONG_AS);
+  }
+  *generation = getVpdCacheGeneration(&cache);
+  closeVpdCache(&cache);
+  return VPD_OK;
+}
+
+/* Brings the caches of dump_vpd_log up to date after region was written to
+ * flash, from memory rather than by reading the flash again. The other
+ * partition comes from the binary cache, or if that is not usable from the
+ * flash; the text cache has binary values as base64, so it cannot tell them
+ * from strings. The binary cache goes one generation up,
+ * so readers can tell that it changed from its header alone. The raw
+ * snapshot of region becomes what the kernel will export after the next
+ * boot, so the caches stay valid across it.
+ *
+ * Without a binary cache there is nothing to bring up to date, as in the
+ * factory or without a stateful partition; the flash is then not read again
+ * just to find out whether a cache can be written. Only a cache that exists
+ * but cannot be read is rebuilt from the flash.
+ */
+void updateCaches(struct VpdRegion* region) {
+  const char* text_path = getPath("VPD_CACHE_FILE", VPD_CACHE_FILE);
+  const char* binary_path =
+      getPath("VPD_BINARY_CACHE_FILE", VPD_BINARY_CACHE_FILE);
+  const bool is_ro = region->name == "RO_VPD";
+  VpdRegion other;
+  uint64_t generation = 0;
+  vpd_err_t retval;
+
+  if (access(binary_path, F_OK) && errno == ENOENT) {
+    /* A text cache alone is stale now; dump_vpd_log regenerates both. */
+    unlink(text_path);
+    writeRawSnapshot(binary_path, region->name, {});
+    return;
+  }
+
+  other.name = is_ro ? "RW_VPD" : "RO_VPD";
+  retval = loadFromBinaryCache(&other, binary_path, &generation);
+  if (VPD_OK != retval) {
+    /* Keep counting up even if the rest of the cache is broken. */
+    readVpdCacheGeneration(binary_path, &generation);
+    destroyContainer(&other.file);
+    initContainer(&other.file);
+    retval = openRegion(&other, NULL, false, false);
+  }
+
+  struct PairContainer* ro = is_ro ? &region->file : &other.file;
+  struct PairContainer* rw = is_ro ? &other.file : &region->file;
+  if (VPD_OK == retval)
+    retval = writeVpdCache(binary_path, generation + 1, ro, rw);
+  if (VPD_OK == retval)
+    retval = writeTextCache(text_path, ro, rw);
+  if (VPD_OK == retval) {
+    const std::vector<uint8_t>& encoded = region->encoded;
+    retval = writeRawSnapshot(
+        binary_path, region->name,
+        std::vector<uint8_t>(
+            encoded.begin() + sizeof(struct google_vpd_info), encoded.end()));
+  }
+  if (VPD_OK != retval) {
+    /* Better no cache than a stale one; dump_vpd_log regenerates them. */
+    fprintf(stderr, "[WARN] Cannot update the VPD caches: %d\n", retval);
+    unlink(binary_path);
+    unlink(text_path);
+    writeRawSnapshot(binary_path, region->name, {});
+  }
+}
+
+/* Replaces out with the contents of path. Reads in one go when st_size is
+ * right; files in sysfs report 4096 or 0, so keep reading until the end. */
+template <typename T>
+bool readFileTo(const char* path, T* out) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  size_t size = 4096;
+  if (!fstat(fd, &st) && st.st_size > 0)
+    size = st.st_size + 1; /* one more byte to see the end without growing */
+  out->resize(size);
+
+  size_t used = 0;
+  for (;;) {
+    if (used == out->size())
+      out->resize(used * 2);
+    ssize_t len = read(fd, &(*out)[used], out->size() - used);
+    if (len == 0)
+      break;
+    if (len < 0) {
+      if (errno == EINTR)
+        continue;
+      const int saved_errno = errno;
+      close(fd);
+      errno = saved_errno;
+      return false;
+    }
+    used += len;
+  }
+  close(fd);
+  out->resize(used);
+  return true;
+}
+
+}  // namespace
+
+std::optional<std::vector<uint8_t>> readFileToBytes(const char* path) {
+  std::vector<uint8_t> bytes;
+  if (!readFileTo(path, &bytes))
+    return std::nullopt;
+  return bytes;
+}
+
+bool readFileToString(const char* path, std::string* contents) {
+  return readFileTo(path, contents);
+}
+
+VpdRegion::~VpdRegion() {
+  free(spd_data);
+  destroyContainer(&file);
+  for (const auto& temp_file : temp_files) {
+    if (unlink(temp_file.c_str()) < 0) {
+      fprintf(stderr, "warning: failed removing temporary file: %s\n",
+              temp_file.c_str());
+    }
+  }
+}
+
+vpd_err_t openRegion(struct VpdRegion* region,
+                     const char* filename,
+                     bool raw_input,
+                     bool overwrite_it) {
+  vpd_err_t retval;
+
+  /* if no filename is specified, call flashrom to read from flash. */
+  if (!filename) {
+    const char* tmp_part_file = makeTempFile(region);
+    const char* tmp_full_file = makeTempFile(region);
+    if (!tmp_part_file || !tmp_full_file) {
+      fprintf(stderr, "[ERROR] Failed creating temporary files.\n");
+      return VPD_ERR_SYSTEM;
+    }
+
+    if (FLASHROM_OK != flashromPartialRead(tmp_part_file, tmp_full_file,
+                                           region->name.c_str())) {
+      fprintf(stderr, "[WARN] flashromPartialRead() failed, try full read.\n");
+      /* Try to read whole file */
+      if (FLASHROM_OK != flashromFullRead(tmp_full_file)) {
+        fprintf(stderr, "[ERROR] flashromFullRead() error!\n");
+        return VPD_ERR_ROM_READ;
+      }
+    }
+
+    region->write_back_to_flash = 1;
+    region->load_file = tmp_full_file;
+    region->save_file = tmp_part_file;
+  } else {
+    region->load_file = filename;
+    region->save_file = filename;
+  }
+
+  if (raw_input)
+    retval = loadRawFile(region->load_file, region);
+  else
+    retval = loadFile(region, region->load_file, overwrite_it);
+  if (VPD_OK != retval) {
+    fprintf(stderr, "loadFile('%s') error.\n", region->load_file);
+    return retval;
+  }
+  return VPD_OK;
+}
+
+vpd_err_t writeRawSnapshot(const char* cache_path,
+                           const std::string& region_name,
+                           const std::vector<uint8_t>& raw_pairs) {
+  std::string path(cache_path);
+  size_t slash = path.rfind('/');
+  path = (slash == std::string::npos ? std::string(".")
+                                     : path.substr(0, slash)) +
+         (region_name == "RO_VPD" ? "/ro_raw" : "/rw_raw");
+
+  if (raw_pairs.empty()) {
+    if (unlink(path.c_str()) < 0 && errno != ENOENT)
+      return VPD_ERR_SYSTEM;
+    return VPD_OK;
+  }
+  return writeFileAtomically(path.c_str(), raw_pairs.data(), raw_pairs.size());
+}
+
+vpd_err_t loadFromSource(struct VpdRegion* region, enum ReadSource source) {
+  const char* cache = getPath("VPD_CACHE_FILE", VPD_CACHE_FILE);
+  const char* binary_cache =
+      getPath("VPD_BINARY_CACHE_FILE", VPD_BINARY_CACHE_FILE);
+  struct stat marker_st;
+  const bool written =
+      !stat(writtenMarker(region->name).c_str(), &marker_st);
+
+  if (source == SOURCE_SYSFS)
+    return loadFromSysfs(region);
+  if (source == SOURCE_CACHE)
+    return loadFromCacheText(region, cache);
+
+  /* Without the raw blob, sysfs may be missing keys. */
+  if (!written && !access(sysfsRawPath(region).c_str(), R_OK))
+    return loadFromSysfs(region);
+
+  /* A cache is current unless the region was written after it. */
+  auto isCurrent = [&](const char* path) {
+    struct stat st;
+    return !stat(path, &st) &&
+           (!written || st.st_mtim.tv_sec > marker_st.st_mtim.tv_sec ||
+            (st.st_mtim.tv_sec == marker_st.st_mtim.tv_sec &&
+             st.st_mtim.tv_nsec > marker_st.st_mtim.tv_nsec));
+  };
+  /* The binary cache keeps the type of binary values; prefer it. */
+  if (isCurrent(binary_cache)) {
+    uint64_t generation;
+    if (VPD_OK == loadFromBinaryCache(region, binary_cache, &generation))
+      return VPD_OK;
+    destroyContainer(&region->file);
+    initContainer(&region->file);
+  }
+  if (!isCurrent(cache))
+    return VPD_ERR_NOT_FOUND;
+  return loadFromCacheText(region, cache);
+}
+
+vpd_err_t commitRegion(struct VpdRegion* region) {
+  vpd_err_t retval;
+
+  if (region->file_flag & HAS_VPD_1_2) {
+    fprintf(stderr, "[ERROR] Writing VPD 1.2 not supported yet.\n");
+    return VPD_FAIL;
+  }
+
+  unsigned char eps[1024];
+  int eps_len;
+  retval = encodeRegion(region, sizeof(eps), eps, &eps_len);
+  if (VPD_OK != retval)
+    return retval;
+
+  /* Skip the write (and the slow flashrom run) if nothing changed. */
+  if (isRegionUnchanged(region, eps, eps_len)) {
+    region->modified = 0;
+    return VPD_UNCHANGED;
+  }
+
+  retval = saveFile(region, region->save_file, region->write_back_to_flash,
+                    eps, eps_len);
+  if (VPD_OK != retval) {
+    fprintf(stderr, "saveFile('%s') error: %d\n", region->save_file, retval);
+    return retval;
+  }
+
+  if (region->write_back_to_flash) {
+    if (FLASHROM_OK != flashromPartialWrite(region->save_file,
+                                            region->load_file,
+                                            region->name.c_str())) {
+      fprintf(stderr, "flashromPartialWrite() error.\n");
+      return VPD_ERR_ROM_WRITE;
+    }
+    markRegionWritten(region->name);
+    updateCaches(region);
+  }
+
+  region->modified = 0;
+  return VPD_OK;
+}
+
+}  // namespace libvpd
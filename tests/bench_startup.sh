@@ -0,0 +1,51 @@
+#!/bin/bash
+#
+# Copyright 2026 The ChromiumOS Authors
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+#
+# Measures how long it takes to start vpd and read one key from an image.
+# Not part of run_tests; run it by hand to compare builds:
+#
+#   OUT=/build/<board>/... ./bench_startup.sh [runs] [baseline vpd]
+#
+# With a baseline binary (e.g. one linked against libchrome) both are timed
+# on the same image.
+set -e
+
+. ./functions.sh
+
+# shellcheck disable=SC2154 # exported by caller
+BINARY="${OUT}/vpd"
+RUNS="${1:-1000}"
+BASELINE="$2"
+TMP_DIR=$(mktemp -d)
+BIOS="${TMP_DIR}/empty.vpd"
+
+# Prints the average wall time of one "vpd -g" run in microseconds.
+bench() {
+  local binary="$1"
+  local start end i
+
+  start=$(date +%s%N)
+  for ((i = 0; i < RUNS; i++)); do
+    "${binary}" -f "${BIOS}" -g serial_number >/dev/null
+  done
+  end=$(date +%s%N)
+  echo $(((end - start) / RUNS / 1000))
+}
+
+main() {
+  unpack_bios vpd_0x600.tbz "${TMP_DIR}"
+  "${BINARY}" -f "${BIOS}" -s serial_number=SN1 >/dev/null
+
+  echo "vpd: $(bench "${BINARY}") us per run (${RUNS} runs)"
+  if [ -n "${BASELINE}" ]; then
+    echo "baseline: $(bench "${BASELINE}") us per run (${RUNS} runs)"
+  fi
+}
+
+main
+clean_up "${TMP_DIR}"
+
+exit 0
@@ -50,6 +50,9 @@ VPD_ERR_NOT_FOUND=9
 VPD_ERR_OVERFLOW=10
 VPD_ERR_INVALID=11
 VPD_ERR_DECODE=12
+VPD_UNCHANGED=13
+VPD_ERR_CONDITION=14
+VPD_ERR_BUSY=15
 
 GREP_OK=0
 GREP_FAIL=1
@@ -0,0 +1,78 @@
+#!/bin/bash
+#
+# Copyright 2026 The ChromiumOS Authors
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+set -e
+
+. ./functions.sh
+
+# shellcheck disable=SC2154 # exported by caller
+BINARY="${OUT}/vpd"
+TMP_DIR=$(mktemp -d)
+BIOS_PACKS=( vpd_0x600.tbz gVpdInfo.tbz )
+BIOS="${TMP_DIR}/empty.vpd"
+OPS="${TMP_DIR}/ops.txt"
+
+test_image() {
+  local pack="$1"
+
+  echo "  testing '${pack}' ..."
+  unpack_bios "${pack}" "${TMP_DIR}"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -O"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -i RW_VPD -O"
+
+  #
+  # Operations on both regions, written back at end of input.
+  cat >"${OPS}" <<EOT
+# comment
+set aaa=bbb
+pad 8
+set ccc=d d
+get aaa
+region RW_VPD
+set rw=1
+list
+region RO_VPD
+get none
+EOT
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} --batch ${OPS}" \
+      $'+aaa=bbb\n"rw"="1"\n-none'
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -l" $'"aaa"="bbb"\n"ccc"="d d"'
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -i RW_VPD -g rw" "1"
+
+  #
+  # A failed operation drops everything since the last commit.
+  RUN "${VPD_ERR_PARAM}" \
+      "printf 'delete aaa\ncommit\nset x=y\ndelete none\n' |
+       ${BINARY} -f ${BIOS} --batch -"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -l" '"ccc"="d d"'
+
+  #
+  # A failed condition works the same way.
+  RUN "${VPD_ERR_CONDITION}" \
+      "printf 'if ccc=d d\nset x=1\nif-absent x\n' |
+       ${BINARY} -f ${BIOS} --batch -"
+  RUN "${VPD_OK}" "printf 'if ccc=d d\nif-absent x\nset x=1\n' |
+                   ${BINARY} -f ${BIOS} --batch -"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -g x" "1"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -d x"
+
+  #
+  # Syntax errors.
+  RUN "${VPD_ERR_SYNTAX}" "echo 'frobnicate' | ${BINARY} -f ${BIOS} --batch -"
+  RUN "${VPD_ERR_SYNTAX}" "echo 'region XX' | ${BINARY} -f ${BIOS} --batch -"
+  RUN "${VPD_ERR_SYNTAX}" "echo 'list' | ${BINARY} -f ${BIOS} -l --batch -"
+}
+
+main() {
+  for pack in "${BIOS_PACKS[@]}"
+  do
+    test_image "${pack}"
+  done
+}
+
+main
+clean_up "${TMP_DIR}"
+
+exit 0
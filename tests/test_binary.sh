@@ -0,0 +1,71 @@
+#!/bin/bash
+#
+# Copyright 2026 The ChromiumOS Authors
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+set -e
+
+. ./functions.sh
+
+# shellcheck disable=SC2154 # exported by caller
+BINARY="${OUT}/vpd"
+VPD_GET="${OUT}/vpd-get"
+TMP_DIR=$(mktemp -d)
+BIOS_PACKS=( vpd_0x600.tbz gVpdInfo.tbz )
+BIOS="${TMP_DIR}/empty.vpd"
+RAW="${TMP_DIR}/icc.raw"
+BASE64="${TMP_DIR}/icc.b64"
+
+test_image() {
+  local pack="$1"
+  local b64
+
+  echo "  testing '${pack}' ..."
+  unpack_bios "${pack}" "${TMP_DIR}"
+  printf 'ab\x00\xff\n"cd' >"${RAW}"
+  base64 -w 8 "${RAW}" >"${BASE64}"
+  b64=$(base64 -w 0 "${RAW}")
+
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -O --binary-file icc=${BASE64} \
+                   -s region=us"
+  # -g and vpd-get print the bytes, the text formats base64.
+  RUN 0 "${BINARY} -f ${BIOS} -g icc | cmp - ${RAW}"
+  RUN 0 "${VPD_GET} -f ${BIOS} icc | cmp - ${RAW}"
+  # Binary values are written after the strings.
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -l" \
+      "\"region\"=\"us\""$'\n'"\"icc\"=\"${b64}\""
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -0 -l | tr '\\0' ," \
+      "region=us,icc=${b64},"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} --get-keys icc" "+icc=${b64}"
+
+  # The partition has the 8 bytes, not 12 of base64.
+  RUN "${GREP_OK}" "grep -c icc.ab ${BIOS}"
+
+  # Keeping the other pairs keeps the binary value.
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -s region=tw -b small=AQI="
+  RUN 0 "${BINARY} -f ${BIOS} -g icc | cmp - ${RAW}"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -g small | od -An -tx1" " 01 02"
+
+  # --sh exports -b, which imports the same bytes.
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -l --sh > ${TMP_DIR}/import.sh"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -O"
+  RUN 0 "sh ${TMP_DIR}/import.sh"
+  RUN 0 "${BINARY} -f ${BIOS} -g icc | cmp - ${RAW}"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -g region" "tw"
+
+  RUN "${VPD_ERR_SYNTAX}" "${BINARY} -f ${BIOS} -b bad=a*b= 2>/dev/null"
+  RUN "${VPD_ERR_SYNTAX}" "${BINARY} -f ${BIOS} --binary-file bad=${RAW} \
+                           2>/dev/null"
+}
+
+main() {
+  for pack in "${BIOS_PACKS[@]}"
+  do
+    test_image "${pack}"
+  done
+}
+
+main
+clean_up "${TMP_DIR}"
+
+exit 0
@@ -0,0 +1,79 @@
+#!/bin/bash
+#
+# Copyright 2026 The ChromiumOS Authors
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+set -e
+
+. ./functions.sh
+
+# shellcheck disable=SC2154 # exported by caller
+BINARY="${OUT}/vpd"
+TMP_DIR=$(mktemp -d)
+BIOS_PACKS=( vpd_0x600.tbz gVpdInfo.tbz )
+BIOS="${TMP_DIR}/empty.vpd"
+CACHE="${TMP_DIR}/full-v2.bin"
+
+# Prints the generation field of the cache header.
+generation() {
+  od -A n -t u8 -j 16 -N 8 "${CACHE}" | tr -d ' '
+}
+
+test_image() {
+  local pack="$1"
+
+  echo "  testing '${pack}' ..."
+  unpack_bios "${pack}" "${TMP_DIR}"
+  rm -f "${CACHE}"
+
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -s serial=SN1 -s region=us"
+
+  #
+  # An unformatted partition has no raw copy, like in sysfs.
+  touch "${TMP_DIR}/rw_raw"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} --write-cache ${CACHE}"
+  RUN 0 "test -s ${TMP_DIR}/ro_raw"
+  RUN 1 "test -e ${TMP_DIR}/rw_raw"
+  rm -f "${CACHE}"
+
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -i RW_VPD -s block_devmode=1"
+
+  #
+  # The first cache is generation 1, every rewrite adds one.
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} --write-cache ${CACHE}"
+  RUN "${VPD_OK}" "head -c 8 ${CACHE}" "VPDCACHE"
+  RUN "${VPD_OK}" "generation" "1"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} --write-cache ${CACHE}"
+  RUN "${VPD_OK}" "generation" "2"
+  RUN "${GREP_OK}" "grep -q -a SN1 ${CACHE}"
+  RUN "${GREP_OK}" "grep -q -a block_devmode ${CACHE}"
+
+  #
+  # The raw pairs, as the kernel exports them, are kept next to the cache.
+  RUN "${VPD_OK}" "${BINARY} --raw -f ${TMP_DIR}/ro_raw -l" \
+      $'"serial"="SN1"\n"region"="us"'
+  RUN "${VPD_OK}" "${BINARY} --raw -f ${TMP_DIR}/rw_raw -l" \
+      '"block_devmode"="1"'
+
+  #
+  # A broken cache starts over.
+  echo "garbage" >"${CACHE}"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} --write-cache ${CACHE}"
+  RUN "${VPD_OK}" "generation" "1"
+
+  #
+  # Nothing else can be done in the same run.
+  RUN "${VPD_ERR_SYNTAX}" "${BINARY} -f ${BIOS} --write-cache ${CACHE} -l"
+  RUN "${VPD_ERR_SYNTAX}" "${BINARY} -f ${BIOS} --write-cache ${CACHE} -s a=b"
+}
+
+main() {
+  for pack in "${BIOS_PACKS[@]}"; do
+    test_image "${pack}"
+  done
+}
+
+main
+clean_up "${TMP_DIR}"
+
+exit 0
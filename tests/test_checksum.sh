@@ -0,0 +1,57 @@
+#!/bin/bash
+#
+# Copyright 2026 The ChromiumOS Authors
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+set -e
+
+. ./functions.sh
+
+# shellcheck disable=SC2154 # exported by caller
+BINARY="${OUT}/vpd"
+TMP_DIR=$(mktemp -d)
+BIOS_PACKS=( vpd_0x600.tbz gVpdInfo.tbz )
+BIOS="${TMP_DIR}/empty.vpd"
+
+# Overwrites the table_entry_count of the first EPS in the image, which
+# invalidates both EPS checksums.
+corrupt_eps() {
+  local eps
+  eps=$(grep -obUaP "_SM_" "${BIOS}" | head -1 | cut -d: -f1)
+  printf '\x07' | dd of="${BIOS}" bs=1 seek=$((eps + 0x1c)) conv=notrunc \
+    2>/dev/null
+}
+
+test_image() {
+  local pack="$1"
+
+  echo "  testing '${pack}' ..."
+  unpack_bios "${pack}" "${TMP_DIR}"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -O -s serial=SN1"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} --checksum strict -g serial" "SN1"
+
+  corrupt_eps
+  RUN "${GREP_OK}" "${BINARY} -f ${BIOS} -g serial 2>&1 | \
+                    grep 'WARN.*checksum mismatch'"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -g serial 2>/dev/null" "SN1"
+  RUN "${VPD_ERR_INVALID}" "${BINARY} -f ${BIOS} --checksum strict -l"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} --checksum off -g serial 2>&1" "SN1"
+  RUN "${VPD_ERR_SYNTAX}" "${BINARY} -f ${BIOS} --checksum maybe -l"
+
+  #
+  # Writing regenerates the checksums.
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -s region=us 2>/dev/null"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} --checksum strict -g region" "us"
+}
+
+main() {
+  for pack in "${BIOS_PACKS[@]}"
+  do
+    test_image "${pack}"
+  done
+}
+
+main
+clean_up "${TMP_DIR}"
+
+exit 0
@@ -0,0 +1,65 @@
+#!/bin/bash
+#
+# Copyright 2026 The ChromiumOS Authors
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+set -e
+
+. ./functions.sh
+
+# shellcheck disable=SC2154 # exported by caller
+BINARY="${OUT}/vpd"
+VPD_GET="${OUT}/vpd-get"
+TMP_DIR=$(mktemp -d)
+BIOS_PACKS=( vpd_0x600.tbz gVpdInfo.tbz )
+BIOS="${TMP_DIR}/empty.vpd"
+RAW="${TMP_DIR}/icc.raw"
+BASE64="${TMP_DIR}/icc.b64"
+
+test_image() {
+  local pack="$1"
+  local b64
+
+  echo "  testing '${pack}' ..."
+  unpack_bios "${pack}" "${TMP_DIR}"
+  # 1200 bytes of repeated text, which LZ4 packs into a few dozen.
+  for _ in $(seq 100); do printf 'ICC profile '; done >"${RAW}"
+  base64 "${RAW}" >"${BASE64}"
+  b64=$(base64 -w 0 "${RAW}")
+
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -O --binary-file icc=${BASE64} \
+                   -s region=us"
+  RUN 0 "${BINARY} -f ${BIOS} -g icc | cmp - ${RAW}"
+  RUN 0 "${VPD_GET} -f ${BIOS} icc | cmp - ${RAW}"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -l" \
+      "\"region\"=\"us\""$'\n'"\"icc\"=\"${b64}\""
+  RUN "${GREP_FAIL}" "grep -c 'ICC profile ICC profile' ${BIOS}"
+
+  # Changing another pair keeps the value compressed.
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -s region=tw"
+  RUN 0 "${BINARY} -f ${BIOS} -g icc | cmp - ${RAW}"
+  RUN "${GREP_FAIL}" "grep -c 'ICC profile ICC profile' ${BIOS}"
+
+  # Short values and --compress-min 0 store the bytes as they are.
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -d icc -b small=SUNDIElDQyBJQ0M="
+  RUN "${GREP_OK}" "grep -c 'ICC ICC ICC' ${BIOS}"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} --compress-min 0 \
+                   --binary-file icc=${BASE64}"
+  RUN "${GREP_OK}" "grep -c 'ICC profile ICC profile' ${BIOS}"
+  RUN 0 "${BINARY} -f ${BIOS} -g icc | cmp - ${RAW}"
+
+  RUN "${VPD_ERR_SYNTAX}" "${BINARY} -f ${BIOS} --compress-min -1 \
+                           2>/dev/null"
+}
+
+main() {
+  for pack in "${BIOS_PACKS[@]}"
+  do
+    test_image "${pack}"
+  done
+}
+
+main
+clean_up "${TMP_DIR}"
+
+exit 0
@@ -0,0 +1,69 @@
+#!/bin/bash
+#
+# Copyright 2026 The ChromiumOS Authors
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+set -e
+
+. ./functions.sh
+
+# shellcheck disable=SC2154 # exported by caller
+BINARY="${OUT}/vpd"
+VPD_GET="${OUT}/vpd-get"
+TMP_DIR=$(mktemp -d)
+BIOS_PACKS=( vpd_0x600.tbz gVpdInfo.tbz )
+BIOS="${TMP_DIR}/empty.vpd"
+REF="${TMP_DIR}/ref.vpd"
+
+# Prints the anchors of all entry points in the image, sorted.
+anchors() {
+  grep -oaP "_SM3?_" "${BIOS}" | sort | tr '\n' ' '
+}
+
+test_image() {
+  local pack="$1"
+
+  echo "  testing '${pack}' ..."
+  unpack_bios "${pack}" "${TMP_DIR}"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -O -s serial=SN1"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -i RW_VPD -O -s mode=1"
+  RUN "${VPD_OK}" "anchors" "_SM_ _SM_ "
+  cp "${BIOS}" "${REF}"
+
+  #
+  # Convert RO_VPD to SMBIOS 3.0; later writes keep it.
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} --eps 3"
+  RUN "${VPD_OK}" "anchors" "_SM3_ _SM_ "
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} --checksum strict -g serial" "SN1"
+  RUN "${VPD_OK}" "${VPD_GET} -f ${BIOS} serial" "SN1"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -s region=us"
+  RUN "${VPD_OK}" "anchors" "_SM3_ _SM_ "
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -l" \
+      $'"serial"="SN1"\n"region"="us"'
+
+  #
+  # And back to 2.x, identical to never having converted.
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} --eps 2 -d region"
+  RUN "${VPD_OK}" "${BINARY} -f ${REF} -s region=us"
+  RUN "${VPD_OK}" "${BINARY} -f ${REF} -d region"
+  RUN "${VPD_OK}" "cmp ${BIOS} ${REF}"
+
+  #
+  # A new partition with a 3.0 EPS.
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -i RW_VPD --eps 3 -O -s mode=2"
+  RUN "${VPD_OK}" "anchors" "_SM3_ _SM_ "
+  RUN "${VPD_OK}" "${VPD_GET} -f ${BIOS} -i RW_VPD mode" "2"
+  RUN "${VPD_ERR_SYNTAX}" "${BINARY} -f ${BIOS} --eps 1"
+}
+
+main() {
+  for pack in "${BIOS_PACKS[@]}"
+  do
+    test_image "${pack}"
+  done
+}
+
+main
+clean_up "${TMP_DIR}"
+
+exit 0
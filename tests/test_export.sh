@@ -58,6 +58,26 @@ test_image() {
   RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -g aaa" "bbb"
   RUN "${VPD_FAIL}" "${BINARY} -f ${BIOS} -g xxx" ""
 
+  #
+  # list only the keys matching -k
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -s aab=ccc -s xyz=ddd"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -l -k xyz" '"xyz"="ddd"'
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -l -k 'aa*' | wc -l" "2"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -l -k 'a?a,none' -k x*" \
+      $'"aaa"="bbb"\n"xyz"="ddd"'
+  RUN "${VPD_ERR_SYNTAX}" "${BINARY} -f ${BIOS} -g aaa -k aaa"
+
+  #
+  # export multiple vpd data in one pass
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -g aaa -g xyz" $'+aaa=bbb\n+xyz=ddd'
+  RUN "${VPD_FAIL}" "${BINARY} -f ${BIOS} -g xyz -g none -g aaa" \
+      $'+xyz=ddd\n-none\n+aaa=bbb'
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} --get-keys aab" "+aab=ccc"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} --get-keys aaa,xyz -0 | xxd -ps" \
+      "2b6161613d626262002b78797a3d64646400"
+  RUN "${VPD_FAIL}" "${BINARY} -f ${BIOS} -g 'a*' -g 'a?a' -g xyz" \
+      $'-a*\n-a?a\n+xyz=ddd'
+
   #
   # export to shell script
   # Expect to get the same value after import back
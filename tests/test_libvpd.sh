@@ -0,0 +1,43 @@
+#!/bin/bash
+#
+# Copyright 2026 The ChromiumOS Authors
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+set -e
+
+. ./functions.sh
+
+# shellcheck disable=SC2154 # exported by caller
+BINARY="${OUT}/vpd"
+LIBVPD_TEST="${OUT}/libvpd_test"
+TMP_DIR=$(mktemp -d)
+BIOS_PACKS=( vpd_0x600.tbz gVpdInfo.tbz )
+BIOS="${TMP_DIR}/empty.vpd"
+
+test_image() {
+  local pack="$1"
+
+  echo "  testing '${pack}' ..."
+  unpack_bios "${pack}" "${TMP_DIR}"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -O"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -i RW_VPD -O"
+
+  RUN "${VPD_OK}" "${LIBVPD_TEST} ${BIOS} | tail -n 1" "SUCCESS!"
+
+  #
+  # What libvpd wrote is what vpd reads.
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -g libvpd_ro" "libvpd_value"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -i RW_VPD -g libvpd_rw" "rw_value"
+  RUN "${GREP_FAIL}" "${BINARY} -f ${BIOS} -l | grep libvpd_gone"
+}
+
+main() {
+  for pack in "${BIOS_PACKS[@]}"; do
+    test_image "${pack}"
+  done
+}
+
+main
+clean_up "${TMP_DIR}"
+
+exit 0
@@ -91,6 +91,29 @@ test_image() {
   # expect SUCCESS and nothing left.
   RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -s K98 -s K99 -d K98 -d K99"
   RUN "${GREP_FAIL}" "${BINARY} -f ${BIOS} -l | grep -e '.*'"
+
+  #
+  # Setting the current values again does not write anything.
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -s K0=D0 -s K1=D1 --exit-unchanged"
+  local before
+  before="$(md5sum <"${BIOS}")"
+  RUN "${VPD_UNCHANGED}" "${BINARY} -f ${BIOS} -s K1=D1 --exit-unchanged"
+  RUN "${VPD_UNCHANGED}" "${BINARY} -f ${BIOS} -s K0=D0 -s K1=D1 --exit-unchanged"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -s K1=D1"
+  EXPECT_EQ "$(md5sum <"${BIOS}")" "${before}" "unchanged image"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -s K1=d1 --exit-unchanged"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -d K0 -d K1"
+
+  #
+  # Conditional changes.
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} --if-absent K0 -s K0=D0"
+  RUN "${VPD_ERR_CONDITION}" "${BINARY} -f ${BIOS} --if-absent K0 -s K0=x"
+  RUN "${VPD_ERR_CONDITION}" "${BINARY} -f ${BIOS} --if K0=x -s K0=y"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -g K0" "D0"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} --if K0=D0 -s K0=D1"
+  RUN "${VPD_ERR_CONDITION}" "${BINARY} -f ${BIOS} --if K0=D0 -d K0"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} --if K0=D1 -d K0"
+  RUN "${VPD_ERR_SYNTAX}" "${BINARY} -f ${BIOS} --if K0 -d K0"
 }
 
 main() {
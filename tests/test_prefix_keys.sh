@@ -0,0 +1,94 @@
+#!/bin/bash
+#
+# Copyright 2026 The ChromiumOS Authors
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+set -e
+
+. ./functions.sh
+
+# shellcheck disable=SC2154 # exported by caller
+BINARY="${OUT}/vpd"
+VPD_GET="${OUT}/vpd-get"
+TMP_DIR=$(mktemp -d)
+BIOS_PACKS=( vpd_0x600.tbz gVpdInfo.tbz )
+BIOS="${TMP_DIR}/empty.vpd"
+export VPD_SYSFS_DIR="${TMP_DIR}/sysfs"
+export VPD_CACHE_FILE="${TMP_DIR}/full-v2.txt"
+export VPD_BINARY_CACHE_FILE="${TMP_DIR}/full-v2.bin"
+export VPD_RUN_DIR="${TMP_DIR}/run"
+
+# Prints how many times the partition has the bytes of $1.
+count() {
+  grep -a -o "$1" "${BIOS}" | wc -l
+}
+
+test_image() {
+  local pack="$1"
+  local listed
+
+  echo "  testing '${pack}' ..."
+  unpack_bios "${pack}" "${TMP_DIR}"
+
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -O -s rlz_embargo_end_date=2026 \
+                   -s serial_number=SN1 -s serial_number_2=SN2 \
+                   -s rlz_embargo_start=x"
+  RUN 0 "count serial_number" "2"
+
+  # Keys stored in full come first, so -l lists the others after them.
+  listed="\"rlz_embargo_end_date\"=\"2026\""$'\n'"\"serial_number\"=\"SN1\""
+  listed+=$'\n'"\"region\"=\"us\""$'\n'"\"serial_number_2\"=\"SN2\""
+  listed+=$'\n'"\"rlz_embargo_start\"=\"x\""
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} --prefix-keys -s region=us"
+  RUN 0 "count serial_number" "2"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} --prefix-keys \
+                   -s serial_number_2=SN2 -s rlz_embargo_start=x"
+  RUN 0 "count serial_number" "1"
+  RUN 0 "count rlz_embargo" "1"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -l" "${listed}"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -g serial_number_2" "SN2"
+  RUN "${VPD_OK}" "${VPD_GET} -f ${BIOS} rlz_embargo_start" "x"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -k 'serial_*' -0 -l | tr '\\0' ," \
+      "serial_number=SN1,serial_number_2=SN2,"
+
+  # Later writes store new keys in full, and keep the others as they are,
+  # which may then point at the new keys.
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -s serial_number_3=SN3"
+  RUN 0 "count serial_number" "2"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -s serial_number_2=SN4 \
+                   -d serial_number"
+  RUN 0 "count serial_number" "1"
+  RUN 0 "count rlz_embargo" "1"
+  RUN "${VPD_OK}" "${VPD_GET} -f ${BIOS} serial_number_3" "SN3"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -g serial_number_2" "SN4"
+
+  # Found through the raw sysfs blob too.
+  mkdir -p "${VPD_SYSFS_DIR}/ro" "${VPD_RUN_DIR}"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} --write-cache ${VPD_SYSFS_DIR}/x.bin"
+  rm "${VPD_SYSFS_DIR}/x.bin"
+  RUN "${VPD_OK}" "${VPD_GET} serial_number_2 rlz_embargo_start" \
+      $'+serial_number_2=SN4\n+rlz_embargo_start=x'
+  RUN "${VPD_OK}" "${BINARY} --source auto -g serial_number_2" "SN4"
+  RUN "${VPD_OK}" "${BINARY} --source sysfs -l -k 'rlz_*'" \
+      $'"rlz_embargo_end_date"="2026"\n"rlz_embargo_start"="x"'
+  rm -rf "${VPD_SYSFS_DIR}"
+
+  # Stored in full again once the partition is written anew.
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -l --sh > ${TMP_DIR}/import.sh"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -O"
+  RUN 0 "sh ${TMP_DIR}/import.sh"
+  RUN 0 "count serial_number" "2"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -g serial_number_2" "SN4"
+}
+
+main() {
+  for pack in "${BIOS_PACKS[@]}"
+  do
+    test_image "${pack}"
+  done
+}
+
+main
+clean_up "${TMP_DIR}"
+
+exit 0
@@ -0,0 +1,90 @@
+#!/bin/bash
+#
+# Copyright 2026 The ChromiumOS Authors
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+set -e
+
+. ./functions.sh
+
+# shellcheck disable=SC2154 # exported by caller
+BINARY="${OUT}/vpd"
+TMP_DIR=$(mktemp -d)
+BIOS="${TMP_DIR}/empty.vpd"
+export VPD_SYSFS_DIR="${TMP_DIR}/sysfs"
+export VPD_CACHE_FILE="${TMP_DIR}/full-v2.txt"
+export VPD_BINARY_CACHE_FILE="${TMP_DIR}/full-v2.bin"
+export VPD_RUN_DIR="${TMP_DIR}/run"
+
+main() {
+  # The raw blobs in sysfs come from an image, next to the per-key files.
+  mkdir -p "${VPD_SYSFS_DIR}/ro" "${VPD_SYSFS_DIR}/rw" "${VPD_RUN_DIR}"
+  unpack_bios vpd_0x600.tbz "${TMP_DIR}"
+  for _ in $(seq 100); do printf 'ICC profile '; done >"${TMP_DIR}/profile"
+  base64 "${TMP_DIR}/profile" >"${TMP_DIR}/profile.b64"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -s serial_number=SN-sysfs \
+                   -s region=us -b icc=AP9B"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} \
+                   --binary-file profile=${TMP_DIR}/profile.b64"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -i RW_VPD -s block_devmode=1"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} --write-cache \
+                   ${VPD_SYSFS_DIR}/full-v2.bin"
+  rm "${VPD_SYSFS_DIR}/full-v2.bin"
+  printf 'SN-sysfs' >"${VPD_SYSFS_DIR}/ro/serial_number"
+  printf 'us' >"${VPD_SYSFS_DIR}/ro/region"
+  printf '1' >"${VPD_SYSFS_DIR}/rw/block_devmode"
+  cat >"${VPD_CACHE_FILE}" <<EOT
+"serial_number"="SN-cache"
+"___ro_rw_delimiter___"="___RW_VPD_below___"
+"block_devmode"="0"
+EOT
+
+  #
+  # Explicit sources.
+  RUN "${VPD_OK}" "${BINARY} --source sysfs -l -k serial_number,region,icc" \
+      $'"serial_number"="SN-sysfs"\n"region"="us"\n"icc"="AP9B"'
+  RUN "${VPD_OK}" "${BINARY} --source sysfs -g icc | od -An -tx1" " 00 ff 41"
+  RUN 0 "${BINARY} --source sysfs -g profile | cmp - ${TMP_DIR}/profile"
+  RUN "${GREP_FAIL}" "grep -c 'ICC profile ICC profile' \
+                      ${VPD_SYSFS_DIR}/ro_raw"
+  RUN "${VPD_OK}" "${BINARY} --source sysfs -i RW_VPD -g block_devmode" "1"
+  RUN "${VPD_OK}" "${BINARY} --source cache -l" '"serial_number"="SN-cache"'
+  RUN "${VPD_OK}" "${BINARY} --source cache -i RW_VPD -l" \
+      '"block_devmode"="0"'
+  RUN "${VPD_FAIL}" "${BINARY} --source sysfs --get-keys region,none" \
+      $'+region=us\n-none'
+  RUN "${VPD_FAIL}" "${BINARY} --source cache -g region"
+
+  #
+  # auto prefers sysfs, then the cache once the region has been written.
+  RUN "${VPD_OK}" "${BINARY} --source auto -g serial_number" "SN-sysfs"
+  RUN "${VPD_OK}" "${BINARY} --source auto -g icc | od -An -tx1" " 00 ff 41"
+  RUN 0 "${BINARY} --source auto -g profile | cmp - ${TMP_DIR}/profile"
+  # Without the raw blobs, sysfs may be missing keys.
+  mv "${VPD_SYSFS_DIR}/ro_raw" "${TMP_DIR}/ro_raw"
+  RUN "${VPD_OK}" "${BINARY} --source sysfs -l" \
+      $'"region"="us"\n"serial_number"="SN-sysfs"'
+  RUN "${VPD_OK}" "${BINARY} --source auto -g serial_number" "SN-cache"
+  mv "${TMP_DIR}/ro_raw" "${VPD_SYSFS_DIR}/ro_raw"
+  touch "${VPD_RUN_DIR}/RO_VPD.written"
+  touch -d '-1 minute' "${VPD_CACHE_FILE}"
+  RUN "${VPD_OK}" "${BINARY} --source auto -i RW_VPD -g block_devmode" "1"
+  touch "${VPD_CACHE_FILE}"
+  RUN "${VPD_OK}" "${BINARY} --source auto -g serial_number" "SN-cache"
+
+  #
+  # Errors.
+  echo "# RW_VPD execute error." >>"${VPD_CACHE_FILE}"
+  RUN "${VPD_ERR_INVALID}" "${BINARY} --source cache -i RW_VPD -l"
+  RUN "${VPD_OK}" "${BINARY} --source cache -l" '"serial_number"="SN-cache"'
+  rm -rf "${VPD_SYSFS_DIR}/rw" "${VPD_SYSFS_DIR}/rw_raw"
+  RUN "${VPD_ERR_NOT_FOUND}" "${BINARY} --source sysfs -i RW_VPD -l"
+  RUN "${VPD_ERR_SYNTAX}" "${BINARY} --source sysfs -s a=b"
+  RUN "${VPD_ERR_SYNTAX}" "${BINARY} --source sysfs -f ${TMP_DIR}/x -l"
+  RUN "${VPD_ERR_SYNTAX}" "${BINARY} --source nowhere -l"
+}
+
+main
+clean_up "${TMP_DIR}"
+
+exit 0
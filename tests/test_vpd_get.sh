@@ -0,0 +1,91 @@
+#!/bin/bash
+#
+# Copyright 2026 The ChromiumOS Authors
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+set -e
+
+. ./functions.sh
+
+# shellcheck disable=SC2154 # exported by caller
+BINARY="${OUT}/vpd"
+VPD_GET="${OUT}/vpd-get"
+TMP_DIR=$(mktemp -d)
+BIOS_PACKS=( vpd_0x600.tbz gVpdInfo.tbz )
+BIOS="${TMP_DIR}/empty.vpd"
+export VPD_SYSFS_DIR="${TMP_DIR}/sysfs"
+export VPD_BINARY_CACHE_FILE="${TMP_DIR}/full-v2.bin"
+export VPD_RUN_DIR="${TMP_DIR}/run"
+
+test_image() {
+  local pack="$1"
+
+  echo "  testing '${pack}' ..."
+  unpack_bios "${pack}" "${TMP_DIR}"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -O -s serial=SN1 -s region=us"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -i RW_VPD -O -s block_devmode=1"
+
+  RUN "${VPD_OK}" "${VPD_GET} -f ${BIOS} region" "us"
+  RUN "${VPD_OK}" "${VPD_GET} -f ${BIOS} block_devmode" "1"
+  RUN "${VPD_FAIL}" "${VPD_GET} -f ${BIOS} -i RW_VPD region" ""
+  RUN "${VPD_FAIL}" "${VPD_GET} -f ${BIOS} serial none block_devmode" \
+      $'+serial=SN1\n-none\n+block_devmode=1'
+  RUN "${VPD_OK}" "${VPD_GET} -f ${BIOS} -0 serial region | tr '\\0' ,"\
+      "+serial=SN1,+region=us,"
+}
+
+test_sources() {
+  # sysfs as the kernel makes it at boot: the raw blobs have every record,
+  # the per-key files only strings.
+  mkdir -p "${VPD_SYSFS_DIR}/ro" "${VPD_SYSFS_DIR}/rw" "${VPD_RUN_DIR}" \
+           "${TMP_DIR}/boot"
+  for _ in $(seq 100); do printf 'ICC profile '; done >"${TMP_DIR}/profile"
+  base64 "${TMP_DIR}/profile" >"${TMP_DIR}/profile.b64"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -d region -s serial=SN-sysfs \
+                   -b icc=AP9B --binary-file profile=${TMP_DIR}/profile.b64"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -i RW_VPD -s block_devmode=0"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} --write-cache \
+                   ${TMP_DIR}/boot/full-v2.bin"
+  cp "${TMP_DIR}/boot/ro_raw" "${TMP_DIR}/boot/rw_raw" "${VPD_SYSFS_DIR}"
+  RUN "${GREP_FAIL}" "grep -c 'ICC profile ICC profile' \
+                      ${VPD_SYSFS_DIR}/ro_raw"
+  printf 'SN-sysfs' >"${VPD_SYSFS_DIR}/ro/serial"
+  printf '0' >"${VPD_SYSFS_DIR}/rw/block_devmode"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -s serial=SN-cache -s region=us"
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} --write-cache \
+                   ${VPD_BINARY_CACHE_FILE}"
+
+  #
+  # sysfs first; the cache once a partition was written since boot.
+  RUN "${VPD_OK}" "${VPD_GET} serial block_devmode" \
+      $'+serial=SN-sysfs\n+block_devmode=0'
+  RUN "${VPD_OK}" "${VPD_GET} icc | od -An -tx1" " 00 ff 41"
+  RUN 0 "${VPD_GET} profile | cmp - ${TMP_DIR}/profile"
+  RUN "${VPD_FAIL}" "${VPD_GET} region"
+  # Without the raw blob, keys missing from sysfs may still be elsewhere.
+  rm "${VPD_SYSFS_DIR}/ro_raw"
+  RUN "${VPD_OK}" "${VPD_GET} serial region" $'+serial=SN-sysfs\n+region=us'
+  RUN "${VPD_OK}" "${VPD_GET} icc | od -An -tx1" " 00 ff 41"
+  touch -d '-1 minute' "${VPD_RUN_DIR}/RO_VPD.written"
+  RUN "${VPD_OK}" "${VPD_GET} serial region block_devmode" \
+      $'+serial=SN-cache\n+region=us\n+block_devmode=0'
+  RUN "${VPD_OK}" "${VPD_GET} -i RW_VPD block_devmode" "0"
+
+  #
+  # Errors.
+  RUN "${VPD_ERR_SYNTAX}" "${VPD_GET}"
+  RUN "${VPD_ERR_SYNTAX}" "${VPD_GET} ../ro/serial"
+  RUN "${VPD_ERR_SYNTAX}" "${VPD_GET} -i XX_VPD serial"
+}
+
+main() {
+  for pack in "${BIOS_PACKS[@]}"; do
+    test_image "${pack}"
+  done
+  test_sources
+}
+
+main
+clean_up "${TMP_DIR}"
+
+exit 0
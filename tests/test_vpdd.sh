@@ -0,0 +1,119 @@
+#!/bin/bash
+#
+# Copyright 2026 The ChromiumOS Authors
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+set -e
+
+. ./functions.sh
+
+# shellcheck disable=SC2154 # exported by caller
+BINARY="${OUT}/vpd_client"
+TMP_DIR=$(mktemp -d)
+BIOS="${TMP_DIR}/empty.vpd"
+export VPDD_SOCKET="${TMP_DIR}/vpdd.sock"
+# vpd, made to take a while to write while ${TMP_DIR}/slow exists.
+export PATH="${TMP_DIR}/bin:${OUT}:${PATH}"
+mkdir "${TMP_DIR}/bin"
+cat >"${TMP_DIR}/bin/vpd" <<EOF
+#!/bin/sh
+case " \$* " in
+  *" --batch "*) [ -e "${TMP_DIR}/slow" ] && sleep 2 ;;
+esac
+exec "${OUT}/vpd" "\$@"
+EOF
+chmod +x "${TMP_DIR}/bin/vpd"
+
+# Runs $1 until it prints $2, for up to 10 seconds.
+wait_for() {
+  for _ in $(seq 100); do
+    if [ "$(eval "$1" 2>/dev/null)" = "$2" ]; then
+      return 0
+    fi
+    sleep 0.1
+  done
+  return 1
+}
+
+start_vpdd() {
+  vpdd -f "${BIOS}" -S "${VPDD_SOCKET}" -w 100 -c true 2>/dev/null &
+  VPDD_PID=$!
+  # Do not leave the daemon behind if a test fails.
+  trap 'kill "${VPDD_PID}" 2>/dev/null || true' EXIT
+  while [ ! -S "${VPDD_SOCKET}" ]; do
+    sleep 0.1
+  done
+}
+
+main() {
+  unpack_bios vpd_0x600.tbz "${TMP_DIR}"
+  RUN "${VPD_OK}" "vpd -f ${BIOS} -i RW_VPD -s old=1 -b icc=AP9B"
+  start_vpdd
+
+  # Binary values are listed in base64, and read as they are.
+  RUN "${VPD_OK}" "${BINARY} -i RW_VPD -l" $'"icc"="AP9B"\n"old"="1"'
+  RUN "${VPD_OK}" "${BINARY} -i RW_VPD -g icc | od -An -tx1" " 00 ff 41"
+
+  #
+  # Concurrent writers are committed together and all see the result.
+  ${BINARY} -i RW_VPD -s a=1 &
+  ${BINARY} -i RW_VPD -s b="c d" &
+  ${BINARY} -i RW_VPD -d old &
+  wait %2 %3 %4
+  RUN "${VPD_OK}" "${BINARY} -i RW_VPD -g b" "c d"
+  RUN "${VPD_OK}" "vpd -f ${BIOS} -i RW_VPD -g a" "1"
+  RUN "${VPD_OK}" "vpd -f ${BIOS} -i RW_VPD -g b" "c d"
+  RUN "${VPD_FAIL}" "vpd -f ${BIOS} -i RW_VPD -g old"
+
+  #
+  # A write vpd rejects only fails its own writer.
+  local bad good rc
+  ${BINARY} -i RO_VPD -s serial_number=-bad 2>/dev/null &
+  bad=$!
+  ${BINARY} -i RW_VPD -s c=3 &
+  good=$!
+  wait "${bad}" && rc=$? || rc=$?
+  EXPECT_EQ "${rc}" "${VPD_ERR_PARAM}" "the rejected write"
+  wait "${good}" && rc=$? || rc=$?
+  EXPECT_EQ "${rc}" "${VPD_OK}" "the write batched with it"
+  RUN "${VPD_OK}" "vpd -f ${BIOS} -i RW_VPD -g c" "3"
+  RUN "${VPD_FAIL}" "${BINARY} -i RO_VPD -g serial_number"
+
+  #
+  # Reads are answered from memory while a commit writes the flash.
+  local slow
+  touch "${TMP_DIR}/slow"
+  ${BINARY} -i RW_VPD -s e=5 &
+  slow=$!
+  sleep 0.5
+  RUN "${VPD_OK}" "timeout 1 ${BINARY} -i RW_VPD -g a" "1"
+  RUN "${VPD_OK}" "timeout 1 ${BINARY} -i RW_VPD -g e" "5"
+  rm "${TMP_DIR}/slow"
+  wait "${slow}" && rc=$? || rc=$?
+  EXPECT_EQ "${rc}" "${VPD_OK}" "the slow write"
+  RUN "${VPD_OK}" "vpd -f ${BIOS} -i RW_VPD -g e" "5"
+
+  #
+  # Writes made without vpdd are picked up in the background.
+  RUN "${VPD_OK}" "vpd -f ${BIOS} -i RW_VPD -s direct=1"
+  RUN 0 "wait_for '${BINARY} -i RW_VPD -g direct' 1"
+
+  #
+  # Errors.
+  RUN "${VPD_ERR_PARAM}" "${BINARY} -i RW_VPD -s 'bad key=1'"
+  RUN "${VPD_ERR_PARAM}" "${BINARY} -i RW_VPD -s 'd=trailing '"
+  RUN "${VPD_FAIL}" "${BINARY} -i RW_VPD -g none"
+  RUN "${VPD_ERR_PARAM}" "${BINARY} -i RW_VPD -d none"
+  RUN "${VPD_ERR_SYNTAX}" "${BINARY} -i XX -l"
+
+  #
+  # Without the daemon, vpd_client falls back to vpd.
+  kill "${VPDD_PID}"
+  wait "${VPDD_PID}" || true
+  RUN "${VPD_OK}" "${BINARY} -f ${BIOS} -i RW_VPD -g a" "1"
+}
+
+main
+clean_up "${TMP_DIR}"
+
+exit 0
@@ -4,13 +4,13 @@
  * found in the LICENSE file.
  */
 
+#include <map>
 #include <optional>
 #include <string>
+#include <vector>
 
-#include <assert.h>
 #include <ctype.h>
 #include <errno.h>
-#include <fmap.h>
 #include <getopt.h>
 #include <inttypes.h>
 #include <stdbool.h>
@@ -18,26 +18,20 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/stat.h>
-#include <sys/types.h>
-#include <unistd.h>
-#include <uuid/uuid.h>
-
-#include <base/files/file_util.h>
-#include <base/logging.h>
 
 extern "C" {
-#include "lib/flashrom.h"
-#include "lib/lib_smbios.h"
+#include "lib/base64.h"
 #include "lib/lib_vpd.h"
-#include "lib/vpd.h"
-#include "lib/vpd_tables.h"
+#include "lib/vpd_cache.h"
+#include "lib/vpd_lock.h"
 };
 
+#include "libvpd/vpd_region.h"
+
 namespace {
 
-/* The buffer length. Right now the VPD partition size on flash is 128KB. */
-#define BUF_LEN (128 * 1024)
+using libvpd::ReadSource;
+using libvpd::VpdRegion;
 
 /* The comment shown in the begin of --sh output */
 #define SH_COMMENT                                                     \
@@ -47,195 +41,40 @@ namespace {
   "# Or an empty line followed by other commands.\n"                   \
   "#\n"
 
-/* Linked list to track temporary files
- */
-struct TempfileNode {
-  char* filename;
-  struct TempfileNode* next;
-}* tempfile_list = NULL;
-
-enum FileFlag {
-  HAS_SPD = (1 << 0),
-  HAS_VPD_2_0 = (1 << 1),
-  HAS_VPD_1_2 = (1 << 2),
-  /* TODO(yjlou): refine those variables in main() to here:
-   *              write_back_to_flash, overwrite_it, modified. */
-};
-/* Bitmask of FileFlag. */
-int file_flag = 0;
-
-/* 2 containers:
- *   file:      stores decoded pairs from file.
- *   argument:  stores parsed pairs from command arguments.
- */
-struct PairContainer file;
+/* Containers of parsed pairs from command arguments. */
 struct PairContainer set_argument;
 struct PairContainer del_argument;
 
-/* The current padding length value.
- * Default: VPD_AS_LONG_AS
- */
-int pad_value_len = VPD_AS_LONG_AS;
-
-/* The output buffer */
-uint8_t buf[BUF_LEN];
-int buf_len = 0;
-int max_buf_len = sizeof(buf);
+/* Conditions from --if and --if-absent, checked before any change. */
+struct PairContainer cond_present;
+struct PairContainer cond_absent;
 
-/* The EPS base address used to fill the EPS table entry.
- * If the VPD partition can be found in fmap, this points to the starting
- * offset of VPD partition. If not found, this is used to be the base address
- * to increase SPD and VPD 2.0 offset fields.
- */
-#define UNKNOWN_EPS_BASE ((uint32_t)-1)
-uint32_t eps_base = UNKNOWN_EPS_BASE;
+/* Keys to be listed by -l (empty means all keys), or fetched by -g. */
+struct VpdKeyFilter key_filter;
 
-/* If found_vpd, replace the VPD partition when saveFile().
- * If not found, always create new file when saveFlie(). */
-bool found_vpd = false;
+/* How EPS checksums are verified on load, from --checksum. */
+enum libvpd::ChecksumMode checksum_mode = libvpd::CHECKSUM_WARN;
 
-/* The VPD partition offset and size in buf[]. The whole partition includes:
- *
- *   SMBIOS EPS
- *   SMBIOS tables[]
- *   SPD
- *   VPD 2.0 data
- *
- */
-uint32_t vpd_offset = 0, vpd_size; /* The whole partition */
-/* Below offset are related to vpd_offset and assume positive.
- * Those are used in saveFile() to write back data. */
-uint32_t eps_offset = 0; /* EPS's starting address. Tables[] is following. */
-uint32_t spd_offset = GOOGLE_SPD_OFFSET;      /* SPD address .*/
-off_t vpd_2_0_offset = GOOGLE_VPD_2_0_OFFSET; /* VPD 2.0 data address. */
-
-/* This points to the SPD data if it is availiable when loadFile().
- * The memory is allocated in loadFile(), will be used in saveFile(),
- * and freed at end of main(). */
-uint8_t* spd_data = NULL;
-int32_t spd_len = 256; /* max value for DDR3 */
-
-/* Creates a temporary file and return the filename, or NULL for any failure.
- */
-const char* myMkTemp() {
-  char tmp_file[] = "/tmp/vpd.flashrom.XXXXXX";
-
-  int fd = mkstemp(tmp_file);
-  if (fd < 0) {
-    fprintf(stderr, "mkstemp(%s) failed\n", tmp_file);
-    return NULL;
-  }
+/* The entry point to write from --eps, or 0 to keep the one loaded. */
+int eps_major_ver = 0;
 
-  close(fd);
-  struct TempfileNode* node = reinterpret_cast<struct TempfileNode*>(
-      malloc(sizeof(struct TempfileNode)));
-  assert(node);
-  node->next = tempfile_list;
-  node->filename = strdup(tmp_file);
-  assert(node->filename);
-  tempfile_list = node;
+/* Binary values this long or longer are compressed, from --compress-min. */
+int compress_min = VPD_COMPRESS_MIN_LEN;
 
-  return node->filename;
-}
+/* Whether to write the keys set by this run as VPD_TYPE_PREFIX_STRING records
+ * where they share a prefix, from --prefix-keys. */
+bool prefix_keys = false;
 
-/*  Erases all files created by myMkTemp
- */
-void cleanTempFiles() {
-  while (tempfile_list) {
-    struct TempfileNode* node = tempfile_list;
-    tempfile_list = node->next;
-    if (unlink(node->filename) < 0) {
-      fprintf(stderr, "warning: failed removing temporary file: %s\n",
-              node->filename);
-    }
-    free(node->filename);
-    free(node);
-  }
-}
+/* If set, exit with VPD_UNCHANGED when all writes turned out to be no-ops. */
+bool report_unchanged = false;
+/* Number of regions actually written, and skipped as identical. */
+int regions_written = 0;
+int regions_unchanged = 0;
 
-/*  Given the offset of blob block (related to the first byte of EPS) and
- *  the size of blob, the is function generates an SMBIOS ESP.
+/* The current padding length value.
+ * Default: VPD_AS_LONG_AS
  */
-vpd_err_t buildEpsAndTables(const int size_blob,
-                            const int max_buf_len,
-                            unsigned char* buf,
-                            int* generated) {
-  struct vpd_entry* eps;
-  unsigned char* table = NULL; /* the structure table */
-  int table_len = 0;
-  int num_structures = 0;
-  vpd_err_t retval = VPD_OK;
-
-  assert(buf);
-  assert(generated);
-  assert(eps_base != UNKNOWN_EPS_BASE);
-
-  buf += *generated;
-
-  /* Generate type 241 - SPD data */
-  table_len = vpd_append_type241(
-      0, &table, table_len, GOOGLE_SPD_UUID, eps_base + GOOGLE_SPD_OFFSET,
-      spd_len, /* Max length for DDR3 */
-      GOOGLE_SPD_VENDOR, GOOGLE_SPD_DESCRIPTION, GOOGLE_SPD_VARIANT);
-  if (table_len < 0) {
-    retval = VPD_FAIL;
-    goto error_1;
-  }
-  num_structures++;
-
-  /*
-   * TODO(hungte) Once most systems have been updated to support VPD_INFO
-   * record, we can remove the +sizeof(google_vpd_info) hack.
-   */
-
-  /* Generate type 241 - VPD 2.0 */
-  table_len = vpd_append_type241(
-      1, &table, table_len, GOOGLE_VPD_2_0_UUID,
-      (eps_base + GOOGLE_VPD_2_0_OFFSET + sizeof(struct google_vpd_info)),
-      size_blob, GOOGLE_VPD_2_0_VENDOR, GOOGLE_VPD_2_0_DESCRIPTION,
-      GOOGLE_VPD_2_0_VARIANT);
-  if (table_len < 0) {
-    retval = VPD_FAIL;
-    goto error_1;
-  }
-  num_structures++;
-
-  /* Generate type 127 */
-  table_len = vpd_append_type127(2, &table, table_len);
-  if (table_len < 0) {
-    retval = VPD_FAIL;
-    goto error_1;
-  }
-  num_structures++;
-
-  /* Generate EPS */
-  eps = vpd_create_eps(table_len, num_structures, eps_base);
-  if ((*generated + eps->entry_length) > max_buf_len) {
-    retval = VPD_FAIL;
-    goto error_2;
-  }
-
-  /* Copy EPS back to buf */
-  memcpy(buf, eps, eps->entry_length);
-  buf += eps->entry_length;
-  *generated += eps->entry_length;
-
-  /* Copy tables back to buf */
-  if ((*generated + table_len) > max_buf_len) {
-    retval = VPD_FAIL;
-    goto error_2;
-  }
-  memcpy(buf, table, table_len);
-  buf += table_len;
-  *generated += table_len;
-
-error_2:
-  free(eps);
-error_1:
-  free(table);
-
-  return retval;
-}
+int pad_value_len = VPD_AS_LONG_AS;
 
 int isbase64(uint8_t c) {
   return isalnum(c) || (c == '+') || (c == '/') || (c == '=');
@@ -245,9 +84,10 @@ std::optional<std::vector<uint8_t>> read_string_from_file(
     const char* file_name) {
   uint32_t i, j;
 
-  auto file_buffer = base::ReadFileToBytes(base::FilePath(file_name));
+  auto file_buffer = libvpd::readFileToBytes(file_name);
   if (!file_buffer) {
-    PLOG(ERROR) << "Failed to read file: " << file_name;
+    fprintf(stderr, "[ERROR] Failed to read file: %s: %s\n", file_name,
+            strerror(errno));
     return {};
   }
 
@@ -339,9 +179,11 @@ vpd_err_t checkKeyValuePair(const uint8_t* key, const uint8_t* value) {
 /*
  * Given a key=value string, this function parses it and adds to arugument
  * pair container. The 'value' can be stored in a base64 format file, in this
- * case the value field is the file name.
+ * case the value field is the file name. If binary is set, the value is
+ * base64 and its decoded bytes are added as a binary value.
  */
-vpd_err_t parseString(const uint8_t* string, bool read_from_file) {
+vpd_err_t parseString(const uint8_t* string, bool read_from_file,
+                      bool binary) {
   uint8_t* value;
   std::optional<std::vector<uint8_t>> file_contents;
   vpd_err_t retval = VPD_OK;
@@ -375,6 +217,25 @@ vpd_err_t parseString(const uint8_t* string, bool read_from_file) {
     }
   }
 
+  if (binary) {
+    size_t len = strlen(reinterpret_cast<const char*>(value));
+    std::vector<uint8_t> bytes(len / 4 * 3 + 3);
+    size_t bytes_len;
+
+    retval = checkKeyName(key);
+    if (retval == VPD_OK &&
+        VPD_OK != base64Decode(reinterpret_cast<const char*>(value), len,
+                               bytes.data(), &bytes_len)) {
+      fprintf(stderr, "[ERROR] The value of %s is not in base64 format.\n",
+              key);
+      retval = VPD_ERR_SYNTAX;
+    }
+    if (retval == VPD_OK)
+      setBinary(&set_argument, key, bytes.data(), bytes_len);
+    free(key);
+    return retval;
+  }
+
   retval = checkKeyValuePair(key, value);
   if (retval == VPD_OK)
     setString(&set_argument, key, value, pad_value_len);
@@ -384,462 +245,244 @@ vpd_err_t parseString(const uint8_t* string, bool read_from_file) {
   return retval;
 }
 
-/* Given an address, compare if it is SMBIOS signature ("_SM_"). */
-int isEps(const void* ptr) {
-  return !memcmp(VPD_ENTRY_MAGIC, ptr, sizeof(VPD_ENTRY_MAGIC) - 1);
-  /* TODO(yjlou): need more EPS validity checks here. */
-}
-
-/* There are two possible file content appearng here:
- *   1. a full and complete BIOS file
- *   2. a full but only VPD partition area is valid. (no fmap)
- *   3. a full BIOS, but VPD partition is blank.
- *
- * The first case is easy. Just lookup the fmap and find out the VPD partition.
- * The second is harder. We try to search the SMBIOS signature (since others
- * are blank). For the third, we just return and leave caller to read full
- * content, including fmap info.
- *
- * If found, vpd_offset and vpd_size are updated.
- */
-vpd_err_t findVpdPartition(const std::vector<uint8_t>& read_buf,
-                           const std::string& region_name,
-                           uint32_t* vpd_offset,
-                           uint32_t* vpd_size) {
-  assert(vpd_offset);
-  assert(vpd_size);
-
-  /* scan the file and find out the VPD partition. */
-  const off_t sig_offset = fmap_find(read_buf.data(), read_buf.size());
-  if (sig_offset < 0) {
-    return VPD_ERR_NOT_FOUND;
+/* Merges the pairs of set_argument into container, to be prefix-coded if
+ * --prefix-keys was given. Keys set without it keep their encoding. */
+void mergeSetArgument(struct PairContainer* container) {
+  if (prefix_keys) {
+    for (struct StringPair* pair = set_argument.first; pair; pair = pair->next)
+      pair->prefix_key = 1;
   }
-
-  const struct fmap* fmap;
-  if (sig_offset + sizeof(*fmap) > read_buf.size()) {
-    LOG(ERROR) << "Bad FMAP at: " << sig_offset;
-    return VPD_FAIL;
-  }
-  /* FMAP signature is found, try to search the partition name in table. */
-  fmap = (const struct fmap*)(read_buf.data() + sig_offset);
-
-  const struct fmap_area* area = fmap_find_area(fmap, region_name.c_str());
-  if (!area) {
-    LOG(ERROR) << "The VPD partition [" << region_name << "] is not found.";
-    return VPD_ERR_NOT_FOUND;
-  }
-  *vpd_offset = area->offset;
-  *vpd_size = area->size;
-  /* Mark found here then saveFile() knows where to write back (vpd_offset,
-   * vpd_size). */
-  found_vpd = true;
-  return VPD_OK;
+  mergeContainer(container, &set_argument);
 }
 
-vpd_err_t getVpdPartitionFromFullBios(const std::string& region_name,
-                                      uint32_t* offset,
-                                      uint32_t* size) {
-  const char* filename = myMkTemp();
-  if (!filename) {
-    return VPD_ERR_SYSTEM;
+/* Commits region, counting it as written or unchanged. */
+vpd_err_t commitAndCount(struct VpdRegion* region) {
+  vpd_err_t retval = libvpd::commitRegion(region);
+  if (VPD_UNCHANGED == retval) {
+    regions_unchanged++;
+    return VPD_OK;
   }
+  if (VPD_OK == retval)
+    regions_written++;
+  return retval;
+}
 
-  if (FLASHROM_OK != flashromFullRead(filename)) {
-    fprintf(stderr, "[WARN] Cannot read full BIOS.\n");
-    return VPD_ERR_ROM_READ;
-  }
-  auto buf = base::ReadFileToBytes(base::FilePath(filename));
-  assert(buf);
-  if (findVpdPartition(*buf, region_name, offset, size)) {
-    fprintf(stderr, "[WARN] Cannot get eps_base from full BIOS.\n");
-    return VPD_ERR_INVALID;
+/* Commits all modified regions. */
+vpd_err_t commitRegions(std::map<std::string, VpdRegion>* regions) {
+  for (auto& it : *regions) {
+    if (!it.second.modified)
+      continue;
+    vpd_err_t retval = commitAndCount(&it.second);
+    if (VPD_OK != retval)
+      return retval;
   }
   return VPD_OK;
 }
 
-/* Below 2 functions are the helper functions for extract data from VPD 1.x
- * binary-encoded structure.
- * Note that the returning pointer is a static buffer. Thus the later call will
- * destroy the former call's result.
+/* Writes RO_VPD and RW_VPD of filename (or the flash) to the binary cache at
+ * path, one generation after the cache it replaces, and their raw pairs next
+ * to it (see writeRawSnapshot()).
  */
-uint8_t* extractString(const uint8_t* value, const int max_len) {
-  static uint8_t buf[128];
+vpd_err_t writeBinaryCache(const char* filename, const char* path) {
+  VpdRegion ro, rw;
+  uint64_t generation = 1;
+  vpd_err_t retval;
+
+  ro.name = "RO_VPD";
+  rw.name = "RW_VPD";
+  ro.checksum_mode = checksum_mode;
+  rw.checksum_mode = checksum_mode;
+  retval = libvpd::openRegion(&ro, filename, false, false);
+  if (VPD_OK == retval)
+    retval = libvpd::openRegion(&rw, filename, false, false);
+  if (VPD_OK != retval)
+    return retval;
 
-  /* not longer than the buffer size */
-  const int copy_len = (max_len > sizeof(buf) - 1) ? sizeof(buf) - 1 : max_len;
-  memcpy(buf, value, copy_len);
-  buf[copy_len] = '\0';
+  if (VPD_OK == readVpdCacheGeneration(path, &generation))
+    generation++;
 
-  return buf;
+  retval = writeVpdCache(path, generation, &ro.file, &rw.file);
+  if (VPD_OK == retval)
+    retval = libvpd::writeRawSnapshot(path, ro.name, ro.raw_pairs);
+  if (VPD_OK == retval)
+    retval = libvpd::writeRawSnapshot(path, rw.name, rw.raw_pairs);
+  if (VPD_OK != retval)
+    fprintf(stderr, "[ERROR] Cannot write the cache %s: %d\n", path, retval);
+  return retval;
 }
 
-uint8_t* extractHex(const uint8_t* value, const int len) {
-  char tmp[4]; /* for a hex string */
-  static uint8_t buf[128];
-  int in, out; /* in points to value[], while out points to buf[]. */
+/* Adds "key=value" to the --if conditions. */
+vpd_err_t addCondition(const char* arg) {
+  const char* eq = strchr(arg, '=');
 
-  for (in = 0, out = 0;; ++in) {
-    if (out + 3 > sizeof(buf) - 1) {
-      goto end_of_func; /* no more buffer */
-    }
-    if (in >= len) { /* no more input */
-      if (out)
-        --out; /* remove the tailing colon */
-      goto end_of_func;
-    }
-    snprintf(tmp, sizeof(tmp), "%02x:", value[in]);
-    memcpy(&buf[out], tmp, strnlen(tmp, sizeof(tmp)));
-    out += strlen(tmp);
+  if (!eq || eq == arg) {
+    fprintf(stderr, "The condition [%s] is not key=value.\n", arg);
+    return VPD_ERR_SYNTAX;
   }
-
-end_of_func:
-  buf[out] = '\0';
-
-  return buf;
+  std::string key(arg, eq - arg);
+  setString(&cond_present, reinterpret_cast<const uint8_t*>(key.c_str()),
+            reinterpret_cast<const uint8_t*>(eq + 1), 0);
+  return VPD_OK;
 }
 
-vpd_err_t loadRawFile(const char* filename, struct PairContainer* container) {
-  uint32_t index;
-
-  auto vpd_buf = base::ReadFileToBytes(base::FilePath(filename));
-  if (!vpd_buf) {
-    fprintf(stderr, "[ERROR] Cannot LoadRawFile('%s').\n", filename);
-    return VPD_ERR_SYSTEM;
-  }
-
-  for (index = 0; index < vpd_buf->size() &&
-                  (*vpd_buf)[index] != VPD_TYPE_TERMINATOR &&
-                  (*vpd_buf)[index] != VPD_TYPE_IMPLICIT_TERMINATOR;) {
-    vpd_err_t retval =
-        decodeToContainer(container, vpd_buf->size(), vpd_buf->data(), &index);
-    if (VPD_OK != retval) {
-      fprintf(stderr, "decodeToContainer() error.\n");
-      return retval;
-    }
-  }
-  file_flag |= HAS_VPD_2_0;
-
-  return VPD_OK;
+/* Returns VPD_ERR_CONDITION if the conditions do not hold for container, and
+ * clears them.
+ */
+vpd_err_t checkConditions(struct PairContainer* container) {
+  const uint8_t* failed_key = NULL;
+  vpd_err_t retval =
+      checkContainer(container, &cond_present, &cond_absent, &failed_key);
+
+  if (VPD_OK != retval)
+    fprintf(stderr, "[ERROR] The condition on '%s' does not hold.\n",
+            failed_key);
+  destroyContainer(&cond_present);
+  destroyContainer(&cond_absent);
+  initContainer(&cond_present);
+  initContainer(&cond_absent);
+  return retval;
 }
 
-vpd_err_t loadFile(const std::string& region_name,
+/* Runs the operations read from input against the regions in filename (or
+ * flash if NULL). Each region is loaded once, on first use, and all changes
+ * are written back once per region, at "commit" or at end of input.
+ *
+ * The input has one operation per line:
+ *
+ *   region <RO_VPD|RW_VPD>  Select the region for the following operations.
+ *   pad <length>            Same as -p.
+ *   set <key=value>         Same as -s.
+ *   binary <key=value>      Same as -b.
+ *   delete <key>            Same as -d.
+ *   if <key=value>          Fail unless key currently has value.
+ *   if-absent <key>         Fail if key currently exists.
+ *   get <key>               Print +key=value, or -key if missing.
+ *   list                    Same as -l.
+ *   commit                  Write back all changes made so far.
+ *
+ * Empty lines and lines starting with '#' are ignored. If any operation fails,
+ * the changes since the last commit are dropped.
+ */
+vpd_err_t runBatch(FILE* input,
                    const char* filename,
-                   struct PairContainer* container,
-                   bool overwrite_it) {
-  struct vpd_entry* eps;
-  uint32_t related_eps_base;
-  struct vpd_header* header;
-  struct vpd_table_binary_blob_pointer* data;
-  uint8_t spd_uuid[16], vpd_2_0_uuid[16], vpd_1_2_uuid[16];
-  int expected_handle;
-  int table_len;
-  uint32_t index;
+                   const std::string& default_region) {
+  std::map<std::string, VpdRegion> regions;
+  std::string region_name = default_region;
   vpd_err_t retval = VPD_OK;
-
-  auto read_buf = base::ReadFileToBytes(base::FilePath(filename));
-  if (!read_buf) {
-    fprintf(stderr, "[WARN] Cannot LoadFile('%s'), that's fine.\n", filename);
-    return VPD_OK;
-  }
-
-  if (0 == findVpdPartition(*read_buf, region_name, &vpd_offset, &vpd_size)) {
-    eps_base = vpd_offset;
-  } else {
-    /* We cannot parse out the VPD partition address from given file.
-     * Then, try to read the whole BIOS chip. */
-    uint32_t offset, size;
-    retval = getVpdPartitionFromFullBios(region_name, &offset, &size);
-    if (VPD_OK == retval) {
-      eps_base = offset;
-      vpd_size = size;
-    } else {
-      if (overwrite_it) {
-        return VPD_OK;
+  char* line = NULL;
+  size_t line_size = 0;
+  ssize_t len;
+  int line_no = 0;
+
+  while ((len = getline(&line, &line_size, input)) >= 0) {
+    line_no++;
+    while (len > 0 && isspace(static_cast<unsigned char>(line[len - 1])))
+      line[--len] = '\0';
+    char* op = line;
+    while (isspace(static_cast<unsigned char>(*op)))
+      op++;
+    if (!*op || *op == '#')
+      continue;
+
+    char* arg = op;
+    while (*arg && !isspace(static_cast<unsigned char>(*arg)))
+      arg++;
+    if (*arg)
+      *arg++ = '\0';
+    while (isspace(static_cast<unsigned char>(*arg)))
+      arg++;
+
+    const std::string command(op);
+    if (command == "commit") {
+      retval = commitRegions(&regions);
+    } else if (command == "region") {
+      if (strcmp(arg, "RO_VPD") && strcmp(arg, "RW_VPD")) {
+        fprintf(stderr, "Invalid VPD partition name: %s\n", arg);
+        retval = VPD_ERR_SYNTAX;
       } else {
-        fprintf(stderr, "[ERROR] getVpdPartitionFromFullBios() failed.");
-        return retval;
+        region_name = arg;
       }
-    }
-  }
-
-  /* Update the following variables:
-   *   eps_base: integer, the VPD EPS address in ROM.
-   *   vpd_offset: integer, the VPD partition offset in file (read_buf[]).
-   *   vpd_buf: uint8_t*, points to the VPD partition.
-   *   eps: vpd_entry*, points to the EPS structure.
-   *   eps_offset: integer, the offset of EPS related to vpd_buf[].
-   */
-  const uint8_t* vpd_buf = read_buf->data() + vpd_offset;
-  /* eps and eps_offset will be set slightly later. */
-
-  if (eps_base == UNKNOWN_EPS_BASE) {
-    fprintf(stderr,
-            "[ERROR] Cannot determine eps_base. Cannot go on.\n"
-            "        Ensure you have a valid FMAP.\n");
-    return VPD_ERR_INVALID;
-  }
-
-  /* In overwrite mode, we don't care the content inside. Stop parsing. */
-  if (overwrite_it) {
-    return VPD_OK;
-  }
-
-  if (vpd_size < sizeof(struct vpd_entry)) {
-    fprintf(stderr, "[ERROR] vpd_size:%d is too small to be compared.\n",
-            vpd_size);
-    return VPD_ERR_INVALID;
-  }
-  /* try to search the EPS if it is not aligned to the begin of partition. */
-  for (index = 0; index < vpd_size; index += 16) {
-    if (isEps(&vpd_buf[index])) {
-      eps = (struct vpd_entry*)&vpd_buf[index];
-      eps_offset = index;
-      break;
-    }
-  }
-  /* jump if the VPD partition is not recognized. */
-  if (index >= vpd_size) {
-    /* But OKAY if the VPD partition starts with FF, which might be un-used. */
-    if (!memcmp("\xff\xff\xff\xff", vpd_buf, sizeof(VPD_ENTRY_MAGIC) - 1)) {
-      fprintf(stderr, "[WARN] VPD partition not formatted. It's fine.\n");
-      return VPD_OK;
-    } else {
-      fprintf(stderr, "SMBIOS signature is not matched.\n");
-      fprintf(stderr, "You may use -O to overwrite the data.\n");
-      return VPD_ERR_INVALID;
-    }
-  }
-
-  /* adjust the eps_base for data->offset field below. */
-  related_eps_base = eps->table_address - sizeof(*eps);
-
-  /* EPS is done above. Parse structure tables below. */
-  /* Get the first type 241 blob, at the tail of EPS. */
-  header = reinterpret_cast<struct vpd_header*>(
-      reinterpret_cast<uint8_t*>(eps) + eps->entry_length);
-  data = reinterpret_cast<struct vpd_table_binary_blob_pointer*>(
-      reinterpret_cast<uint8_t*>(header) + sizeof(*header));
-
-  /* prepare data structure to compare */
-  uuid_parse(GOOGLE_SPD_UUID, spd_uuid);
-  uuid_parse(GOOGLE_VPD_2_0_UUID, vpd_2_0_uuid);
-  uuid_parse(GOOGLE_VPD_1_2_UUID, vpd_1_2_uuid);
-
-  /* Iterate all tables */
-  for (expected_handle = 0; header->type != VPD_TYPE_END; ++expected_handle) {
-    /* make sure we haven't have too much handle already. */
-    if (expected_handle > 65535) {
-      fprintf(stderr, "[ERROR] too many handles. Terminate parsing.\n");
-      return VPD_ERR_INVALID;
-    }
-
-    /* check type */
-    if (header->type != VPD_TYPE_BINARY_BLOB_POINTER) {
-      fprintf(stderr,
-              "[ERROR] We now only support Binary Blob Pointer (241). "
-              "But the %dth handle is type %d. Terminate parsing.\n",
-              header->handle, header->type);
-      return VPD_ERR_INVALID;
-    }
-
-    /* make sure handle is increasing as expected */
-    if (header->handle != expected_handle) {
-      fprintf(stderr,
-              "[ERROR] The handle value must be %d, but is %d.\n"
-              "        Use -O option to re-format.\n",
-              expected_handle, header->handle);
-      return VPD_ERR_INVALID;
-    }
-
-    /* point to the table 241 data part */
-    index = data->offset - related_eps_base;
-    if (index >= read_buf->size()) {
-      fprintf(stderr,
-              "[ERROR] the table offset looks suspicious. "
-              "index=0x%x, data->offset=0x%x, related_eps_base=0x%x\n",
-              index, data->offset, related_eps_base);
-      return VPD_ERR_INVALID;
-    }
-
-    /*
-     * The main switch case
-     */
-    if (!memcmp(data->uuid, spd_uuid, sizeof(data->uuid))) {
-      /* SPD */
-      spd_offset = index;
-      spd_len = data->size;
-      if (vpd_offset + spd_offset + spd_len >= read_buf->size()) {
-        fprintf(stderr,
-                "[ERROR] SPD offset in BBP is not correct.\n"
-                "        vpd=0x%x spd=0x%x len=0x%x file_size=0x%zx\n"
-                "        If this file is VPD partition only, try to\n"
-                "        use -E to adjust offset values.\n",
-                (uint32_t)vpd_offset, (uint32_t)spd_offset, spd_len,
-                read_buf->size());
-        return VPD_ERR_INVALID;
+    } else if (command == "pad") {
+      char* end;
+      pad_value_len = strtol(arg, &end, 0);
+      if (!*arg || *end) {
+        fprintf(stderr, "Not a number for pad length: %s\n", arg);
+        retval = VPD_ERR_SYNTAX;
       }
-
-      if (!(spd_data = reinterpret_cast<uint8_t*>(malloc(spd_len)))) {
-        fprintf(stderr, "spd_data: malloc(%d bytes) failed.\n", spd_len);
-        return VPD_ERR_SYSTEM;
+    } else if (command == "set" || command == "binary" ||
+               command == "delete" || command == "get" ||
+               command == "list" || command == "if" ||
+               command == "if-absent") {
+      VpdRegion* region = &regions[region_name];
+      if (!region->load_file) {
+        region->name = region_name;
+        region->checksum_mode = checksum_mode;
+        region->compress_min = compress_min;
+        retval = libvpd::openRegion(region, filename, false, false);
       }
-      memcpy(spd_data, read_buf->data() + vpd_offset + spd_offset, spd_len);
-      file_flag |= HAS_SPD;
-
-    } else if (!memcmp(data->uuid, vpd_2_0_uuid, sizeof(data->uuid))) {
-      /* VPD 2.0 */
-      /* iterate all pairs */
-      for (; vpd_buf[index] != VPD_TYPE_TERMINATOR &&
-             vpd_buf[index] != VPD_TYPE_IMPLICIT_TERMINATOR;) {
-        retval = decodeToContainer(container, vpd_size, vpd_buf, &index);
-        if (VPD_OK != retval) {
-          fprintf(stderr, "decodeToContainer() error.\n");
-          return retval;
+      if (VPD_OK != retval) {
+        /* fall through to the error handling below. */
+      } else if (command == "if" || command == "if-absent") {
+        if (command == "if")
+          retval = addCondition(arg);
+        else
+          setString(&cond_absent, reinterpret_cast<const uint8_t*>(arg),
+                    reinterpret_cast<const uint8_t*>(""), 0);
+        if (VPD_OK == retval)
+          retval = checkConditions(&region->file);
+      } else if (command == "set" || command == "binary") {
+        retval = parseString(reinterpret_cast<const uint8_t*>(arg), false,
+                             command == "binary");
+        mergeSetArgument(&region->file);
+        destroyContainer(&set_argument);
+        initContainer(&set_argument);
+        if (VPD_OK == retval)
+          region->modified++;
+        else
+          fprintf(stderr, "The string [%s] cannot be parsed.\n", arg);
+      } else if (command == "delete") {
+        if (VPD_OK != deleteKey(&region->file,
+                                reinterpret_cast<const uint8_t*>(arg))) {
+          fprintf(stderr, "[ERROR] The key to delete does not exist: %s\n",
+                  arg);
+          retval = VPD_ERR_PARAM;
+        } else {
+          region->modified++;
+        }
+      } else {
+        /* Reserve larger size because the exporting generates longer string
+         * than the encoded data. */
+        static uint8_t dump_buf[BUF_LEN * 5 + 64];
+        int dump_len = 0;
+
+        if (command == "get") {
+          const uint8_t* key = reinterpret_cast<const uint8_t*>(arg);
+          retval = exportLookupResult(VPD_EXPORT_KEY_VALUE, key,
+                                      findString(&region->file, key, NULL),
+                                      sizeof(dump_buf), dump_buf, &dump_len);
+        } else {
+          setContainerFilter(&region->file, NULL);
+          retval = exportContainer(VPD_EXPORT_KEY_VALUE, &region->file,
+                                   sizeof(dump_buf), dump_buf, &dump_len);
         }
+        fwrite(dump_buf, dump_len, 1, stdout);
       }
-      file_flag |= HAS_VPD_2_0;
-
-    } else if (!memcmp(data->uuid, vpd_1_2_uuid, sizeof(data->uuid))) {
-      /* VPD 1_2: please refer to "Google VPD Type 241 Format v1.2" */
-      const struct V12 {
-        uint8_t prod_sn[0x20];
-        uint8_t sku[0x10];
-        uint8_t uuid[0x10];
-        uint8_t mb_sn[0x10];
-        uint8_t imei[0x10];
-        uint8_t ssd_sn[0x10];
-        uint8_t mem_sn[0x10];
-        uint8_t wlan_mac[0x06];
-      }* v12 = reinterpret_cast<const struct V12*>(&vpd_buf[index]);
-      setString(container, reinterpret_cast<const uint8_t*>("Product_SN"),
-                extractString(v12->prod_sn, sizeof(v12->prod_sn)),
-                VPD_AS_LONG_AS);
-      setString(container, reinterpret_cast<const uint8_t*>("SKU"),
-                extractString(v12->sku, sizeof(v12->sku)), VPD_AS_LONG_AS);
-      setString(container, reinterpret_cast<const uint8_t*>("UUID"),
-                extractHex(v12->uuid, sizeof(v12->uuid)), VPD_AS_LONG_AS);
-      setString(container, reinterpret_cast<const uint8_t*>("MotherBoard_SN"),
-                extractString(v12->mb_sn, sizeof(v12->mb_sn)), VPD_AS_LONG_AS);
-      setString(container, reinterpret_cast<const uint8_t*>("IMEI"),
-                extractString(v12->imei, sizeof(v12->imei)), VPD_AS_LONG_AS);
-      setString(container, reinterpret_cast<const uint8_t*>("SSD_SN"),
-                extractString(v12->ssd_sn, sizeof(v12->ssd_sn)),
-                VPD_AS_LONG_AS);
-      setString(container, reinterpret_cast<const uint8_t*>("Memory_SN"),
-                extractString(v12->mem_sn, sizeof(v12->mem_sn)),
-                VPD_AS_LONG_AS);
-      setString(container, reinterpret_cast<const uint8_t*>("WLAN_MAC"),
-                extractHex(v12->wlan_mac, sizeof(v12->wlan_mac)),
-                VPD_AS_LONG_AS);
-      file_flag |= HAS_VPD_1_2;
-
     } else {
-      /* un-supported UUID */
-      char outstr[37]; /* 36-char + 1 null terminator */
-
-      uuid_unparse(data->uuid, outstr);
-      fprintf(stderr, "[ERROR] un-supported UUID: %s\n", outstr);
-      return VPD_ERR_INVALID;
-    }
-
-    /* move to next table */
-    if ((table_len = vpd_type241_size(header)) < 0) {
-      fprintf(stderr, "[ERROR] Cannot get type 241 structure table length.\n");
-      return VPD_ERR_INVALID;
+      fprintf(stderr, "Unknown operation: %s\n", op);
+      retval = VPD_ERR_SYNTAX;
     }
 
-    header = reinterpret_cast<struct vpd_header*>(
-        reinterpret_cast<uint8_t*>(header) + table_len);
-    data = reinterpret_cast<struct vpd_table_binary_blob_pointer*>(
-        reinterpret_cast<uint8_t*>(header) + sizeof(*header));
-  }
-
-  return VPD_OK;
-}
-
-vpd_err_t saveFile(const struct PairContainer* container,
-                   const char* filename,
-                   int write_back_to_flash) {
-  FILE* fp;
-
-  unsigned char eps[1024];
-  memset(eps, 0xff, sizeof(eps));
-
-  /* prepare info */
-  struct google_vpd_info* info = (struct google_vpd_info*)buf;
-  buf_len = sizeof(*info);
-  memset(info, 0, buf_len);
-  memcpy(info->header.magic, VPD_INFO_MAGIC, sizeof(info->header.magic));
-
-  /* encode into buffer */
-  vpd_err_t retval = encodeContainer(&file, max_buf_len, buf, &buf_len);
-  if (VPD_OK != retval) {
-    fprintf(stderr, "encodeContainer() error.\n");
-    return retval;
-  }
-  retval = encodeVpdTerminator(max_buf_len, buf, &buf_len);
-  if (VPD_OK != retval) {
-    fprintf(stderr, "Out of space for terminator.\n");
-    return retval;
-  }
-  info->size = buf_len - sizeof(*info);
-
-  int eps_len = 0;
-  retval = buildEpsAndTables(buf_len, sizeof(eps), eps, &eps_len);
-  if (VPD_OK != retval) {
-    fprintf(stderr, "Cannot build EPS.\n");
-    return retval;
-  }
-  assert(eps_len <= GOOGLE_SPD_OFFSET);
-
-  /* Write data in the following order:
-   *   1. EPS
-   *   2. SPD
-   *   3. VPD 2.0
-   */
-  if (found_vpd) {
-    /* We found VPD partition in -f file, which means file is existed.
-     * Instead of truncating the whole file, open to write partial. */
-    if (!(fp = fopen(filename, "r+"))) {
-      fprintf(stderr, "File [%s] cannot be opened for write.\n", filename);
-      return VPD_ERR_SYSTEM;
-    }
-  } else {
-    /* VPD is not found, which means the file is pure VPD data.
-     * Always creates the new file and overwrites the original content. */
-    if (!(fp = fopen(filename, "w+"))) {
-      fprintf(stderr, "File [%s] cannot be opened for write.\n", filename);
-      return VPD_ERR_SYSTEM;
-    }
-  }
-
-  const uint32_t file_seek = write_back_to_flash ? 0 : vpd_offset;
-
-  /* write EPS */
-  fseek(fp, file_seek + eps_offset, SEEK_SET);
-  if (fwrite(eps, eps_len, 1, fp) != 1) {
-    fprintf(stderr, "fwrite(EPS) error (%s)\n", strerror(errno));
-    return VPD_ERR_SYSTEM;
-  }
-
-  /* write SPD */
-  if (spd_data) {
-    fseek(fp, file_seek + spd_offset, SEEK_SET);
-    if (fwrite(spd_data, spd_len, 1, fp) != 1) {
-      fprintf(stderr, "fwrite(SPD) error (%s)\n", strerror(errno));
-      return VPD_ERR_SYSTEM;
+    if (VPD_OK != retval) {
+      fprintf(stderr, "[ERROR] batch line %d failed, uncommitted changes are "
+                      "dropped.\n", line_no);
+      break;
     }
   }
+  free(line);
 
-  /* write VPD 2.0 */
-  fseek(fp, file_seek + vpd_2_0_offset, SEEK_SET);
-  if (fwrite(buf, buf_len, 1, fp) != 1) {
-    fprintf(stderr, "fwrite(VPD 2.0) error (%s)\n", strerror(errno));
-    return VPD_ERR_SYSTEM;
-  }
-  fclose(fp);
-
-  return VPD_OK;
+  if (VPD_OK == retval)
+    retval = commitRegions(&regions);
+  return retval;
 }
 
 void usage(const char* progname) {
@@ -856,21 +499,64 @@ void usage(const char* progname) {
   printf("      -S <key=file>    To add/change a string value, reading its\n");
   printf("                       base64 contents from a file.\n");
   printf("      -s <key=value>   To add/change a string value.\n");
+  printf("      -b <key=value>   To add/change a binary value, given in\n");
+  printf("                       base64. Older readers do not know binary\n");
+  printf("                       values, see README.\n");
+  printf("      --binary-file <key=file>\n");
+  printf("                       Same as -b, reading the base64 from a file.\n");
+  printf("      --compress-min <length>\n");
+  printf("                       Compress binary values of at least length\n");
+  printf("                       bytes when writing (default: %d, 0: never).\n",
+         VPD_COMPRESS_MIN_LEN);
+  printf("      --prefix-keys    Store the keys set by this run that share a\n");
+  printf("                       prefix with an earlier key in less space.\n");
+  printf("                       Older readers do not know them, see README.\n");
   printf("      -p <pad length>  Pad if length is shorter.\n");
   printf("      -i <partition>   Specify VPD partition name in fmap.\n");
   printf("      -l               List content in the file.\n");
+  printf("      -k <keys>        Only list keys matching the comma separated\n");
+  printf("                       list of keys, prefix* or glob patterns.\n");
   printf("      --sh             Dump content for shell script.\n");
   printf("      --raw            Parse from a raw blob (without headers).\n");
   printf("      -0/--null-terminated\n");
   printf("                       Dump content in null terminate format.\n");
   printf("      -O               Overwrite and re-format VPD partition.\n");
   printf("      -g <key>         Print value string only.\n");
+  printf("      --get-keys <keys>\n");
+  printf("                       Print comma separated keys as +key=value\n");
+  printf("                       if found or -key if missing, one per line\n");
+  printf("                       (or null terminated with -0).\n");
   printf("      -d <key>         Delete a key.\n");
+  printf("      --if <key=value> Only change anything if key has value.\n");
+  printf("      --if-absent <key>\n");
+  printf("                       Only change anything if key does not exist.\n");
+  printf("                       Exits with %d if a condition fails.\n",
+         VPD_ERR_CONDITION);
+  printf("      --source <auto|flash|sysfs|cache>\n");
+  printf("                       Where -g and -l read from (default: flash).\n");
+  printf("                       auto uses sysfs or the dump_vpd_log cache\n");
+  printf("                       if they are up to date.\n");
+  printf("      --write-cache <file>\n");
+  printf("                       Write RO_VPD and RW_VPD to a binary cache\n");
+  printf("                       for vpd_cache.h readers.\n");
+  printf("      --checksum <warn|strict|off>\n");
+  printf("                       What to do if the SMBIOS entry point\n");
+  printf("                       checksums are wrong (default: warn).\n");
+  printf("                       strict exits with %d.\n", VPD_ERR_INVALID);
+  printf("      --eps <2|3>      Write an SMBIOS 2.x (_SM_) or 3.0 (_SM3_)\n");
+  printf("                       entry point (default: keep the current\n");
+  printf("                       one, 2 for new partitions).\n");
+  printf("      --batch <file>   Run operations from file (- for stdin),\n");
+  printf("                       writing each region once. See README.\n");
+  printf("      --exit-unchanged Exit with %d if nothing had to be written\n",
+         VPD_UNCHANGED);
+  printf("                       because the VPD already had the changes.\n");
   printf("\n");
   printf("   Notes:\n");
   printf("      You can specify multiple -s and -d. However, vpd always\n");
   printf("         applies -s first, then -d.\n");
   printf("      -g and -l must be mutually exclusive.\n");
+  printf("      Multiple -g imply --get-keys output format.\n");
   printf("\n");
 }
 
@@ -881,40 +567,58 @@ int main(int argc, char* argv[]) {
   int option_index = 0;
   vpd_err_t retval = VPD_OK;
   int export_type = VPD_EXPORT_KEY_VALUE;
-  const char* optstring = "hf:s:S:p:i:lOg:d:0";
+  const char* optstring = "hf:s:S:b:p:i:lk:Og:d:0";
   static struct option long_options[] = {
       {"help", 0, 0, 'h'},
       {"file", 0, 0, 'f'},
       {"string", 0, 0, 's'},
       {"base64file", 0, 0, 'S'},
+      {"binary", required_argument, 0, 'b'},
+      {"binary-file", required_argument, 0, 'Y'},
       {"pad", required_argument, 0, 'p'},
       {"partition", 0, 0, 'i'},
       {"list", 0, 0, 'l'},
+      {"keys", required_argument, 0, 'k'},
       {"overwrite", 0, 0, 'O'},
       {"filter", 0, 0, 'g'},
+      {"get-keys", required_argument, 0, 'G'},
       {"sh", 0, &export_type, VPD_EXPORT_AS_PARAMETER},
       {"raw", 0, 0, 'R'},
       {"null-terminated", 0, 0, '0'},
       {"delete", 0, 0, 'd'},
+      {"batch", required_argument, 0, 'B'},
+      {"exit-unchanged", 0, 0, 'U'},
+      {"if", required_argument, 0, 'I'},
+      {"if-absent", required_argument, 0, 'A'},
+      {"source", required_argument, 0, 'F'},
+      {"write-cache", required_argument, 0, 'C'},
+      {"checksum", required_argument, 0, 'K'},
+      {"eps", required_argument, 0, 'M'},
+      {"compress-min", required_argument, 0, 'Z'},
+      {"prefix-keys", 0, 0, 'P'},
       {0, 0, 0, 0}};
   std::string region_name = "RO_VPD";
   char* filename = NULL;
-  const char* load_file = NULL;
-  const char* save_file = NULL;
-  const char* tmp_part_file = NULL;
-  const char* tmp_full_file = NULL;
-  std::optional<std::string> key_to_export;
-  int write_back_to_flash = 0;
+  const char* batch_file = NULL;
+  const char* cache_file = NULL;
+  VpdRegion region;
+  struct VpdLock flash_lock = {-1};
+  std::vector<std::string> keys_to_export;
+  bool multi_get = false;
   bool list_it = false;
   bool overwrite_it = false;
   int modified = 0;
   int num_to_delete;
   bool read_from_file = false;
   bool raw_input = false;
+  enum ReadSource read_source = libvpd::SOURCE_FLASH;
+  bool read_only = false;
 
-  initContainer(&file);
   initContainer(&set_argument);
   initContainer(&del_argument);
+  initContainer(&cond_present);
+  initContainer(&cond_absent);
+  initKeyFilter(&key_filter);
 
   while ((opt = getopt_long(argc, argv, optstring, long_options,
                             &option_index)) != EOF) {
@@ -932,8 +636,21 @@ int main(int argc, char* argv[]) {
         read_from_file = true;
         /* Fall through into the next case */
       case 's':
-        retval =
-            parseString(reinterpret_cast<uint8_t*>(optarg), read_from_file);
+        retval = parseString(reinterpret_cast<uint8_t*>(optarg),
+                             read_from_file, false);
+        if (VPD_OK != retval) {
+          fprintf(stderr, "The string [%s] cannot be parsed.\n\n", optarg);
+          goto teardown;
+        }
+        read_from_file = false;
+        break;
+
+      case 'Y':
+        read_from_file = true;
+        /* Fall through into the next case */
+      case 'b':
+        retval = parseString(reinterpret_cast<uint8_t*>(optarg),
+                             read_from_file, true);
         if (VPD_OK != retval) {
           fprintf(stderr, "The string [%s] cannot be parsed.\n\n", optarg);
           goto teardown;
@@ -957,7 +674,8 @@ int main(int argc, char* argv[]) {
       case 'i':
         region_name = std::string(optarg);
         if (region_name != "RO_VPD" && region_name != "RW_VPD") {
-          LOG(ERROR) << "Invalid VPD partition name: " << region_name;
+          fprintf(stderr, "[ERROR] Invalid VPD partition name: %s\n",
+                  region_name.c_str());
           retval = VPD_ERR_SYNTAX;
           goto teardown;
         }
@@ -967,6 +685,14 @@ int main(int argc, char* argv[]) {
         list_it = true;
         break;
 
+      case 'k':
+        retval = addKeyFilterList(&key_filter, optarg);
+        if (VPD_OK != retval) {
+          fprintf(stderr, "The key list [%s] cannot be parsed.\n", optarg);
+          goto teardown;
+        }
+        break;
+
       case 'O':
         overwrite_it = true;
         /* This option forces to write empty data back even no new pair is
@@ -975,8 +701,23 @@ int main(int argc, char* argv[]) {
         break;
 
       case 'g':
-        key_to_export = std::string(optarg);
+        keys_to_export.push_back(std::string(optarg));
+        break;
+
+      case 'G': {
+        std::string list(optarg);
+        size_t start = 0;
+        while (start <= list.size()) {
+          size_t end = list.find(',', start);
+          if (end == std::string::npos)
+            end = list.size();
+          if (end > start)
+            keys_to_export.push_back(list.substr(start, end - start));
+          start = end + 1;
+        }
+        multi_get = true;
         break;
+      }
 
       case 'd':
         /* Add key into container for delete. Since value is non-sense,
@@ -992,6 +733,85 @@ int main(int argc, char* argv[]) {
         raw_input = true;
         break;
 
+      case 'B':
+        batch_file = optarg;
+        break;
+
+      case 'U':
+        report_unchanged = true;
+        break;
+
+      case 'P':
+        prefix_keys = true;
+        break;
+
+      case 'I':
+        retval = addCondition(optarg);
+        if (VPD_OK != retval)
+          goto teardown;
+        break;
+
+      case 'A':
+        setString(&cond_absent, (const uint8_t*)optarg, (const uint8_t*)"", 0);
+        break;
+
+      case 'C':
+        cache_file = optarg;
+        break;
+
+      case 'K':
+        if (!strcmp(optarg, "warn")) {
+          checksum_mode = libvpd::CHECKSUM_WARN;
+        } else if (!strcmp(optarg, "strict")) {
+          checksum_mode = libvpd::CHECKSUM_STRICT;
+        } else if (!strcmp(optarg, "off")) {
+          checksum_mode = libvpd::CHECKSUM_OFF;
+        } else {
+          fprintf(stderr, "Invalid checksum mode: %s\n", optarg);
+          retval = VPD_ERR_SYNTAX;
+          goto teardown;
+        }
+        break;
+
+      case 'M':
+        if (!strcmp(optarg, "2")) {
+          eps_major_ver = CONFIG_EPS_VPD_MAJOR_VERSION;
+        } else if (!strcmp(optarg, "3")) {
+          eps_major_ver = CONFIG_EPS3_VPD_MAJOR_VERSION;
+        } else {
+          fprintf(stderr, "Invalid SMBIOS entry point version: %s\n", optarg);
+          retval = VPD_ERR_SYNTAX;
+          goto teardown;
+        }
+        break;
+
+      case 'Z': {
+        char* end;
+        compress_min = strtol(optarg, &end, 0);
+        if (!*optarg || *end || compress_min < 0) {
+          fprintf(stderr, "Invalid length to compress: %s\n", optarg);
+          retval = VPD_ERR_SYNTAX;
+          goto teardown;
+        }
+        break;
+      }
+
+      case 'F':
+        if (!strcmp(optarg, "flash")) {
+          read_source = libvpd::SOURCE_FLASH;
+        } else if (!strcmp(optarg, "auto")) {
+          read_source = libvpd::SOURCE_AUTO;
+        } else if (!strcmp(optarg, "sysfs")) {
+          read_source = libvpd::SOURCE_SYSFS;
+        } else if (!strcmp(optarg, "cache")) {
+          read_source = libvpd::SOURCE_CACHE;
+        } else {
+          fprintf(stderr, "Invalid read source: %s\n", optarg);
+          retval = VPD_ERR_SYNTAX;
+          goto teardown;
+        }
+        break;
+
       case 0:
         break;
 
@@ -1010,19 +830,89 @@ int main(int argc, char* argv[]) {
     goto teardown;
   }
 
-  if (list_it && key_to_export) {
+  if (batch_file) {
+    if (cache_file || list_it || overwrite_it || raw_input || eps_major_ver ||
+        !keys_to_export.empty() ||
+        lenOfContainer(&set_argument) || lenOfContainer(&del_argument) ||
+        lenOfContainer(&cond_present) || lenOfContainer(&cond_absent)) {
+      fprintf(stderr,
+              "[ERROR] --batch only works with -f, -i, -p and "
+              "--exit-unchanged.\n");
+      retval = VPD_ERR_SYNTAX;
+      goto teardown;
+    }
+
+    FILE* input = strcmp(batch_file, "-") ? fopen(batch_file, "r") : stdin;
+    if (!input) {
+      fprintf(stderr, "[ERROR] Cannot open batch file: %s\n", batch_file);
+      retval = VPD_ERR_SYSTEM;
+      goto teardown;
+    }
+    if (!filename)
+      retval = vpdLock(&flash_lock, true, -1);
+    if (VPD_OK == retval)
+      retval = runBatch(input, filename, region_name);
+    if (input != stdin)
+      fclose(input);
+    goto teardown;
+  }
+
+  if (cache_file) {
+    if (list_it || overwrite_it || raw_input || !keys_to_export.empty() ||
+        lenOfContainer(&set_argument) || lenOfContainer(&del_argument) ||
+        lenOfContainer(&cond_present) || lenOfContainer(&cond_absent)) {
+      fprintf(stderr, "[ERROR] --write-cache only works with -f.\n");
+      retval = VPD_ERR_SYNTAX;
+      goto teardown;
+    }
+    if (!filename)
+      retval = vpdLock(&flash_lock, false, -1);
+    if (VPD_OK == retval)
+      retval = writeBinaryCache(filename, cache_file);
+    goto teardown;
+  }
+
+  if (keys_to_export.size() > 1)
+    multi_get = true;
+
+  if (list_it && !keys_to_export.empty()) {
     fprintf(stderr, "[ERROR] -l and -g must be mutually exclusive.\n");
     retval = VPD_ERR_SYNTAX;
     goto teardown;
   }
 
-  if (VPD_EXPORT_KEY_VALUE != export_type && !list_it) {
+  if (VPD_EXPORT_KEY_VALUE != export_type && !list_it &&
+      !(multi_get && VPD_EXPORT_NULL_TERMINATE == export_type)) {
     fprintf(stderr,
             "[ERROR] --sh/--null-terminated can be set only if -l is set.\n");
     retval = VPD_ERR_SYNTAX;
     goto teardown;
   }
 
+  if (!isKeyFilterEmpty(&key_filter) && !list_it) {
+    fprintf(stderr, "[ERROR] -k can be set only if -l is set.\n");
+    retval = VPD_ERR_SYNTAX;
+    goto teardown;
+  }
+
+  /* Fetch all the keys of -g in the same decoding pass. */
+  for (const auto& key : keys_to_export) {
+    retval = addKeyFilterKey(&key_filter, key.c_str(), key.size());
+    if (VPD_OK != retval) {
+      fprintf(stderr, "[ERROR] Invalid key to get: '%s'.\n", key.c_str());
+      goto teardown;
+    }
+  }
+
+  /* Nothing will be written back or checked, so filtered out pairs can be
+   * skipped entirely while decoding. */
+  read_only = !modified && !eps_major_ver &&
+              !lenOfContainer(&set_argument) &&
+              !lenOfContainer(&del_argument) &&
+              !lenOfContainer(&cond_present) && !lenOfContainer(&cond_absent);
+  if (read_only)
+    region.decode_filter = &key_filter;
+
   if (raw_input && !filename) {
     fprintf(stderr, "[ERROR] Needs -f FILE for raw input.\n");
     retval = VPD_ERR_SYNTAX;
@@ -1036,69 +926,120 @@ int main(int argc, char* argv[]) {
     goto teardown;
   }
 
-  tmp_part_file = myMkTemp();
-  tmp_full_file = myMkTemp();
-  if (!tmp_part_file || !tmp_full_file) {
-    fprintf(stderr, "[ERROR] Failed creating temporary files.\n");
-    retval = VPD_ERR_SYSTEM;
-    goto teardown;
+  /* sysfs and the cache are only for reading the flash. */
+  if (libvpd::SOURCE_FLASH != read_source &&
+      (filename || raw_input || !read_only)) {
+    if (libvpd::SOURCE_AUTO != read_source) {
+      fprintf(stderr,
+              "[ERROR] --source only works for reading the flash.\n");
+      retval = VPD_ERR_SYNTAX;
+      goto teardown;
+    }
+    read_source = libvpd::SOURCE_FLASH;
   }
 
-  /* if no filename is specified, call flashrom to read from flash. */
-  if (!filename) {
-    if (FLASHROM_OK != flashromPartialRead(tmp_part_file, tmp_full_file,
-                                           region_name.c_str())) {
-      fprintf(stderr, "[WARN] flashromPartialRead() failed, try full read.\n");
-      /* Try to read whole file */
-      if (FLASHROM_OK != flashromFullRead(tmp_full_file)) {
-        fprintf(stderr, "[ERROR] flashromFullRead() error!\n");
-        retval = VPD_ERR_ROM_READ;
-        goto teardown;
-      }
+  region.name = region_name;
+  region.checksum_mode = checksum_mode;
+  region.compress_min = compress_min;
+  if (libvpd::SOURCE_FLASH != read_source) {
+    retval = libvpd::loadFromSource(&region, read_source);
+    if (VPD_OK == retval)
+      goto loaded;
+    if (libvpd::SOURCE_AUTO != read_source) {
+      fprintf(stderr, "[ERROR] Cannot read %s from the %s: %d\n",
+              region_name.c_str(),
+              libvpd::SOURCE_SYSFS == read_source ? "sysfs" : "cache", retval);
+      goto teardown;
     }
+    /* Drop anything loaded before the source turned out to be unusable. */
+    destroyContainer(&region.file);
+    initContainer(&region.file);
+    retval = VPD_OK;
+  }
 
-    write_back_to_flash = 1;
-    load_file = tmp_full_file;
-    save_file = tmp_part_file;
-  } else {
-    load_file = filename;
-    save_file = filename;
+  /* Keep other VPD users off the flash from reading until writing back. */
+  if (!filename) {
+    retval = vpdLock(&flash_lock,
+                     modified || eps_major_ver ||
+                         lenOfContainer(&set_argument) ||
+                         lenOfContainer(&del_argument),
+                     -1);
+    if (VPD_OK != retval)
+      goto teardown;
   }
 
-  if (raw_input)
-    retval = loadRawFile(load_file, &file);
-  else
-    retval = loadFile(region_name, load_file, &file, overwrite_it);
+  region.modified = modified;
+  retval = libvpd::openRegion(&region, filename, raw_input, overwrite_it);
+  if (VPD_OK != retval)
+    goto teardown;
+
+loaded:
+
+  /* Do --eps */
+  if (eps_major_ver && eps_major_ver != region.eps_major_ver) {
+    region.eps_major_ver = eps_major_ver;
+    region.modified++;
+  }
+
+  /* Check --if and --if-absent against what was loaded, so that the changes
+   * below are made in the same read/write cycle. */
+  retval = checkConditions(&region.file);
   if (VPD_OK != retval) {
-    fprintf(stderr, "loadFile('%s') error.\n", load_file);
+    fprintf(stderr, "Command ignored.\n");
     goto teardown;
   }
 
   /* Do -s */
   if (lenOfContainer(&set_argument) > 0) {
-    mergeContainer(&file, &set_argument);
-    modified++;
+    mergeSetArgument(&region.file);
+    region.modified++;
   }
 
   /* Do -d */
   num_to_delete = lenOfContainer(&del_argument);
-  if (subtractContainer(&file, &del_argument) != num_to_delete) {
+  if (subtractContainer(&region.file, &del_argument) != num_to_delete) {
     fprintf(stderr,
             "[ERROR] At least one of the keys to delete"
             " does not exist. Command ignored.\n");
     retval = VPD_ERR_PARAM;
     goto teardown;
   } else if (num_to_delete > 0) {
-    modified++;
+    region.modified++;
   }
 
-  /* Do -g */
-  if (key_to_export) {
+  /* Do -g with multiple keys */
+  if (multi_get) {
+    uint8_t dump_buf[BUF_LEN * 2];
+    int dump_len = 0;
+    bool all_found = true;
+
+    for (const auto& key : keys_to_export) {
+      const uint8_t* key_str = reinterpret_cast<const uint8_t*>(key.c_str());
+      struct StringPair* foundString = findString(&region.file, key_str, NULL);
+      if (!foundString)
+        all_found = false;
+      retval = exportLookupResult(export_type, key_str, foundString,
+                                  sizeof(dump_buf), dump_buf, &dump_len);
+      if (VPD_OK != retval) {
+        fprintf(stderr, "exportLookupResult(): Cannot export the value.\n");
+        goto teardown;
+      }
+    }
+
+    fwrite(dump_buf, dump_len, 1, stdout);
+    if (!all_found) {
+      retval = VPD_FAIL;
+      goto teardown;
+    }
+  } else if (!keys_to_export.empty()) {
+    /* Do -g */
+    const std::string& key_to_export = keys_to_export.front();
     struct StringPair* foundString = findString(
-        &file, reinterpret_cast<const uint8_t*>(key_to_export->c_str()), NULL);
+        &region.file, reinterpret_cast<const uint8_t*>(key_to_export.c_str()),
+        NULL);
     if (!foundString) {
       fprintf(stderr, "findString(): Vpd data '%s' was not found.\n",
-              key_to_export->c_str());
+              key_to_export.c_str());
       retval = VPD_FAIL;
       goto teardown;
     } else {
@@ -1123,8 +1064,9 @@ int main(int argc, char* argv[]) {
     uint8_t list_buf[BUF_LEN * 5 + 64];
     int list_len = 0;
 
-    retval = exportContainer(export_type, &file, sizeof(list_buf), list_buf,
-                             &list_len);
+    setContainerKeyFilter(&region.file, &key_filter);
+    retval = exportContainer(export_type, &region.file, sizeof(list_buf),
+                             list_buf, &list_len);
     if (VPD_OK != retval) {
       fprintf(stderr, "exportContainer(): Cannot generate string.\n");
       goto teardown;
@@ -1141,38 +1083,24 @@ int main(int argc, char* argv[]) {
     fwrite(list_buf, list_len, 1, stdout);
   }
 
-  if (modified) {
-    if (file_flag & HAS_VPD_1_2) {
-      fprintf(stderr, "[ERROR] Writing VPD 1.2 not supported yet.\n");
-      retval = VPD_FAIL;
+  if (region.modified) {
+    retval = commitAndCount(&region);
+    if (VPD_OK != retval)
       goto teardown;
-    }
-
-    retval = saveFile(&file, save_file, write_back_to_flash);
-    if (VPD_OK != retval) {
-      fprintf(stderr, "saveFile('%s') error: %d\n", filename, retval);
-      goto teardown;
-    }
-
-    if (write_back_to_flash) {
-      if (FLASHROM_OK !=
-          flashromPartialWrite(save_file, tmp_full_file, region_name.c_str())) {
-        fprintf(stderr, "flashromPartialWrite() error.\n");
-        retval = VPD_ERR_ROM_WRITE;
-        goto teardown;
-      }
-    }
   }
 
 teardown:
-  if (spd_data)
-    free(spd_data);
+  if (VPD_OK == retval && report_unchanged && regions_unchanged &&
+      !regions_written)
+    retval = VPD_UNCHANGED;
   if (filename)
     free(filename);
-  destroyContainer(&file);
   destroyContainer(&set_argument);
   destroyContainer(&del_argument);
-  cleanTempFiles();
+  destroyContainer(&cond_present);
+  destroyContainer(&cond_absent);
+  destroyKeyFilter(&key_filter);
+  vpdUnlock(&flash_lock);
 
   return retval;
 }
@@ -0,0 +1,200 @@
+/*
+ * Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * vpd_client - queries and updates VPD through vpdd.
+ *
+ * Accepts the common subset of the vpd options. If vpdd is not running, the
+ * same command line is passed to vpd, so callers can switch unconditionally.
+ */
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+extern "C" {
+#include "lib/lib_vpd.h"
+#include "lib/vpdd_client.h"
+};
+
+namespace {
+
+void usage(const char* progname) {
+  printf("Usage: %s [OPTION] ...\n", progname);
+  printf("   OPTIONs include:\n");
+  printf("      -h               This help page.\n");
+  printf("      -f <filename>    Run vpd on a file instead (bypasses vpdd).\n");
+  printf("      -i <partition>   Specify VPD partition name in fmap.\n");
+  printf("      -s <key>=<value> To add/change a string value.\n");
+  printf("      -d <key>         Delete a key.\n");
+  printf("      -g <key>         Print the value of key.\n");
+  printf("      -l               List all keys and values.\n");
+  printf("      -0/--null-terminated\n");
+  printf("                       Print values of -l as key=value\\0.\n");
+  printf("      --sync           Wait until all pending writes are in flash.\n");
+  printf("\n");
+  printf("   Falls back to vpd if vpdd is not running.\n");
+  printf("\n");
+}
+
+/* Runs vpd with the original arguments. Only returns on failure. */
+int execVpd(char* argv[]) {
+  argv[0] = const_cast<char*>("vpd");
+  execvp(argv[0], argv);
+  perror("Cannot run vpd");
+  return VPD_ERR_SYSTEM;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  std::string region = "RO_VPD";
+  /* Write requests as "<op> <arg>"; the region is inserted once known. */
+  std::vector<std::pair<std::string, std::string>> writes;
+  std::vector<std::string> requests;
+  bool list_it = false;
+  bool null_terminated = false;
+  bool sync_it = false;
+  bool use_vpd = false;
+  const char* get_key = NULL;
+  int opt;
+  int option_index = 0;
+  vpd_err_t retval = VPD_OK;
+
+  static struct option long_options[] = {
+      {"help", 0, 0, 'h'},
+      {"null-terminated", 0, 0, '0'},
+      {"sync", 0, 0, 'S'},
+      {0, 0, 0, 0}};
+
+  while ((opt = getopt_long(argc, argv, "hf:i:s:d:g:l0", long_options,
+                            &option_index)) != EOF) {
+    switch (opt) {
+      case 'f':
+        use_vpd = true;
+        break;
+      case 'i':
+        if (strcmp(optarg, "RO_VPD") && strcmp(optarg, "RW_VPD")) {
+          fprintf(stderr, "Invalid VPD partition name: %s\n", optarg);
+          return VPD_ERR_SYNTAX;
+        }
+        region = optarg;
+        break;
+      case 's':
+        if (strchr(optarg, '\n')) {
+          fprintf(stderr, "Values with newlines need vpd: %s\n", optarg);
+          return VPD_ERR_PARAM;
+        }
+        writes.emplace_back("SET", optarg);
+        break;
+      case 'd':
+        writes.emplace_back("DELETE", optarg);
+        break;
+      case 'g':
+        get_key = optarg;
+        break;
+      case 'l':
+        list_it = true;
+        break;
+      case '0':
+        null_terminated = true;
+        break;
+      case 'S':
+        sync_it = true;
+        break;
+      case 'h':
+        usage(argv[0]);
+        return VPD_OK;
+      default:
+        usage(argv[0]);
+        return VPD_ERR_SYNTAX;
+    }
+  }
+
+  if (optind < argc) {
+    fprintf(stderr, "[ERROR] unexpected argument: %s\n\n", argv[optind]);
+    usage(argv[0]);
+    return VPD_ERR_SYNTAX;
+  }
+  if (list_it && get_key) {
+    fprintf(stderr, "[ERROR] -l and -g must be mutually exclusive.\n");
+    return VPD_ERR_SYNTAX;
+  }
+
+  int fd = use_vpd ? -1 : vpddConnect(vpddSocketPath());
+  if (fd < 0) {
+    /* vpd has nothing to sync, and does not know --sync. */
+    if (sync_it && writes.empty() && !list_it && !get_key)
+      return VPD_OK;
+    if (sync_it) {
+      fprintf(stderr, "[ERROR] --sync needs vpdd.\n");
+      return VPD_ERR_SYNTAX;
+    }
+    return execVpd(argv);
+  }
+
+  /* Writes go first, same as in vpd. */
+  for (const auto& write : writes)
+    requests.push_back(write.first + " " + region + " " + write.second);
+  if (sync_it)
+    requests.push_back("SYNC");
+  if (get_key)
+    requests.push_back("GET " + region + " " + get_key);
+  if (list_it)
+    requests.push_back("LIST " + region);
+
+  /* Send everything up front so that all the writes go into one commit. */
+  for (const auto& request : requests) {
+    if (VPD_OK != vpddSendRequest(fd, request.c_str())) {
+      fprintf(stderr, "[ERROR] Lost connection to vpdd.\n");
+      close(fd);
+      return VPD_ERR_SYSTEM;
+    }
+  }
+
+  for (const auto& request : requests) {
+    uint8_t* response;
+    uint32_t len;
+
+    retval = vpddReadResponse(fd, &response, &len);
+    if (VPD_OK != retval) {
+      if (request.compare(0, 4, "GET ") == 0 && VPD_FAIL == retval)
+        fprintf(stderr, "Vpd data '%s' was not found.\n", get_key);
+      else
+        fprintf(stderr, "[ERROR] vpdd failed on '%s': %d\n", request.c_str(),
+                retval);
+      free(response);
+      break;
+    }
+
+    if (request.compare(0, 4, "GET ") == 0) {
+      fwrite(response, len, 1, stdout);
+    } else if (request.compare(0, 5, "LIST ") == 0) {
+      /* The records are "key=value\0", which is already the -0 format. */
+      for (uint32_t i = 0; i < len;) {
+        const char* record = reinterpret_cast<const char*>(response + i);
+        size_t record_len = strlen(record);
+        if (null_terminated) {
+          fwrite(record, record_len + 1, 1, stdout);
+        } else {
+          const char* eq = strchr(record, '=');
+          if (eq)
+            printf("\"%.*s\"=\"%s\"\n", static_cast<int>(eq - record), record,
+                   eq + 1);
+        }
+        i += record_len + 1;
+      }
+    }
+    free(response);
+  }
+
+  close(fd);
+  return retval;
+}
@@ -0,0 +1,523 @@
+/*
+ * Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * vpd-get - prints the values of VPD keys, for boot-time callers.
+ *
+ * Unlike vpd, it never builds a container or copies values, except to
+ * decompress the values that vpd stored compressed. Each partition
+ * is read from the first source that is up to date: /sys/firmware/vpd, the
+ * binary cache of dump_vpd_log, then the flash. In sysfs, keys without a
+ * file of their own are looked up in the raw blob of the partition. From the
+ * flash only the partition is read, and decoding stops once all keys are
+ * found.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <fmap.h>
+#include <getopt.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+extern "C" {
+#include "lib/flashrom.h"
+#include "lib/lib_smbios.h"
+#include "lib/lib_vpd.h"
+#include "lib/vpd.h"
+#include "lib/vpd_cache.h"
+#include "lib/vpd_lock.h"
+};
+
+namespace {
+
+/* Default locations, as in libvpd/vpd_region.cc. Each can be overridden by
+ * the environment variable of the same name. */
+#define VPD_SYSFS_DIR "/sys/firmware/vpd"
+#define VPD_RUN_DIR "/run/vpd"
+#define VPD_BINARY_CACHE_FILE \
+  "/mnt/stateful_partition/unencrypted/cache/vpd/full-v2.bin"
+
+/* More keys than any caller needs; keeps the lookup free of allocations. */
+#define MAX_KEYS 64
+
+struct Partition {
+  const char* name;       /* in fmap */
+  const char* sysfs_dir;  /* under VPD_SYSFS_DIR */
+  int cache_section;
+};
+
+const struct Partition kPartitions[] = {
+    {"RO_VPD", "ro", VPD_CACHE_RO},
+    {"RW_VPD", "rw", VPD_CACHE_RW},
+};
+
+enum Source {
+  SOURCE_NONE,
+  SOURCE_SYSFS,
+  SOURCE_CACHE,
+  SOURCE_BLOB,
+};
+
+struct Lookup {
+  const char* key;
+  enum Source source;
+  const struct Partition* partition; /* for SOURCE_SYSFS */
+  const uint8_t* value;              /* for SOURCE_CACHE and SOURCE_BLOB */
+  uint32_t value_len;
+};
+
+struct Lookups {
+  struct Lookup entries[MAX_KEYS];
+  int count;
+  int missing;
+};
+
+const char* getPath(const char* name, const char* fallback) {
+  const char* path = getenv(name);
+  return (path && *path) ? path : fallback;
+}
+
+void usage(const char* progname) {
+  printf("Usage: %s [OPTION] <key> ...\n", progname);
+  printf("   OPTIONs include:\n");
+  printf("      -h               This help page.\n");
+  printf("      -i <partition>   Only look in RO_VPD or RW_VPD. By default\n");
+  printf("                       RO_VPD is searched first, then RW_VPD.\n");
+  printf("      -f <filename>    Read an image file instead.\n");
+  printf("      -0               Print several keys null terminated.\n");
+  printf("\n");
+  printf("   One key prints its value only. Several keys print +key=value\n");
+  printf("   or -key per key, like vpd -g. Exits with %d if a key is\n",
+         VPD_FAIL);
+  printf("   missing.\n");
+  printf("\n");
+}
+
+/* Keys name files in sysfs; do not let them name anything else. */
+bool isValidKey(const char* key) {
+  return *key && *key != '.' && !strchr(key, '/');
+}
+
+/* Maps filename read-only. The mapping lives until the process exits. */
+const uint8_t* mapFile(const char* filename, uint32_t* size) {
+  int fd = open(filename, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return NULL;
+
+  struct stat st;
+  void* data = MAP_FAILED;
+  if (!fstat(fd, &st) && st.st_size > 0 && st.st_size <= UINT32_MAX)
+    data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+    return NULL;
+  *size = st.st_size;
+  return static_cast<const uint8_t*>(data);
+}
+
+/* Same rule as vpd --source auto: a partition written since boot is stale
+ * in sysfs, and in the cache unless the cache was written after it. */
+bool writtenSince(const struct Partition* partition, struct stat* marker) {
+  char path[PATH_MAX];
+  snprintf(path, sizeof(path), "%s/%s.written",
+           getPath("VPD_RUN_DIR", VPD_RUN_DIR), partition->name);
+  return !stat(path, marker);
+}
+
+bool isNewer(const struct stat* a, const struct stat* b) {
+  return a->st_mtim.tv_sec > b->st_mtim.tv_sec ||
+         (a->st_mtim.tv_sec == b->st_mtim.tv_sec &&
+          a->st_mtim.tv_nsec > b->st_mtim.tv_nsec);
+}
+
+int decodeCallback(uint8_t type,
+                   const uint8_t* key_prefix,
+                   uint32_t key_prefix_len,
+                   const uint8_t* key,
+                   uint32_t key_len,
+                   const uint8_t* value,
+                   uint32_t value_len,
+                   void* arg) {
+  struct Lookups* lookups = static_cast<struct Lookups*>(arg);
+
+  for (int i = 0; i < lookups->count; i++) {
+    struct Lookup* lookup = &lookups->entries[i];
+    /* vpd never writes a key twice, so the first match is the value. Keys
+     * stored as a prefix of another key are compared in two parts. */
+    if (lookup->source != SOURCE_NONE ||
+        strlen(lookup->key) != key_prefix_len + key_len ||
+        memcmp(lookup->key, key_prefix, key_prefix_len) ||
+        memcmp(lookup->key + key_prefix_len, key, key_len))
+      continue;
+    lookup->source = SOURCE_BLOB;
+    lookup->value = value;
+    lookup->value_len = value_len;
+    if (type == VPD_TYPE_COMPRESSED) {
+      /* Kept until exit, like the mapped image. */
+      uint8_t* unpacked;
+      if (VPD_OK != unpackValue(value, value_len, &unpacked,
+                                &lookup->value_len))
+        return VPD_DECODE_FAIL;
+      lookup->value = unpacked;
+    }
+    lookups->missing--;
+  }
+  return VPD_DECODE_OK;
+}
+
+/* Reads filename into a malloc()ed buffer kept until the process exits.
+ * Files in sysfs cannot be mapped. */
+const uint8_t* readFile(const char* filename, uint32_t* size) {
+  int fd = open(filename, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return NULL;
+
+  uint8_t* data = NULL;
+  size_t capacity = 0, used = 0;
+  for (;;) {
+    if (used == capacity) {
+      capacity = capacity ? capacity * 2 : 4096;
+      uint8_t* grown = capacity <= UINT32_MAX
+                           ? static_cast<uint8_t*>(realloc(data, capacity))
+                           : NULL;
+      if (!grown)
+        break;
+      data = grown;
+    }
+    ssize_t len = read(fd, data + used, capacity - used);
+    if (len < 0 && errno == EINTR)
+      continue;
+    if (len < 0)
+      break;
+    if (len == 0) {
+      close(fd);
+      *size = used;
+      return data;
+    }
+    used += len;
+  }
+  close(fd);
+  free(data);
+  return NULL;
+}
+
+/* Returns false if sysfs does not have the partition, or some keys are
+ * neither in its per-key files nor in a raw blob to look them up in. */
+bool lookupSysfs(const struct Partition* partition, struct Lookups* lookups) {
+  char path[PATH_MAX];
+  snprintf(path, sizeof(path), "%s/%s",
+           getPath("VPD_SYSFS_DIR", VPD_SYSFS_DIR), partition->sysfs_dir);
+  if (access(path, X_OK))
+    return false;
+
+  for (int i = 0; i < lookups->count; i++) {
+    struct Lookup* lookup = &lookups->entries[i];
+    if (lookup->source != SOURCE_NONE)
+      continue;
+    snprintf(path, sizeof(path), "%s/%s/%s",
+             getPath("VPD_SYSFS_DIR", VPD_SYSFS_DIR), partition->sysfs_dir,
+             lookup->key);
+    if (!access(path, R_OK)) {
+      lookup->source = SOURCE_SYSFS;
+      lookup->partition = partition;
+      lookups->missing--;
+    }
+  }
+  if (!lookups->missing)
+    return true;
+
+  /* The kernel only makes files for the strings in front of the first
+   * record of a type it does not know, but exports all records raw. */
+  snprintf(path, sizeof(path), "%s/%s_raw",
+           getPath("VPD_SYSFS_DIR", VPD_SYSFS_DIR), partition->sysfs_dir);
+  uint32_t size;
+  const uint8_t* raw = readFile(path, &size);
+  if (!raw)
+    return false;
+  uint32_t index = 0;
+  while (lookups->missing && index < size &&
+         raw[index] != VPD_TYPE_TERMINATOR &&
+         raw[index] != VPD_TYPE_IMPLICIT_TERMINATOR) {
+    if (VPD_DECODE_OK !=
+        vpd_decode_record(size, raw, &index, decodeCallback, lookups)) {
+      fprintf(stderr, "[ERROR] Cannot decode %s.\n", path);
+      return false;
+    }
+  }
+  return true;
+}
+
+/* Returns false if there is no usable binary cache. */
+bool lookupCache(const struct Partition* partition,
+                 const struct stat* written,
+                 struct Lookups* lookups) {
+  /* Both partitions share one cache; open it once. */
+  static struct VpdCache cache;
+  static bool opened, usable;
+
+  const char* path =
+      getPath("VPD_BINARY_CACHE_FILE", VPD_BINARY_CACHE_FILE);
+  struct stat cache_st;
+  if (stat(path, &cache_st) || (written && !isNewer(&cache_st, written)))
+    return false;
+  if (!opened) {
+    opened = true;
+    usable = VPD_OK == openVpdCache(&cache, path);
+  }
+  if (!usable)
+    return false;
+
+  for (int i = 0; i < lookups->count; i++) {
+    struct Lookup* lookup = &lookups->entries[i];
+    if (lookup->source != SOURCE_NONE)
+      continue;
+    if (VPD_OK == lookupVpdCache(&cache, partition->cache_section,
+                                 lookup->key, &lookup->value,
+                                 &lookup->value_len)) {
+      lookup->source = SOURCE_CACHE;
+      lookups->missing--;
+    }
+  }
+  return true;
+}
+
+/* Finds the keys in the VPD 2.0 blob of partition in the image. */
+vpd_err_t lookupImage(const struct Partition* partition,
+                      const uint8_t* image,
+                      uint32_t image_size,
+                      struct Lookups* lookups) {
+  long sig_offset = fmap_find(image, image_size);
+  if (sig_offset < 0 || sig_offset + sizeof(struct fmap) > image_size) {
+    fprintf(stderr, "[ERROR] No FMAP found.\n");
+    return VPD_ERR_NOT_FOUND;
+  }
+  const struct fmap_area* area = fmap_find_area(
+      reinterpret_cast<const struct fmap*>(image + sig_offset),
+      partition->name);
+  if (!area || area->offset > image_size ||
+      area->size > image_size - area->offset) {
+    fprintf(stderr, "[ERROR] The VPD partition [%s] is not found.\n",
+            partition->name);
+    return VPD_ERR_NOT_FOUND;
+  }
+
+  const uint8_t* vpd_buf = image + area->offset;
+  uint32_t index;
+  if (vpd_find_blob(vpd_buf, area->size, GOOGLE_VPD_2_0_UUID, &index)) {
+    /* Not formatted or VPD 1.x; there are no VPD 2.0 keys. */
+    return VPD_OK;
+  }
+
+  while (lookups->missing && index < area->size &&
+         vpd_buf[index] != VPD_TYPE_TERMINATOR &&
+         vpd_buf[index] != VPD_TYPE_IMPLICIT_TERMINATOR) {
+    if (VPD_DECODE_OK != vpd_decode_record(area->size, vpd_buf, &index,
+                                           decodeCallback, lookups)) {
+      fprintf(stderr, "[ERROR] Cannot decode %s.\n", partition->name);
+      return VPD_ERR_DECODE;
+    }
+  }
+  return VPD_OK;
+}
+
+/* Reads partition from the flash, as openRegion() does, and looks the keys
+ * up in it. */
+vpd_err_t lookupFlash(const struct Partition* partition,
+                      struct Lookups* lookups) {
+  char part_file[] = "/tmp/vpd-get.part.XXXXXX";
+  char full_file[] = "/tmp/vpd-get.full.XXXXXX";
+  int part_fd = mkstemp(part_file);
+  int full_fd = mkstemp(full_file);
+  vpd_err_t retval = VPD_ERR_SYSTEM;
+  const uint8_t* image = NULL;
+  uint32_t image_size = 0;
+  struct VpdLock lock = {-1};
+
+  if (part_fd < 0 || full_fd < 0) {
+    fprintf(stderr, "[ERROR] Failed creating temporary files.\n");
+    goto teardown;
+  }
+  retval = vpdLock(&lock, false, -1);
+  if (VPD_OK != retval)
+    goto teardown;
+  if (FLASHROM_OK !=
+          flashromPartialRead(part_file, full_file, partition->name) &&
+      FLASHROM_OK != flashromFullRead(full_file)) {
+    fprintf(stderr, "[ERROR] flashromFullRead() error!\n");
+    retval = VPD_ERR_ROM_READ;
+    goto teardown;
+  }
+  vpdUnlock(&lock);
+
+  image = mapFile(full_file, &image_size);
+  if (!image) {
+    fprintf(stderr, "[ERROR] Cannot read %s.\n", full_file);
+    retval = VPD_ERR_SYSTEM;
+    goto teardown;
+  }
+  retval = lookupImage(partition, image, image_size, lookups);
+
+teardown:
+  vpdUnlock(&lock);
+  if (part_fd >= 0) {
+    close(part_fd);
+    unlink(part_file);
+  }
+  if (full_fd >= 0) {
+    close(full_fd);
+    unlink(full_file);
+  }
+  return retval;
+}
+
+vpd_err_t lookupPartition(const struct Partition* partition,
+                          const char* filename,
+                          struct Lookups* lookups) {
+  if (filename) {
+    /* Map the image once for both partitions. */
+    static const uint8_t* image;
+    static uint32_t image_size;
+    if (!image && !(image = mapFile(filename, &image_size))) {
+      fprintf(stderr, "[ERROR] Cannot read %s: %s\n", filename,
+              strerror(errno));
+      return VPD_ERR_SYSTEM;
+    }
+    return lookupImage(partition, image, image_size, lookups);
+  }
+
+  struct stat marker;
+  const bool written = writtenSince(partition, &marker);
+  if (!written && lookupSysfs(partition, lookups))
+    return VPD_OK;
+  if (lookupCache(partition, written ? &marker : NULL, lookups))
+    return VPD_OK;
+  return lookupFlash(partition, lookups);
+}
+
+/* Prints the value of lookup. Values from sysfs are copied straight from
+ * the file. */
+vpd_err_t printValue(const struct Lookup* lookup) {
+  if (lookup->source != SOURCE_SYSFS) {
+    fwrite(lookup->value, lookup->value_len, 1, stdout);
+    return VPD_OK;
+  }
+
+  char path[PATH_MAX];
+  snprintf(path, sizeof(path), "%s/%s/%s",
+           getPath("VPD_SYSFS_DIR", VPD_SYSFS_DIR),
+           lookup->partition->sysfs_dir, lookup->key);
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    fprintf(stderr, "[ERROR] Cannot read %s: %s\n", path, strerror(errno));
+    return VPD_ERR_SYSTEM;
+  }
+  char buf[4096];
+  ssize_t len;
+  while ((len = read(fd, buf, sizeof(buf))) != 0) {
+    if (len < 0 && errno == EINTR)
+      continue;
+    if (len < 0) {
+      fprintf(stderr, "[ERROR] Cannot read %s: %s\n", path, strerror(errno));
+      close(fd);
+      return VPD_ERR_SYSTEM;
+    }
+    fwrite(buf, len, 1, stdout);
+  }
+  close(fd);
+  return VPD_OK;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  const struct Partition* only = NULL;
+  const char* filename = NULL;
+  bool null_terminated = false;
+  static struct Lookups lookups;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "hi:f:0")) != -1) {
+    switch (opt) {
+      case 'h':
+        usage(argv[0]);
+        return VPD_OK;
+      case 'i':
+        for (const auto& partition : kPartitions) {
+          if (!strcmp(optarg, partition.name))
+            only = &partition;
+        }
+        if (!only) {
+          fprintf(stderr, "[ERROR] Invalid VPD partition name: %s\n", optarg);
+          return VPD_ERR_SYNTAX;
+        }
+        break;
+      case 'f':
+        filename = optarg;
+        break;
+      case '0':
+        null_terminated = true;
+        break;
+      default:
+        usage(argv[0]);
+        return VPD_ERR_SYNTAX;
+    }
+  }
+  if (optind >= argc) {
+    usage(argv[0]);
+    return VPD_ERR_SYNTAX;
+  }
+  if (argc - optind > MAX_KEYS) {
+    fprintf(stderr, "[ERROR] At most %d keys.\n", MAX_KEYS);
+    return VPD_ERR_SYNTAX;
+  }
+  for (int i = optind; i < argc; i++) {
+    if (!isValidKey(argv[i])) {
+      fprintf(stderr, "[ERROR] Invalid key: '%s'\n", argv[i]);
+      return VPD_ERR_SYNTAX;
+    }
+    lookups.entries[lookups.count++].key = argv[i];
+  }
+  lookups.missing = lookups.count;
+
+  for (const auto& partition : kPartitions) {
+    if (!lookups.missing)
+      break;
+    if (only && only != &partition)
+      continue;
+    vpd_err_t retval = lookupPartition(&partition, filename, &lookups);
+    if (VPD_OK != retval)
+      return retval;
+  }
+
+  const bool multi = lookups.count > 1;
+  for (int i = 0; i < lookups.count; i++) {
+    const struct Lookup* lookup = &lookups.entries[i];
+    if (!multi) {
+      if (lookup->source == SOURCE_NONE) {
+        fprintf(stderr, "Vpd data '%s' was not found.\n", lookup->key);
+        break;
+      }
+      vpd_err_t retval = printValue(lookup);
+      if (VPD_OK != retval)
+        return retval;
+      continue;
+    }
+    printf("%c%s", lookup->source == SOURCE_NONE ? '-' : '+', lookup->key);
+    if (lookup->source != SOURCE_NONE) {
+      putchar('=');
+      vpd_err_t retval = printValue(lookup);
+      if (VPD_OK != retval)
+        return retval;
+    }
+    putchar(null_terminated ? '\0' : '\n');
+  }
+  return lookups.missing ? VPD_FAIL : VPD_OK;
+}
@@ -0,0 +1,928 @@
+/*
+ * Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * vpdd - keeps RO_VPD and RW_VPD in memory and serves them over a Unix socket.
+ *
+ * Both regions are loaded at start (through "vpd --write-cache", which keeps
+ * binary values binary, unlike "vpd -l"), and again only
+ * when vpd has written them directly, so queries are answered without
+ * touching flash. Writes from all clients are applied to memory immediately,
+ * queued, and committed together by a single "vpd --batch" run once the
+ * coalescing window has passed. Writers are answered after the commit and
+ * the regeneration of the caches.
+ *
+ * Commits and reloads take seconds of flashrom, so they run in a child
+ * process whose output the main loop polls like a client, and reads keep
+ * being answered from memory meanwhile.
+ *
+ * See include/lib/vpdd_client.h for the protocol.
+ */
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <base/logging.h>
+
+extern "C" {
+#include "lib/base64.h"
+#include "lib/lib_vpd.h"
+#include "lib/vpd_cache.h"
+#include "lib/vpdd_client.h"
+};
+
+namespace {
+
+/* In the order of the sections of the binary cache. */
+const char* const kRegions[] = {"RO_VPD", "RW_VPD"};
+
+/* Default time to wait for more writes before committing, in ms. */
+#define DEFAULT_WINDOW_MS 200
+
+/* Requests longer than this are rejected. A VPD partition is 128KB. */
+#define MAX_REQUEST_LEN (256 * 1024)
+
+/* Where vpd marks the regions it wrote, as in libvpd/vpd_region.cc. Can be
+ * overridden by the environment variable of the same name. */
+#define VPD_RUN_DIR "/run/vpd"
+
+volatile sig_atomic_t quit = 0;
+
+void onSignal(int) {
+  quit = 1;
+}
+
+uint64_t nowMs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* Quotes a string for /bin/sh. */
+std::string shellQuote(const std::string& str) {
+  std::string quoted = "'";
+  for (char c : str) {
+    if (c == '\'')
+      quoted += "'\"'\"'";
+    else
+      quoted += c;
+  }
+  return quoted + "'";
+}
+
+/* The same rule as checkKeyName() in vpd.cc. A key that vpd rejects would
+ * fail the whole commit it was batched into. */
+bool isValidKey(const std::string& key) {
+  for (unsigned char c : key) {
+    if (!isalnum(c) && c != '_' && c != '.')
+      return false;
+  }
+  return true;
+}
+
+/* vpd --batch strips trailing whitespace from its lines, so such values
+ * would be committed without it. */
+bool isValidValue(const std::string& value) {
+  return value.empty() || !isspace(static_cast<unsigned char>(value.back()));
+}
+
+bool isWrite(const std::string& request) {
+  return request.compare(0, 4, "SET ") == 0 ||
+         request.compare(0, 7, "DELETE ") == 0;
+}
+
+struct Client {
+  int fd;
+  std::string input;
+  /* Replies to SET/DELETE requests held back until the commit, in order.
+   * VPD_OK stands for the result of the commit. */
+  std::vector<vpd_err_t> deferred;
+  /* Set while a SYNC from this client waits for the commit. */
+  bool waiting_sync = false;
+  /* Set while a RELOAD from this client waits for the reload. */
+  bool waiting_reload = false;
+  /* The leading deferred replies, and the SYNC, that the running commit
+   * answers; later ones wait for the next commit. */
+  size_t committing = 0;
+  bool sync_committing = false;
+  /* Whether the running reload answers the RELOAD. */
+  bool reloading = false;
+
+  /* Replies must go out in order, so only more writes can be handled while
+   * earlier writes are waiting for the commit. */
+  bool Blocked() const {
+    if (waiting_sync || waiting_reload)
+      return true;
+    if (deferred.empty())
+      return false;
+    size_t eol = input.find('\n');
+    return eol != std::string::npos && !isWrite(input.substr(0, eol));
+  }
+};
+
+struct Value {
+  std::string data;
+  /* Printed in base64 by LIST, like vpd -l does. */
+  bool binary;
+};
+
+struct PendingOp {
+  std::string region;
+  std::string key;
+  std::string value;
+  bool is_delete;
+  /* The client that sent it, and its reply in Client::deferred. */
+  int fd;
+  size_t reply;
+};
+
+class Daemon {
+ public:
+  Daemon(const std::string& vpd_cmd, const std::string& image,
+         const std::string& cache_cmd, int window_ms)
+      : vpd_cmd_(vpd_cmd),
+        image_(image),
+        cache_cmd_(cache_cmd),
+        window_ms_(window_ms) {}
+
+  bool Listen(const std::string& socket_path);
+  void Run();
+
+ private:
+  enum class JobKind { kNone, kCommit, kReload };
+
+  /* Runs work in a child process, and the Finish*() method of kind with what
+   * it returns once the child exits. Runs it in this process if a child
+   * cannot be started. */
+  void StartJob(JobKind kind, const std::function<std::string()>& work);
+  /* Reads the output of the job; called when job_fd_ is readable. */
+  void ReadJob();
+  void FinishJob();
+  /* Blocks until no job is running. */
+  void WaitJobs();
+
+  /* Starts loading all regions from flash. Until FinishReload(), reads are
+   * answered from the contents loaded before. */
+  void StartReload();
+  /* Replaces the in-memory contents with what the reload loaded, with the
+   * pending writes applied again, and answers RELOAD. */
+  void FinishReload(const std::string& output);
+  /* Returns what identifies the current contents of flash (or the image):
+   * the marker files vpd touches on every write. */
+  std::string FlashStamp() const;
+  /* Runs "vpd --batch" on ops and returns its exit status. */
+  vpd_err_t RunBatch(const std::vector<PendingOp>& ops) const;
+  /* Writes ops to flash and regenerates the caches, in the child. Returns the
+   * status of the commit, followed by that of each op if they had to be
+   * written one by one. */
+  std::string CommitOps(const std::vector<PendingOp>& ops) const;
+  /* Starts writing all pending operations. */
+  void Commit();
+  void FinishCommit(const std::string& output);
+  /* Answers the clients waiting for the last commit. */
+  void AnswerCommit();
+  void Accept();
+  /* Returns false if the client should be disconnected. */
+  bool ReadClient(Client* client);
+  bool HandleRequest(Client* client, const std::string& request);
+  bool Reply(Client* client, vpd_err_t status, const std::string& payload);
+  void Disconnect(size_t index);
+
+  std::string vpd_cmd_;
+  /* The image given by -f, or empty for flash. */
+  std::string image_;
+  std::string cache_cmd_;
+  int window_ms_;
+  int listen_fd_ = -1;
+  std::vector<Client> clients_;
+
+  std::map<std::string, std::map<std::string, Value>> regions_;
+  /* FlashStamp() as of the last StartReload(). */
+  std::string stamp_;
+  std::vector<PendingOp> pending_;
+  /* When the first pending operation was queued. */
+  uint64_t pending_since_ = 0;
+  bool sync_requested_ = false;
+  bool reload_requested_ = false;
+
+  /* The running job, if any. Only one runs at a time. */
+  JobKind job_ = JobKind::kNone;
+  pid_t job_pid_ = -1;
+  int job_fd_ = -1;
+  std::string job_output_;
+  /* What the running commit writes, and whether memory may be behind flash
+   * because somebody else wrote it before. */
+  std::vector<PendingOp> committing_;
+  bool commit_stale_ = false;
+  /* The result of the last commit, answered once the reload after it is
+   * done if answer_after_reload_. */
+  vpd_err_t commit_status_ = VPD_OK;
+  bool answer_after_reload_ = false;
+  /* Where the running reload has vpd write the regions. */
+  std::string reload_dir_;
+};
+
+bool Daemon::Listen(const std::string& socket_path) {
+  struct sockaddr_un addr;
+
+  if (socket_path.size() >= sizeof(addr.sun_path)) {
+    LOG(ERROR) << "Socket path too long: " << socket_path;
+    return false;
+  }
+  listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+  if (listen_fd_ < 0) {
+    PLOG(ERROR) << "socket() failed";
+    return false;
+  }
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, socket_path.c_str());
+  unlink(socket_path.c_str());
+  if (bind(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr),
+           sizeof(addr)) < 0 ||
+      listen(listen_fd_, 16) < 0) {
+    PLOG(ERROR) << "Cannot listen on " << socket_path;
+    return false;
+  }
+  /* Values in RO_VPD may be sensitive; keep the socket to its owner and
+   * group. init/vpdd.conf makes the directory setgid vpd, so the socket is
+   * in that group and the other users in it may connect. */
+  chmod(socket_path.c_str(), 0660);
+  return true;
+}
+
+void Daemon::StartJob(JobKind kind,
+                      const std::function<std::string()>& work) {
+  int fds[2];
+  pid_t pid = -1;
+
+  job_ = kind;
+  job_output_.clear();
+  if (pipe2(fds, O_CLOEXEC) < 0) {
+    PLOG(ERROR) << "pipe2() failed";
+  } else if ((pid = fork()) < 0) {
+    PLOG(ERROR) << "fork() failed";
+    close(fds[0]);
+    close(fds[1]);
+  } else if (pid == 0) {
+    close(fds[0]);
+    std::string output = work();
+    const char* p = output.data();
+    size_t len = output.size();
+    while (len) {
+      ssize_t written = write(fds[1], p, len);
+      if (written < 0 && errno == EINTR)
+        continue;
+      if (written <= 0)
+        break;
+      p += written;
+      len -= written;
+    }
+    _exit(0);
+  }
+
+  if (pid <= 0) {
+    /* Slow, but the work still gets done. */
+    job_output_ = work();
+    FinishJob();
+    return;
+  }
+  close(fds[1]);
+  fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+  job_pid_ = pid;
+  job_fd_ = fds[0];
+}
+
+void Daemon::ReadJob() {
+  char buf[256];
+
+  for (;;) {
+    ssize_t len = read(job_fd_, buf, sizeof(buf));
+    if (len < 0 && errno == EINTR)
+      continue;
+    if (len < 0 && errno == EAGAIN)
+      return;
+    if (len <= 0)
+      break;
+    job_output_.append(buf, len);
+  }
+  FinishJob();
+}
+
+void Daemon::FinishJob() {
+  if (job_fd_ >= 0) {
+    close(job_fd_);
+    job_fd_ = -1;
+  }
+  if (job_pid_ > 0) {
+    while (waitpid(job_pid_, NULL, 0) < 0 && errno == EINTR) {
+    }
+    job_pid_ = -1;
+  }
+  JobKind kind = job_;
+  std::string output;
+  output.swap(job_output_);
+  job_ = JobKind::kNone;
+  /* These may start the next job. */
+  if (kind == JobKind::kCommit)
+    FinishCommit(output);
+  else if (kind == JobKind::kReload)
+    FinishReload(output);
+}
+
+void Daemon::WaitJobs() {
+  while (job_ != JobKind::kNone) {
+    struct pollfd pfd = {job_fd_, POLLIN, 0};
+    if (poll(&pfd, 1, -1) < 0 && errno != EINTR) {
+      PLOG(ERROR) << "poll() failed";
+      return;
+    }
+    ReadJob();
+  }
+}
+
+void Daemon::StartReload() {
+  /* Taken first, so that writes made while loading trigger another reload. */
+  stamp_ = FlashStamp();
+  reload_requested_ = false;
+  for (auto& client : clients_)
+    client.reloading = client.waiting_reload;
+
+  char dir[] = "/tmp/vpdd.XXXXXX";
+  if (!mkdtemp(dir)) {
+    PLOG(ERROR) << "Cannot create a temporary directory";
+    reload_dir_.clear();
+    FinishReload("");
+    return;
+  }
+  reload_dir_ = dir;
+  std::string cmd = vpd_cmd_ + " --write-cache " +
+                    shellQuote(reload_dir_ + "/regions.bin") +
+                    " >/dev/null 2>&1";
+  StartJob(JobKind::kReload,
+           [cmd] { return std::to_string(system(cmd.c_str())); });
+}
+
+void Daemon::FinishReload(const std::string& output) {
+  const std::string cache = reload_dir_ + "/regions.bin";
+  int status = output.empty() ? -1 : atoi(output.c_str());
+  if (status != 0)
+    LOG(WARNING) << "Loading the VPD failed: " << status;
+
+  regions_.clear();
+  for (const char* region : kRegions)
+    regions_[region].clear();
+  struct VpdCache vpd_cache;
+  if (status == 0 && VPD_OK == openVpdCache(&vpd_cache, cache.c_str())) {
+    for (int section = 0; section < VPD_CACHE_NUM_SECTIONS; section++) {
+      auto& pairs = regions_[kRegions[section]];
+      for (uint32_t i = 0; i < getVpdCacheCount(&vpd_cache, section); i++) {
+        const char* key;
+        const uint8_t* value;
+        uint32_t value_len;
+        int type;
+        getVpdCacheEntry(&vpd_cache, section, i, &key, &value, &value_len,
+                         &type);
+        pairs[key] = {
+            std::string(reinterpret_cast<const char*>(value), value_len),
+            type == VPD_TYPE_BINARY};
+      }
+      LOG(INFO) << "Loaded " << pairs.size() << " keys from "
+                << kRegions[section];
+    }
+    closeVpdCache(&vpd_cache);
+  }
+
+  if (!reload_dir_.empty()) {
+    /* vpd also leaves the raw partitions next to the cache. */
+    for (const char* name : {"/regions.bin", "/ro_raw", "/rw_raw"})
+      unlink((reload_dir_ + name).c_str());
+    rmdir(reload_dir_.c_str());
+    reload_dir_.clear();
+  }
+
+  /* Writes queued while loading are not in flash yet. */
+  for (const auto& op : pending_) {
+    auto& pairs = regions_[op.region];
+    if (op.is_delete)
+      pairs.erase(op.key);
+    else
+      pairs[op.key] = {op.value, false};
+  }
+
+  for (size_t i = 0; i < clients_.size();) {
+    Client* client = &clients_[i];
+    if (client->reloading) {
+      client->reloading = false;
+      client->waiting_reload = false;
+      if (!Reply(client, VPD_OK, "") || !ReadClient(client)) {
+        Disconnect(i);
+        continue;
+      }
+    }
+    i++;
+  }
+
+  if (answer_after_reload_) {
+    answer_after_reload_ = false;
+    AnswerCommit();
+  }
+}
+
+std::string Daemon::FlashStamp() const {
+  std::vector<std::string> paths;
+  if (!image_.empty()) {
+    paths.push_back(image_);
+  } else {
+    const char* run_dir = getenv("VPD_RUN_DIR");
+    if (!run_dir || !*run_dir)
+      run_dir = VPD_RUN_DIR;
+    for (const char* region : kRegions)
+      paths.push_back(std::string(run_dir) + "/" + region + ".written");
+  }
+
+  std::string stamp;
+  for (const auto& path : paths) {
+    struct stat st;
+    if (!stat(path.c_str(), &st)) {
+      stamp += std::to_string(st.st_ino) + ":" + std::to_string(st.st_size) +
+               ":" + std::to_string(st.st_mtim.tv_sec) + "." +
+               std::to_string(st.st_mtim.tv_nsec);
+    }
+    stamp += ";";
+  }
+  return stamp;
+}
+
+vpd_err_t Daemon::RunBatch(const std::vector<PendingOp>& ops) const {
+  /* Operations are kept in order so that the last one wins. */
+  std::string batch;
+  for (const auto& op : ops) {
+    batch += "region " + op.region + "\n";
+    if (op.is_delete)
+      batch += "delete " + op.key + "\n";
+    else
+      batch += "set " + op.key + "=" + op.value + "\n";
+  }
+
+  std::string cmd = vpd_cmd_ + " --batch - --exit-unchanged >/dev/null";
+  FILE* fp = popen(cmd.c_str(), "w");
+  if (!fp) {
+    PLOG(ERROR) << "Cannot run: " << cmd;
+    return VPD_ERR_SYSTEM;
+  }
+  fwrite(batch.data(), batch.size(), 1, fp);
+  int ret = pclose(fp);
+  if (ret < 0 || !WIFEXITED(ret))
+    return VPD_ERR_SYSTEM;
+  return static_cast<vpd_err_t>(WEXITSTATUS(ret));
+}
+
+std::string Daemon::CommitOps(const std::vector<PendingOp>& ops) const {
+  vpd_err_t status = RunBatch(ops);
+  std::string results;
+
+  if (status != VPD_OK && status != VPD_UNCHANGED && ops.size() > 1) {
+    /* Do not fail every writer for the one vpd rejected: write each
+     * operation on its own and answer with its own result. */
+    bool written = false;
+    for (const auto& op : ops) {
+      vpd_err_t op_status = RunBatch({op});
+      if (op_status == VPD_UNCHANGED)
+        op_status = VPD_OK;
+      else if (op_status == VPD_OK)
+        written = true;
+      results += " " + std::to_string(static_cast<int>(op_status));
+    }
+    /* Everybody got their own result; SYNC only waits for them. */
+    status = written ? VPD_OK : VPD_UNCHANGED;
+  }
+
+  /* Nothing was written, so the caches are still valid. */
+  if (status == VPD_OK && !cache_cmd_.empty() &&
+      system(cache_cmd_.c_str()) != 0)
+    LOG(WARNING) << "Cache refresh failed: " << cache_cmd_;
+  return std::to_string(static_cast<int>(status)) + results;
+}
+
+void Daemon::Commit() {
+  sync_requested_ = false;
+  for (auto& client : clients_) {
+    client.committing = client.deferred.size();
+    client.sync_committing = client.waiting_sync;
+  }
+  if (pending_.empty()) {
+    commit_status_ = VPD_OK;
+    AnswerCommit();
+    return;
+  }
+
+  /* Memory is only ahead of flash by the writes if nobody else wrote. */
+  commit_stale_ = FlashStamp() != stamp_;
+  committing_.swap(pending_);
+  pending_.clear();
+  const std::vector<PendingOp> ops = committing_;
+  StartJob(JobKind::kCommit, [this, ops] { return CommitOps(ops); });
+}
+
+void Daemon::FinishCommit(const std::string& output) {
+  std::vector<vpd_err_t> results;
+  const char* p = output.c_str();
+  char* end;
+  for (long value = strtol(p, &end, 10); end != p;
+       p = end, value = strtol(p, &end, 10))
+    results.push_back(static_cast<vpd_err_t>(value));
+
+  vpd_err_t status = results.empty() ? VPD_ERR_SYSTEM : results[0];
+  bool stale = commit_stale_;
+  LOG(INFO) << "Committed " << committing_.size() << " changes: " << status;
+  if (results.size() == committing_.size() + 1) {
+    for (size_t i = 0; i < committing_.size(); i++) {
+      const PendingOp& op = committing_[i];
+      for (auto& client : clients_) {
+        if (client.fd == op.fd && op.reply < client.committing)
+          client.deferred[op.reply] = results[i + 1];
+      }
+    }
+    LOG(INFO) << "Committed " << committing_.size() << " changes one by one";
+    stale = true;
+  }
+  committing_.clear();
+
+  if (status == VPD_UNCHANGED) {
+    status = VPD_OK;
+  } else if (status != VPD_OK) {
+    /* Memory has the rejected changes; get back in sync with flash. */
+    stale = true;
+  }
+  commit_status_ = status;
+  if (stale) {
+    /* Answered once memory is right again. */
+    answer_after_reload_ = true;
+    StartReload();
+  } else {
+    stamp_ = FlashStamp();
+    AnswerCommit();
+  }
+}
+
+void Daemon::AnswerCommit() {
+  for (size_t i = 0; i < clients_.size();) {
+    Client* client = &clients_[i];
+    if (client->committing || client->sync_committing) {
+      bool ok = true;
+      for (size_t j = 0; j < client->committing; j++) {
+        vpd_err_t reply = client->deferred[j];
+        if (ok)
+          ok = Reply(client, reply == VPD_OK ? commit_status_ : reply, "");
+      }
+      if (ok && client->sync_committing) {
+        ok = Reply(client, commit_status_, "");
+        client->waiting_sync = false;
+      }
+      /* Writes queued since then wait for the next commit, but rejected ones
+       * right after the committed writes can be answered now. */
+      size_t answered = client->committing;
+      while (answered < client->deferred.size() &&
+             client->deferred[answered] != VPD_OK) {
+        if (ok)
+          ok = Reply(client, client->deferred[answered], "");
+        answered++;
+      }
+      client->deferred.erase(client->deferred.begin(),
+                             client->deferred.begin() + answered);
+      for (auto& op : pending_) {
+        if (op.fd == client->fd)
+          op.reply -= answered;
+      }
+      client->committing = 0;
+      client->sync_committing = false;
+      if (!ok || !ReadClient(client)) {
+        Disconnect(i);
+        continue;
+      }
+    }
+    i++;
+  }
+}
+
+void Daemon::Accept() {
+  for (;;) {
+    int fd = accept4(listen_fd_, NULL, NULL, SOCK_CLOEXEC | SOCK_NONBLOCK);
+    if (fd < 0)
+      return;
+    clients_.push_back(Client{fd});
+  }
+}
+
+void Daemon::Disconnect(size_t index) {
+  /* Its writes are still committed, but the fd may be reused. */
+  for (auto* ops : {&pending_, &committing_}) {
+    for (auto& op : *ops) {
+      if (op.fd == clients_[index].fd)
+        op.fd = -1;
+    }
+  }
+  close(clients_[index].fd);
+  clients_.erase(clients_.begin() + index);
+}
+
+bool Daemon::Reply(Client* client, vpd_err_t status,
+                   const std::string& payload) {
+  std::string out = std::to_string(static_cast<int>(status)) + " " +
+                    std::to_string(payload.size()) + "\n" + payload;
+  const char* p = out.data();
+  size_t len = out.size();
+
+  while (len) {
+    ssize_t written = send(client->fd, p, len, MSG_NOSIGNAL);
+    if (written < 0 && errno == EINTR)
+      continue;
+    if (written < 0 && errno == EAGAIN) {
+      struct pollfd pfd = {client->fd, POLLOUT, 0};
+      if (poll(&pfd, 1, 1000) <= 0)
+        return false;
+      continue;
+    }
+    if (written <= 0)
+      return false;
+    p += written;
+    len -= written;
+  }
+  return true;
+}
+
+bool Daemon::ReadClient(Client* client) {
+  char buf[4096];
+
+  for (;;) {
+    /* Handle buffered requests first. */
+    size_t eol;
+    while (!client->Blocked() &&
+           (eol = client->input.find('\n')) != std::string::npos) {
+      std::string request = client->input.substr(0, eol);
+      client->input.erase(0, eol + 1);
+      if (!HandleRequest(client, request))
+        return false;
+    }
+    if (client->Blocked())
+      return true;
+
+    ssize_t len = read(client->fd, buf, sizeof(buf));
+    if (len < 0 && errno == EINTR)
+      continue;
+    if (len < 0 && errno == EAGAIN)
+      return true;
+    if (len <= 0)
+      return false;
+    client->input.append(buf, len);
+    if (client->input.size() > MAX_REQUEST_LEN)
+      return false;
+  }
+}
+
+bool Daemon::HandleRequest(Client* client, const std::string& request) {
+  size_t sp1 = request.find(' ');
+  std::string op = request.substr(0, sp1);
+  std::string region, arg;
+  if (sp1 != std::string::npos) {
+    size_t sp2 = request.find(' ', sp1 + 1);
+    region = request.substr(sp1 + 1, sp2 == std::string::npos
+                                         ? std::string::npos
+                                         : sp2 - sp1 - 1);
+    if (sp2 != std::string::npos)
+      arg = request.substr(sp2 + 1);
+  }
+
+  if (op == "SYNC") {
+    sync_requested_ = true;
+    client->waiting_sync = true;
+    return true;
+  }
+  if (op == "RELOAD") {
+    if (!pending_.empty())
+      return Reply(client, VPD_FAIL, "");
+    /* Answered by the next reload that starts. */
+    reload_requested_ = true;
+    client->waiting_reload = true;
+    return true;
+  }
+
+  /* Pick up writes made without vpdd, in the background; until then this
+   * and other reads get the contents loaded before. Pending writes are
+   * committed first, which catches up anyway, as does the running commit. */
+  if ((op == "GET" || op == "LIST") && pending_.empty() &&
+      committing_.empty() && FlashStamp() != stamp_)
+    reload_requested_ = true;
+
+  auto it = regions_.find(region);
+  if (it == regions_.end())
+    return Reply(client, VPD_ERR_PARAM, "");
+  auto& pairs = it->second;
+
+  if (op == "GET") {
+    auto found = pairs.find(arg);
+    if (found == pairs.end())
+      return Reply(client, VPD_FAIL, "");
+    return Reply(client, VPD_OK, found->second.data);
+  }
+  if (op == "LIST") {
+    std::string payload;
+    for (const auto& pair : pairs) {
+      const Value& value = pair.second;
+      payload += pair.first + "=";
+      if (value.binary) {
+        std::string text(base64EncodedSize(value.data.size()), '\0');
+        base64Encode(reinterpret_cast<const uint8_t*>(value.data.data()),
+                     value.data.size(), &text[0]);
+        payload += text;
+      } else {
+        payload += value.data;
+      }
+      payload += '\0';
+    }
+    return Reply(client, VPD_OK, payload);
+  }
+  if (op == "SET" || op == "DELETE") {
+    PendingOp pending = {region, arg, "", op == "DELETE", client->fd,
+                         client->deferred.size()};
+    vpd_err_t status = VPD_OK;
+    if (!pending.is_delete) {
+      size_t eq = arg.find('=');
+      if (eq == std::string::npos || eq == 0) {
+        status = VPD_ERR_SYNTAX;
+      } else if (!isValidKey(arg.substr(0, eq)) ||
+                 !isValidValue(arg.substr(eq + 1))) {
+        status = VPD_ERR_PARAM;
+      } else {
+        pending.key = arg.substr(0, eq);
+        pending.value = arg.substr(eq + 1);
+        pairs[pending.key] = {pending.value, false};
+      }
+    } else if (!pairs.erase(arg)) {
+      status = VPD_ERR_PARAM;
+    }
+
+    if (VPD_OK != status) {
+      if (client->deferred.empty())
+        return Reply(client, status, "");
+      client->deferred.push_back(status);
+      return true;
+    }
+    if (pending_.empty())
+      pending_since_ = nowMs();
+    pending_.push_back(pending);
+    client->deferred.push_back(VPD_OK);
+    return true;
+  }
+  return Reply(client, VPD_ERR_SYNTAX, "");
+}
+
+void Daemon::Run() {
+  StartReload();
+  WaitJobs();
+
+  while (!quit) {
+    std::vector<struct pollfd> fds;
+    fds.push_back({listen_fd_, POLLIN, 0});
+    for (const auto& client : clients_)
+      fds.push_back({client.fd, static_cast<short>(
+                                    client.Blocked() ? 0 : POLLIN), 0});
+    if (job_fd_ >= 0)
+      fds.push_back({job_fd_, POLLIN, 0});
+
+    /* A new job only starts once the running one is done. */
+    int timeout = -1;
+    if (job_ != JobKind::kNone) {
+      /* Woken up by job_fd_. */
+    } else if (sync_requested_ || reload_requested_) {
+      timeout = 0;
+    } else if (!pending_.empty()) {
+      uint64_t elapsed = nowMs() - pending_since_;
+      timeout = elapsed >= static_cast<uint64_t>(window_ms_)
+                    ? 0
+                    : window_ms_ - static_cast<int>(elapsed);
+    }
+
+    int ready = poll(fds.data(), fds.size(), timeout);
+    if (ready < 0 && errno != EINTR) {
+      PLOG(ERROR) << "poll() failed";
+      break;
+    }
+
+    if (ready > 0) {
+      bool job_ready = job_fd_ >= 0 && fds.back().revents;
+      /* Walk backwards so that Disconnect() keeps the indexes valid. */
+      for (size_t i = clients_.size(); i > 0; --i) {
+        if (fds[i].revents && !ReadClient(&clients_[i - 1]))
+          Disconnect(i - 1);
+      }
+      if (fds[0].revents & POLLIN)
+        Accept();
+      if (job_ready)
+        ReadJob();
+    }
+
+    if (job_ != JobKind::kNone)
+      continue;
+    if (sync_requested_ ||
+        (!pending_.empty() &&
+         nowMs() - pending_since_ >= static_cast<uint64_t>(window_ms_)))
+      Commit();
+    else if (reload_requested_)
+      StartReload();
+  }
+
+  /* Do not lose accepted writes on shutdown. */
+  WaitJobs();
+  if (!pending_.empty()) {
+    Commit();
+    WaitJobs();
+  }
+}
+
+void usage(const char* progname) {
+  printf("Usage: %s [OPTION] ...\n", progname);
+  printf("   OPTIONs include:\n");
+  printf("      -h               This help page.\n");
+  printf("      -f <filename>    Serve a firmware image instead of flash.\n");
+  printf("      -S <path>        Socket path (default: %s).\n",
+         VPDD_SOCKET_PATH);
+  printf("      -w <ms>          Time to wait for more writes before\n");
+  printf("                       committing (default: %d).\n",
+         DEFAULT_WINDOW_MS);
+  printf("      -c <command>     Command to refresh caches after commits\n");
+  printf("                       (default: dump_vpd_log --refresh).\n");
+  printf("\n");
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  std::string vpd_cmd = "vpd";
+  std::string image;
+  std::string socket_path = VPDD_SOCKET_PATH;
+  std::string cache_cmd = "dump_vpd_log --refresh";
+  int window_ms = DEFAULT_WINDOW_MS;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "hf:S:w:c:")) != EOF) {
+    switch (opt) {
+      case 'f':
+        image = optarg;
+        vpd_cmd += " -f " + shellQuote(image);
+        break;
+      case 'S':
+        socket_path = optarg;
+        break;
+      case 'w':
+        window_ms = atoi(optarg);
+        if (window_ms < 0) {
+          fprintf(stderr, "Invalid window: %s\n", optarg);
+          return VPD_ERR_SYNTAX;
+        }
+        break;
+      case 'c':
+        cache_cmd = optarg;
+        break;
+      case 'h':
+        usage(argv[0]);
+        return VPD_OK;
+      default:
+        usage(argv[0]);
+        return VPD_ERR_SYNTAX;
+    }
+  }
+
+  signal(SIGPIPE, SIG_IGN);
+  signal(SIGTERM, onSignal);
+  signal(SIGINT, onSignal);
+
+  Daemon daemon(vpd_cmd, image, cache_cmd, window_ms);
+  if (!daemon.Listen(socket_path))
+    return VPD_ERR_SYSTEM;
+  daemon.Run();
+  unlink(socket_path.c_str());
+
+  return VPD_OK;
+}